@@ -9,11 +9,284 @@
 
 #include "inst-decoder.h"
 
+#include <limits>
+#include <type_traits>
+
 #ifdef _MSC_VER
 /* MSVC intrinsics */
 #include <intrin.h>
 #endif
 
+/* The vector operations use the SSE2 instructions of the host when they
+ * are part of its baseline, as on x86-64. A register holds only four
+ * bytes, so wider instruction sets do not help.
+ */
+#if defined(__SSE2__) || (defined(_MSC_VER) && defined(_M_X64))
+#define HAVE_SSE2_VECTOR_OPS
+#include <emmintrin.h>
+#endif
+
+
+ALUOp
+getVectorALUOp(uint32_t function)
+{
+  switch (function)
+    {
+      case 0x10: return ALUOp::VALL_EQ_B;
+      case 0x11: return ALUOp::VALL_EQ_H;
+      case 0x12: return ALUOp::VALL_GE_B;
+      case 0x13: return ALUOp::VALL_GE_H;
+      case 0x14: return ALUOp::VALL_GT_B;
+      case 0x15: return ALUOp::VALL_GT_H;
+      case 0x16: return ALUOp::VALL_LE_B;
+      case 0x17: return ALUOp::VALL_LE_H;
+      case 0x18: return ALUOp::VALL_LT_B;
+      case 0x19: return ALUOp::VALL_LT_H;
+      case 0x1a: return ALUOp::VALL_NE_B;
+      case 0x1b: return ALUOp::VALL_NE_H;
+      case 0x20: return ALUOp::VANY_EQ_B;
+      case 0x21: return ALUOp::VANY_EQ_H;
+      case 0x22: return ALUOp::VANY_GE_B;
+      case 0x23: return ALUOp::VANY_GE_H;
+      case 0x24: return ALUOp::VANY_GT_B;
+      case 0x25: return ALUOp::VANY_GT_H;
+      case 0x26: return ALUOp::VANY_LE_B;
+      case 0x27: return ALUOp::VANY_LE_H;
+      case 0x28: return ALUOp::VANY_LT_B;
+      case 0x29: return ALUOp::VANY_LT_H;
+      case 0x2a: return ALUOp::VANY_NE_B;
+      case 0x2b: return ALUOp::VANY_NE_H;
+      case 0x30: return ALUOp::VADD_B;    /* lv.add.b */
+      case 0x31: return ALUOp::VADD_H;    /* lv.add.h */
+      case 0x32: return ALUOp::VADDS_B;
+      case 0x33: return ALUOp::VADDS_H;
+      case 0x34: return ALUOp::VADD_B;    /* lv.addu.b */
+      case 0x35: return ALUOp::VADD_H;    /* lv.addu.h */
+      case 0x36: return ALUOp::VADDUS_B;
+      case 0x37: return ALUOp::VADDUS_H;
+      case 0x40: return ALUOp::VCMP_EQ_B;
+      case 0x41: return ALUOp::VCMP_EQ_H;
+      case 0x42: return ALUOp::VCMP_GE_B;
+      case 0x43: return ALUOp::VCMP_GE_H;
+      case 0x44: return ALUOp::VCMP_GT_B;
+      case 0x45: return ALUOp::VCMP_GT_H;
+      case 0x46: return ALUOp::VCMP_LE_B;
+      case 0x47: return ALUOp::VCMP_LE_H;
+      case 0x48: return ALUOp::VCMP_LT_B;
+      case 0x49: return ALUOp::VCMP_LT_H;
+      case 0x4a: return ALUOp::VCMP_NE_B;
+      case 0x4b: return ALUOp::VCMP_NE_H;
+      case 0x5c: return ALUOp::VMULS_H;
+      case 0x71: return ALUOp::VSUB_B;    /* lv.sub.b */
+      case 0x72: return ALUOp::VSUB_H;    /* lv.sub.h */
+      case 0x73: return ALUOp::VSUBS_B;
+      case 0x74: return ALUOp::VSUBS_H;
+      case 0x75: return ALUOp::VSUB_B;    /* lv.subu.b */
+      case 0x76: return ALUOp::VSUB_H;    /* lv.subu.h */
+      case 0x77: return ALUOp::VSUBUS_B;
+      case 0x78: return ALUOp::VSUBUS_H;
+      default:
+        throw IllegalInstruction("Unsupported vector instruction");
+    }
+}
+
+
+/*
+ * Vector operations, portable implementation
+ */
+
+template <typename T>
+static T
+saturate(int32_t value)
+{
+  if (value < std::numeric_limits<T>::min())
+    return std::numeric_limits<T>::min();
+  if (value > std::numeric_limits<T>::max())
+    return std::numeric_limits<T>::max();
+  return value;
+}
+
+/* Applies "f" to each pair of elements of type T */
+template <typename T, typename F>
+static RegValue
+packed(RegValue A, RegValue B, F f)
+{
+  using U = std::make_unsigned_t<T>;
+  constexpr unsigned int Bits = 8 * sizeof(T);
+
+  RegValue result = 0;
+  for (unsigned int shift = 0; shift < 32; shift += Bits)
+    {
+      const T a = static_cast<T>(A >> shift);
+      const T b = static_cast<T>(B >> shift);
+      result |= RegValue{ static_cast<U>(f(a, b)) } << shift;
+    }
+
+  return result;
+}
+
+template <typename T>
+static RegValue
+packedCompare(ALUOp op, RegValue A, RegValue B)
+{
+  switch (op)
+    {
+      case ALUOp::VCMP_EQ_B: case ALUOp::VCMP_EQ_H:
+        return packed<T>(A, B, [](T a, T b) { return a == b ? -1 : 0; });
+      case ALUOp::VCMP_NE_B: case ALUOp::VCMP_NE_H:
+        return packed<T>(A, B, [](T a, T b) { return a != b ? -1 : 0; });
+      case ALUOp::VCMP_GT_B: case ALUOp::VCMP_GT_H:
+        return packed<T>(A, B, [](T a, T b) { return a > b ? -1 : 0; });
+      case ALUOp::VCMP_GE_B: case ALUOp::VCMP_GE_H:
+        return packed<T>(A, B, [](T a, T b) { return a >= b ? -1 : 0; });
+      case ALUOp::VCMP_LT_B: case ALUOp::VCMP_LT_H:
+        return packed<T>(A, B, [](T a, T b) { return a < b ? -1 : 0; });
+      default:
+        return packed<T>(A, B, [](T a, T b) { return a <= b ? -1 : 0; });
+    }
+}
+
+static RegValue
+vectorScalar(ALUOp op, RegValue A, RegValue B)
+{
+  using s8 = int8_t;
+  using u8 = uint8_t;
+  using s16 = int16_t;
+  using u16 = uint16_t;
+
+  switch (op)
+    {
+      case ALUOp::VADD_B:
+        return packed<u8>(A, B, [](u8 a, u8 b) { return a + b; });
+      case ALUOp::VADD_H:
+        return packed<u16>(A, B, [](u16 a, u16 b) { return a + b; });
+      case ALUOp::VADDS_B:
+        return packed<s8>(A, B, [](s8 a, s8 b) { return saturate<s8>(a + b); });
+      case ALUOp::VADDS_H:
+        return packed<s16>(A, B, [](s16 a, s16 b) { return saturate<s16>(a + b); });
+      case ALUOp::VADDUS_B:
+        return packed<u8>(A, B, [](u8 a, u8 b) { return saturate<u8>(a + b); });
+      case ALUOp::VADDUS_H:
+        return packed<u16>(A, B, [](u16 a, u16 b) { return saturate<u16>(a + b); });
+      case ALUOp::VSUB_B:
+        return packed<u8>(A, B, [](u8 a, u8 b) { return a - b; });
+      case ALUOp::VSUB_H:
+        return packed<u16>(A, B, [](u16 a, u16 b) { return a - b; });
+      case ALUOp::VSUBS_B:
+        return packed<s8>(A, B, [](s8 a, s8 b) { return saturate<s8>(a - b); });
+      case ALUOp::VSUBS_H:
+        return packed<s16>(A, B, [](s16 a, s16 b) { return saturate<s16>(a - b); });
+      case ALUOp::VSUBUS_B:
+        return packed<u8>(A, B, [](u8 a, u8 b) { return saturate<u8>(a - b); });
+      case ALUOp::VSUBUS_H:
+        return packed<u16>(A, B, [](u16 a, u16 b) { return saturate<u16>(a - b); });
+      case ALUOp::VMULS_H:
+        return packed<s16>(A, B, [](s16 a, s16 b) { return saturate<s16>(a * b); });
+
+      case ALUOp::VCMP_EQ_B: case ALUOp::VCMP_NE_B:
+      case ALUOp::VCMP_GT_B: case ALUOp::VCMP_GE_B:
+      case ALUOp::VCMP_LT_B: case ALUOp::VCMP_LE_B:
+        return packedCompare<s8>(op, A, B);
+
+      default:
+        return packedCompare<s16>(op, A, B);
+    }
+}
+
+
+/*
+ * Vector operations, SSE2 implementation
+ */
+
+#ifdef HAVE_SSE2_VECTOR_OPS
+static RegValue
+vectorSSE2(ALUOp op, RegValue A, RegValue B)
+{
+  const __m128i a = _mm_cvtsi32_si128(A);
+  const __m128i b = _mm_cvtsi32_si128(B);
+  const __m128i ones = _mm_set1_epi32(-1);
+  __m128i r;
+
+  switch (op)
+    {
+      case ALUOp::VADD_B: r = _mm_add_epi8(a, b); break;
+      case ALUOp::VADD_H: r = _mm_add_epi16(a, b); break;
+      case ALUOp::VADDS_B: r = _mm_adds_epi8(a, b); break;
+      case ALUOp::VADDS_H: r = _mm_adds_epi16(a, b); break;
+      case ALUOp::VADDUS_B: r = _mm_adds_epu8(a, b); break;
+      case ALUOp::VADDUS_H: r = _mm_adds_epu16(a, b); break;
+      case ALUOp::VSUB_B: r = _mm_sub_epi8(a, b); break;
+      case ALUOp::VSUB_H: r = _mm_sub_epi16(a, b); break;
+      case ALUOp::VSUBS_B: r = _mm_subs_epi8(a, b); break;
+      case ALUOp::VSUBS_H: r = _mm_subs_epi16(a, b); break;
+      case ALUOp::VSUBUS_B: r = _mm_subs_epu8(a, b); break;
+      case ALUOp::VSUBUS_H: r = _mm_subs_epu16(a, b); break;
+
+      case ALUOp::VMULS_H:
+        {
+          /* Full 32-bit products, packed back with signed saturation */
+          const __m128i lo = _mm_mullo_epi16(a, b);
+          const __m128i hi = _mm_mulhi_epi16(a, b);
+          const __m128i products = _mm_unpacklo_epi16(lo, hi);
+          r = _mm_packs_epi32(products, products);
+          break;
+        }
+
+      case ALUOp::VCMP_EQ_B: r = _mm_cmpeq_epi8(a, b); break;
+      case ALUOp::VCMP_EQ_H: r = _mm_cmpeq_epi16(a, b); break;
+      case ALUOp::VCMP_NE_B: r = _mm_xor_si128(_mm_cmpeq_epi8(a, b), ones); break;
+      case ALUOp::VCMP_NE_H: r = _mm_xor_si128(_mm_cmpeq_epi16(a, b), ones); break;
+      case ALUOp::VCMP_GT_B: r = _mm_cmpgt_epi8(a, b); break;
+      case ALUOp::VCMP_GT_H: r = _mm_cmpgt_epi16(a, b); break;
+      case ALUOp::VCMP_GE_B: r = _mm_xor_si128(_mm_cmplt_epi8(a, b), ones); break;
+      case ALUOp::VCMP_GE_H: r = _mm_xor_si128(_mm_cmplt_epi16(a, b), ones); break;
+      case ALUOp::VCMP_LT_B: r = _mm_cmplt_epi8(a, b); break;
+      case ALUOp::VCMP_LT_H: r = _mm_cmplt_epi16(a, b); break;
+      case ALUOp::VCMP_LE_B: r = _mm_xor_si128(_mm_cmpgt_epi8(a, b), ones); break;
+      default: r = _mm_xor_si128(_mm_cmpgt_epi16(a, b), ones); break;
+    }
+
+  return _mm_cvtsi128_si32(r);
+}
+#endif /* HAVE_SSE2_VECTOR_OPS */
+
+/* ALL and ANY compares reduce the result of the element-wise compare */
+static ALUOp
+getElementCompare(ALUOp op)
+{
+  const int offset = static_cast<int>(op) >= static_cast<int>(ALUOp::VANY_EQ_B)
+      ? static_cast<int>(ALUOp::VANY_EQ_B) : static_cast<int>(ALUOp::VALL_EQ_B);
+
+  return static_cast<ALUOp>(static_cast<int>(ALUOp::VCMP_EQ_B) +
+                            static_cast<int>(op) - offset);
+}
+
+bool
+hasSSE2VectorOps()
+{
+#ifdef HAVE_SSE2_VECTOR_OPS
+  return true;
+#else
+  return false;
+#endif
+}
+
+RegValue
+getVectorResult(ALUOp op, RegValue A, RegValue B)
+{
+#ifdef HAVE_SSE2_VECTOR_OPS
+  return vectorSSE2(op, A, B);
+#else
+  return vectorScalar(op, A, B);
+#endif
+}
+
+RegValue
+getScalarVectorResult(ALUOp op, RegValue A, RegValue B)
+{
+  return vectorScalar(op, A, B);
+}
+
 
 ALU::ALU()
   : A(), B(), op()
@@ -34,7 +307,14 @@ ALU::getResult()
       /* TODO: implement necessary operations */
 
       default:
-        throw IllegalInstruction("Unimplemented or unknown ALU operation");
+        if (op >= ALUOp::VADD_B && op <= ALUOp::VCMP_LE_H)
+          result = getVectorResult(op, A, B);
+        else if (op >= ALUOp::VALL_EQ_B && op <= ALUOp::VALL_LE_H)
+          result = getVectorResult(getElementCompare(op), A, B) == ~RegValue{ 0 };
+        else if (op >= ALUOp::VANY_EQ_B && op <= ALUOp::VANY_LE_H)
+          result = getVectorResult(getElementCompare(op), A, B) != 0;
+        else
+          throw IllegalInstruction("Unimplemented or unknown ALU operation");
     }
 
   return result;
@@ -16,9 +16,45 @@
 enum class ALUOp {
     NOP,
 
+    /* Vector operations treat the operands as packed bytes (B) or
+     * half-words (H) and operate on each element. Saturating operations
+     * (S signed, US unsigned) clamp the result to the range of the
+     * element type. Compares (signed) set an element to all ones when
+     * true and to zero otherwise; the ALL and ANY compares result in 1
+     * when the compare is true for all or for any of the elements.
+     */
+    VADD_B, VADD_H, VADDS_B, VADDS_H, VADDUS_B, VADDUS_H,
+    VSUB_B, VSUB_H, VSUBS_B, VSUBS_H, VSUBUS_B, VSUBUS_H,
+    VMULS_H,
+    VCMP_EQ_B, VCMP_EQ_H, VCMP_NE_B, VCMP_NE_H,
+    VCMP_GT_B, VCMP_GT_H, VCMP_GE_B, VCMP_GE_H,
+    VCMP_LT_B, VCMP_LT_H, VCMP_LE_B, VCMP_LE_H,
+    VALL_EQ_B, VALL_EQ_H, VALL_NE_B, VALL_NE_H,
+    VALL_GT_B, VALL_GT_H, VALL_GE_B, VALL_GE_H,
+    VALL_LT_B, VALL_LT_H, VALL_LE_B, VALL_LE_H,
+    VANY_EQ_B, VANY_EQ_H, VANY_NE_B, VANY_NE_H,
+    VANY_GT_B, VANY_GT_H, VANY_GE_B, VANY_GE_H,
+    VANY_LT_B, VANY_LT_H, VANY_LE_B, VANY_LE_H,
+
     /* TODO: add other operations as necessary */
 };
 
+/* ALU operation of the vector instruction (major opcode 0x0a) with
+ * function code "function", see InstructionDecoder::getFunction().
+ * Throws IllegalInstruction for unsupported vector instructions.
+ */
+ALUOp getVectorALUOp(uint32_t function);
+
+/* Result of the element-wise vector operations VADD_B up to VCMP_LE_H.
+ * The ALU computes it with the SSE2 instructions of the host when
+ * hasSSE2VectorOps(), and with portable code otherwise. The portable
+ * code is always available, so that rv64-emu-bench can check that both
+ * give the same results.
+ */
+bool hasSSE2VectorOps();
+RegValue getVectorResult(ALUOp op, RegValue A, RegValue B);
+RegValue getScalarVectorResult(ALUOp op, RegValue A, RegValue B);
+
 
 /* The ALU component performs the specified operation on operands A and B
  * when asked to propagate the result. The operation is specified through
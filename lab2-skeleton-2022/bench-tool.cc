@@ -0,0 +1,1185 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    bench-tool.cc - Microbenchmarks of emulator components.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "alu.h"
+#include "dma.h"
+#include "fpu.h"
+#include "idle-loop.h"
+#include "pixel-convert.h"
+#include "inst-decoder.h"
+#include "interrupt-controller.h"
+#include "memory.h"
+#include "memory-bus.h"
+#include "mux.h"
+#include "reg-file.h"
+#include "serial.h"
+#include "stages.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <cfenv>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include "XGetopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#ifdef _MSC_VER
+/* Defined *somewhere* */
+#undef AbnormalTermination
+#endif
+
+
+struct BenchOptions
+{
+  double minSeconds = 0.2;
+  std::string filter{};
+};
+
+/* Timing of the runs of a benchmark, in nanoseconds per run. */
+struct Measurement
+{
+  double best = 0.0;
+  double median = 0.0;
+  double iqr = 0.0;       /* interquartile range */
+  size_t runs = 0;
+};
+
+/* Runs body repeatedly for at least minSeconds and MinRuns times. The
+ * fastest run filters out interruptions by other processes, the
+ * median and interquartile range show how noisy the measurement is.
+ */
+static Measurement
+measure(const std::function<void()> &body, double minSeconds)
+{
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t MinRuns = 5;
+
+  std::vector<double> samples;
+  const auto deadline = Clock::now() +
+      std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(minSeconds));
+
+  /* Warm up caches and the branch predictor */
+  body();
+
+  do
+    {
+      const auto start = Clock::now();
+      body();
+      samples.push_back(
+          std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+  while (Clock::now() < deadline || samples.size() < MinRuns);
+
+  Measurement m;
+  m.runs = samples.size();
+  std::sort(samples.begin(), samples.end());
+  m.best = samples.front();
+  m.median = samples[samples.size() / 2];
+  m.iqr = samples[samples.size() * 3 / 4] - samples[samples.size() / 4];
+
+  return m;
+}
+
+static void
+printHeader(const char *unit)
+{
+  std::cout << std::left << std::setw(28) << "benchmark"
+            << std::setw(10) << "variant" << std::right
+            << std::setw(14) << "time (us)"
+            << std::setw(14) << unit
+            << std::setw(10) << "speedup" << std::endl;
+}
+
+static void
+printResult(const std::string &name, const std::string &variant,
+            double nanoseconds, double throughput, double baseline)
+{
+  std::cout << std::left << std::setw(28) << name
+            << std::setw(10) << variant << std::right << std::fixed
+            << std::setprecision(1)
+            << std::setw(14) << nanoseconds / 1000.0
+            << std::setw(14) << throughput
+            << std::setprecision(2)
+            << std::setw(9) << baseline / nanoseconds << "x"
+            << std::defaultfloat << std::endl;
+}
+
+
+/*
+ * Framebuffer pixel conversion
+ */
+
+static void
+benchPixelConversion(const BenchOptions &options)
+{
+  struct Resolution
+  {
+    const char *name;
+    uint32_t resx;
+    uint32_t resy;
+  };
+
+  static const Resolution resolutions[] =
+  {
+    { "1080p", 1920, 1080 },
+    { "4k", 3840, 2160 }
+  };
+
+  std::mt19937 random{ 42 };
+  bool headerPrinted = false;
+
+  uint32_t palette[256];
+  for (auto &entry : palette)
+    entry = random();
+
+  for (const auto &resolution : resolutions)
+    {
+      const size_t nPixels = size_t{ resolution.resx } * resolution.resy;
+      std::vector<uint8_t> src(nPixels);
+      std::vector<uint32_t> dst(nPixels);
+      for (auto &pixel : src)
+        pixel = random();
+
+      for (const char *mode : { "y8", "indexed" })
+        {
+          const std::string name = std::string("pixel.") + mode + "." +
+              resolution.name;
+          if (name.find(options.filter) == std::string::npos)
+            continue;
+
+          const bool indexed = mode == std::string("indexed");
+          double baseline = 0.0;
+
+          for (size_t k = 0; k < static_cast<size_t>(PixelKernel::LAST); ++k)
+            {
+              const auto kernel = static_cast<PixelKernel>(k);
+              if (! isPixelKernelSupported(kernel))
+                continue;
+
+              const PixelConversion &convert = getPixelConversion(kernel);
+
+              /* Convert a frame a row at a time, like the framebuffer */
+              auto frame = [&]()
+                {
+                  for (uint32_t y = 0; y < resolution.resy; ++y)
+                    {
+                      const size_t offset = size_t{ y } * resolution.resx;
+                      if (indexed)
+                        convert.indexed(&src[offset], &dst[offset],
+                                        resolution.resx, palette);
+                      else
+                        convert.y8(&src[offset], &dst[offset],
+                                   resolution.resx);
+                    }
+                };
+
+              const double ns = measure(frame, options.minSeconds).best;
+              if (kernel == PixelKernel::Scalar)
+                baseline = ns;
+
+              if (! headerPrinted)
+                {
+                  printHeader("Mpixel/s");
+                  headerPrinted = true;
+                }
+              printResult(name, getPixelKernelName(kernel), ns,
+                          nPixels / (ns / 1000.0), baseline);
+            }
+        }
+    }
+}
+
+/*
+ * Emulator components
+ *
+ * Every benchmark performs a fixed number of operations per run on
+ * inputs generated up front, and reports the time per operation.
+ */
+
+static constexpr size_t OpsPerRun = 4096;
+
+/* Results are accumulated into this, so that the compiler cannot
+ * remove the operations being measured.
+ */
+static volatile uint64_t sink;
+
+static void
+printOpResult(const std::string &name, const Measurement &m)
+{
+  static bool headerPrinted = false;
+  if (! headerPrinted)
+    {
+      std::cout << std::endl << std::left << std::setw(28) << "benchmark"
+                << std::right << std::setw(10) << "ns/op"
+                << std::setw(10) << "median"
+                << std::setw(10) << "iqr"
+                << std::setw(8) << "runs" << std::endl;
+      headerPrinted = true;
+    }
+
+  std::cout << std::left << std::setw(28) << name << std::right
+            << std::fixed << std::setprecision(2)
+            << std::setw(10) << m.best / OpsPerRun
+            << std::setw(10) << m.median / OpsPerRun
+            << std::setprecision(1)
+            << std::setw(9) << 100.0 * m.iqr / m.median << "%"
+            << std::setw(8) << m.runs
+            << std::defaultfloat << std::endl;
+}
+
+static void
+runOps(const BenchOptions &options, const std::string &name,
+       const std::function<void()> &body)
+{
+  if (name.find(options.filter) == std::string::npos)
+    return;
+
+  printOpResult(name, measure(body, options.minSeconds));
+}
+
+static std::unique_ptr<Memory>
+makeMemory(MemAddress base, size_t size)
+{
+  static constexpr size_t align = 8;
+
+  /* Allocated like the memories of ELF sections, which Memory frees */
+  auto *data = new (std::align_val_t{ align }, std::nothrow) std::byte[size];
+  if (!data)
+    throw std::bad_alloc();
+  std::fill_n(data, size, std::byte{ 0 });
+
+  auto memory = std::make_unique<Memory>("bench", data, base, size, align);
+  memory->setMayWrite(true);
+  return memory;
+}
+
+/* Word-aligned random addresses within [base, base + size) */
+static std::vector<MemAddress>
+randomAddresses(std::mt19937 &random, MemAddress base, size_t size)
+{
+  std::vector<MemAddress> addresses(OpsPerRun);
+  for (auto &addr : addresses)
+    addr = base + (random() % size & ~size_t{ 7 });
+  return addresses;
+}
+
+/* Routing of word accesses through the memory bus. The accesses are
+ * spread over all clients; a client further down the list is slower to
+ * find.
+ */
+static void
+benchMemoryBus(const BenchOptions &options)
+{
+  static constexpr MemAddress ClientBase = 0x100000;
+  static constexpr size_t ClientSize = 0x10000;
+
+  std::mt19937 random{ 42 };
+
+  for (size_t nClients : { 1, 4, 16 })
+    {
+      std::vector<std::unique_ptr<MemoryInterface> > clients;
+      for (size_t i = 0; i < nClients; ++i)
+        clients.push_back(makeMemory(ClientBase + i * ClientSize, ClientSize));
+      MemoryBus bus(std::move(clients));
+
+      const auto addresses =
+          randomAddresses(random, ClientBase, nClients * ClientSize);
+      const std::string suffix = "." + std::to_string(nClients);
+
+      runOps(options, "bus.read" + suffix, [&]()
+        {
+          uint64_t sum = 0;
+          for (MemAddress addr : addresses)
+            sum += bus.readWord(addr);
+          sink = sum;
+        });
+
+      runOps(options, "bus.write" + suffix, [&]()
+        {
+          uint32_t value = 0;
+          for (MemAddress addr : addresses)
+            bus.writeWord(addr, value++);
+        });
+    }
+}
+
+/* Memory::readData and writeData, including the conversion from and to
+ * big endian.
+ */
+static void
+benchMemory(const BenchOptions &options)
+{
+  static constexpr MemAddress Base = 0x10000;
+  static constexpr size_t Size = 0x10000;
+
+  std::mt19937 random{ 42 };
+  auto memory = makeMemory(Base, Size);
+  const auto addresses = randomAddresses(random, Base, Size);
+
+  runOps(options, "memory.read.byte", [&]()
+    {
+      uint64_t sum = 0;
+      for (MemAddress addr : addresses)
+        sum += memory->readByte(addr);
+      sink = sum;
+    });
+  runOps(options, "memory.read.half", [&]()
+    {
+      uint64_t sum = 0;
+      for (MemAddress addr : addresses)
+        sum += memory->readHalfWord(addr);
+      sink = sum;
+    });
+  runOps(options, "memory.read.word", [&]()
+    {
+      uint64_t sum = 0;
+      for (MemAddress addr : addresses)
+        sum += memory->readWord(addr);
+      sink = sum;
+    });
+  runOps(options, "memory.read.double", [&]()
+    {
+      uint64_t sum = 0;
+      for (MemAddress addr : addresses)
+        sum += memory->readDoubleWord(addr);
+      sink = sum;
+    });
+
+  runOps(options, "memory.write.byte", [&]()
+    {
+      uint8_t value = 0;
+      for (MemAddress addr : addresses)
+        memory->writeByte(addr, value++);
+    });
+  runOps(options, "memory.write.half", [&]()
+    {
+      uint16_t value = 0;
+      for (MemAddress addr : addresses)
+        memory->writeHalfWord(addr, value++);
+    });
+  runOps(options, "memory.write.word", [&]()
+    {
+      uint32_t value = 0;
+      for (MemAddress addr : addresses)
+        memory->writeWord(addr, value++);
+    });
+  runOps(options, "memory.write.double", [&]()
+    {
+      uint64_t value = 0;
+      for (MemAddress addr : addresses)
+        memory->writeDoubleWord(addr, value++);
+    });
+}
+
+/* Decoding and disassembling a stream of random instruction words */
+static void
+benchDecoder(const BenchOptions &options)
+{
+  std::mt19937 random{ 42 };
+  std::vector<uint32_t> words(OpsPerRun);
+  for (auto &word : words)
+    word = random();
+
+  InstructionDecoder decoder;
+
+  runOps(options, "decoder.decode", [&]()
+    {
+      uint64_t sum = 0;
+      for (uint32_t word : words)
+        {
+          decoder.setInstructionWord(word);
+          sum += static_cast<uint64_t>(decoder.getOpcodeID()) +
+                 decoder.getA() + decoder.getB() + decoder.getD() +
+                 decoder.getFunction();
+        }
+      sink = sum;
+    });
+
+  std::ostringstream os;
+  runOps(options, "decoder.format", [&]()
+    {
+      os.str("");
+      for (uint32_t word : words)
+        {
+          decoder.setInstructionWord(word);
+          os << decoder << '\n';
+        }
+      sink = os.tellp();
+    });
+}
+
+/* Register file port patterns: both read ports, the write port, and a
+ * read-read-write cycle like an ALU instruction.
+ */
+static void
+benchRegisterFile(const BenchOptions &options)
+{
+  std::mt19937 random{ 42 };
+  std::vector<RegNumber> regs(OpsPerRun * 3);
+  for (auto &reg : regs)
+    reg = random() % NumRegs;
+
+  RegisterFile regfile;
+
+  runOps(options, "regfile.read", [&]()
+    {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < OpsPerRun; ++i)
+        {
+          regfile.setRS1(regs[2 * i]);
+          regfile.setRS2(regs[2 * i + 1]);
+          sum += regfile.getReadData1() + regfile.getReadData2();
+        }
+      sink = sum;
+    });
+
+  runOps(options, "regfile.write", [&]()
+    {
+      regfile.setWriteEnable(true);
+      for (size_t i = 0; i < OpsPerRun; ++i)
+        {
+          regfile.setRD(regs[i]);
+          regfile.setWriteData(i);
+          regfile.clockPulse();
+        }
+    });
+
+  runOps(options, "regfile.readwrite", [&]()
+    {
+      regfile.setWriteEnable(true);
+      for (size_t i = 0; i < OpsPerRun; ++i)
+        {
+          regfile.setRS1(regs[3 * i]);
+          regfile.setRS2(regs[3 * i + 1]);
+          regfile.setRD(regs[3 * i + 2]);
+          regfile.setWriteData(regfile.getReadData1() +
+                               regfile.getReadData2());
+          regfile.clockPulse();
+        }
+      sink = regfile.getReadData1();
+    });
+}
+
+/* Mux with a random selector every operation */
+static void
+benchMux(const BenchOptions &options)
+{
+  enum class Input { A, B, C, D, LAST };
+
+  std::mt19937 random{ 42 };
+  std::vector<Input> selectors(OpsPerRun);
+  for (auto &selector : selectors)
+    selector = static_cast<Input>(random() % static_cast<int>(Input::LAST));
+
+  Mux<RegValue, Input> mux;
+  mux.setInput(Input::A, 1);
+  mux.setInput(Input::B, 2);
+  mux.setInput(Input::C, 3);
+  mux.setInput(Input::D, 4);
+  mux.setSelector(Input::A);
+
+  runOps(options, "mux.select", [&]()
+    {
+      uint64_t sum = 0;
+      for (Input selector : selectors)
+        {
+          mux.setSelector(selector);
+          sum += mux.getOutput();
+        }
+      sink = sum;
+    });
+}
+
+
+/*
+ * Self-checks
+ */
+
+/* The SSE2 vector operations of the ALU must give the same results as
+ * the portable code, on the element boundary values and on random
+ * operands. Returns the number of mismatches, the first few of which
+ * are printed.
+ */
+static size_t
+checkVectorALU()
+{
+  static constexpr size_t RandomPairs = 100000;
+  static constexpr size_t MaxReported = 10;
+
+  if (! hasSSE2VectorOps())
+    return 0;
+
+  std::vector<RegValue> values;
+  for (uint8_t a : { 0x00, 0x01, 0x7f, 0x80, 0x81, 0xff })
+    for (uint8_t b : { 0x00, 0x01, 0x7f, 0x80, 0x81, 0xff })
+      values.push_back(a * 0x01000000u + b * 0x00010000u +
+                       b * 0x00000100u + a);
+
+  std::mt19937 random{ 42 };
+  std::vector<std::pair<RegValue, RegValue>> pairs;
+  for (RegValue A : values)
+    for (RegValue B : values)
+      pairs.emplace_back(A, B);
+  for (size_t i = 0; i < RandomPairs; ++i)
+    pairs.emplace_back(random(), random());
+
+  size_t mismatches = 0;
+  for (int op = static_cast<int>(ALUOp::VADD_B);
+       op <= static_cast<int>(ALUOp::VCMP_LE_H); ++op)
+    for (const auto &[A, B] : pairs)
+      {
+        const RegValue expected =
+            getScalarVectorResult(static_cast<ALUOp>(op), A, B);
+        const RegValue result = getVectorResult(static_cast<ALUOp>(op), A, B);
+        if (result == expected)
+          continue;
+
+        if (++mismatches <= MaxReported)
+          std::cerr << "Error: vector ALU op " << op << std::hex
+                    << std::showbase << " on " << A << ", " << B
+                    << ": SSE2 " << result << ", scalar " << expected
+                    << std::dec << std::noshowbase << std::endl;
+      }
+
+  return mismatches;
+}
+
+/* Every vector pixel kernel supported by the host must give the same
+ * results as the scalar kernel: for all 256 Y8 values and for random
+ * indexed rows with a random palette, at widths that leave a tail after
+ * the last full vector, without writing past the end of the row.
+ * Returns the number of mismatches.
+ */
+static size_t
+checkPixelConversion()
+{
+  static constexpr size_t Widths[] =
+    { 0, 1, 3, 4, 5, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 256, 263 };
+  static constexpr uint32_t Guard = 0xdeadbeef;
+  static constexpr size_t GuardPixels = 32;
+
+  std::mt19937 random{ 42 };
+
+  uint32_t palette[256];
+  for (auto &entry : palette)
+    entry = random();
+
+  const PixelConversion &scalar = getPixelConversion(PixelKernel::Scalar);
+  size_t mismatches = 0;
+
+  for (size_t k = 0; k < static_cast<size_t>(PixelKernel::LAST); ++k)
+    {
+      const auto kernel = static_cast<PixelKernel>(k);
+      if (kernel == PixelKernel::Scalar || ! isPixelKernelSupported(kernel))
+        continue;
+
+      const PixelConversion &convert = getPixelConversion(kernel);
+
+      for (size_t width : Widths)
+        for (const char *mode : { "y8", "indexed" })
+          {
+            const bool indexed = mode == std::string("indexed");
+
+            /* Y8 rows cycle through all values, from a different start
+             * for every width.
+             */
+            std::vector<uint8_t> src(width);
+            for (size_t i = 0; i < width; ++i)
+              src[i] = indexed ? random() : width + i;
+
+            std::vector<uint32_t> expected(width + GuardPixels, Guard);
+            std::vector<uint32_t> result(width + GuardPixels, Guard);
+            if (indexed)
+              {
+                scalar.indexed(src.data(), expected.data(), width, palette);
+                convert.indexed(src.data(), result.data(), width, palette);
+              }
+            else
+              {
+                scalar.y8(src.data(), expected.data(), width);
+                convert.y8(src.data(), result.data(), width);
+              }
+
+            if (result == expected)
+              continue;
+
+            const size_t i = std::mismatch(result.begin(), result.end(),
+                                           expected.begin()).first -
+                result.begin();
+            std::cerr << "Error: " << getPixelKernelName(kernel) << " "
+                      << mode << " kernel at width " << width
+                      << ", pixel " << i << ": " << std::hex
+                      << std::showbase << result[i] << ", scalar "
+                      << expected[i] << std::dec << std::noshowbase
+                      << std::endl;
+            ++mismatches;
+          }
+    }
+
+  return mismatches;
+}
+
+/* The FPU on known IEEE 754 results: rounding in every mode, the FPCSR
+ * flags raised by every operation, conversions of values out of range,
+ * single rounding of lf.madd.s, and the flags being sticky. Returns the
+ * number of failures.
+ */
+static size_t
+checkFPU()
+{
+  static constexpr RegValue One = 0x3f800000;
+  static constexpr RegValue MinusOne = 0xbf800000;
+  static constexpr RegValue Two = 0x40000000;
+  static constexpr RegValue Three = 0x40400000;
+  static constexpr RegValue Zero = 0x00000000;
+  static constexpr RegValue Infinity = 0x7f800000;
+  static constexpr RegValue FloatMax = 0x7f7fffff;
+  static constexpr RegValue Tiny = 0x0da24260;          /* 1e-30 */
+  static constexpr RegValue QuietNaN = 0x7fc00000;
+  static constexpr RegValue SignalingNaN = 0x7fa00000;
+  static constexpr RegValue AnyNaN = 0xffffffff;        /* any NaN result */
+  static constexpr RegValue OnePlusUlp12 = 0x3f800800;  /* 1 + 2^-12 */
+
+  enum : uint32_t
+  {
+    RNE = FPU::RoundNearest, RTZ = FPU::RoundZero,
+    RUP = FPU::RoundUp, RDN = FPU::RoundDown
+  };
+  enum : uint32_t
+  {
+    OVF = FPU::FPCSR_OVF, UNF = FPU::FPCSR_UNF, SNF = FPU::FPCSR_SNF,
+    QNF = FPU::FPCSR_QNF, ZF = FPU::FPCSR_ZF, IXF = FPU::FPCSR_IXF,
+    IVF = FPU::FPCSR_IVF, INF = FPU::FPCSR_INF, DZF = FPU::FPCSR_DZF
+  };
+
+  struct Case
+  {
+    const char *name;
+    FPUOp op;
+    uint32_t mode;
+    RegValue A, B, D;
+    RegValue result;
+    uint32_t flags;
+  };
+
+  static const Case cases[] =
+  {
+    { "1/3", FPUOp::Div, RNE, One, Three, 0, 0x3eaaaaab, IXF },
+    { "1/3", FPUOp::Div, RTZ, One, Three, 0, 0x3eaaaaaa, IXF },
+    { "1/3", FPUOp::Div, RUP, One, Three, 0, 0x3eaaaaab, IXF },
+    { "1/3", FPUOp::Div, RDN, One, Three, 0, 0x3eaaaaaa, IXF },
+    { "-1/3", FPUOp::Div, RTZ, MinusOne, Three, 0, 0xbeaaaaaa, IXF },
+    { "-1/3", FPUOp::Div, RUP, MinusOne, Three, 0, 0xbeaaaaaa, IXF },
+    { "-1/3", FPUOp::Div, RDN, MinusOne, Three, 0, 0xbeaaaaab, IXF },
+    { "1+2", FPUOp::Add, RNE, One, Two, 0, Three, 0 },
+    { "1-1", FPUOp::Sub, RNE, One, One, 0, Zero, ZF },
+    { "0/0", FPUOp::Div, RNE, Zero, Zero, 0, AnyNaN, IVF | QNF },
+    { "1/0", FPUOp::Div, RNE, One, Zero, 0, Infinity, DZF | INF },
+    { "FLT_MAX*2", FPUOp::Mul, RNE, FloatMax, Two, 0, Infinity,
+      OVF | IXF | INF },
+    { "FLT_MAX*2", FPUOp::Mul, RTZ, FloatMax, Two, 0, FloatMax, OVF | IXF },
+    { "1e-30*1e-30", FPUOp::Mul, RNE, Tiny, Tiny, 0, Zero, UNF | IXF | ZF },
+    { "qNaN+1", FPUOp::Add, RNE, QuietNaN, One, 0, AnyNaN, QNF },
+    { "sNaN+1", FPUOp::Add, RNE, SignalingNaN, One, 0, AnyNaN,
+      SNF | IVF | QNF },
+    { "1+sNaN", FPUOp::Add, RNE, One, SignalingNaN, 0, AnyNaN,
+      SNF | IVF | QNF },
+    { "ftoi(2.5)", FPUOp::FloatToInt, RNE, 0x40200000, 0, 0, 2, IXF },
+    { "ftoi(2.5)", FPUOp::FloatToInt, RUP, 0x40200000, 0, 0, 3, IXF },
+    { "ftoi(-2.5)", FPUOp::FloatToInt, RDN, 0xc0200000, 0, 0, 0xfffffffd,
+      IXF },
+    { "ftoi(-2.5)", FPUOp::FloatToInt, RTZ, 0xc0200000, 0, 0, 0xfffffffe,
+      IXF },
+    { "ftoi(NaN)", FPUOp::FloatToInt, RNE, QuietNaN, 0, 0, 0x80000000, IVF },
+    { "ftoi(3e9)", FPUOp::FloatToInt, RNE, 0x4f32d05e, 0, 0, 0x80000000,
+      IVF },
+    { "ftoi(-3e9)", FPUOp::FloatToInt, RNE, 0xcf32d05e, 0, 0, 0x80000000,
+      IVF },
+    { "itof(2^24+1)", FPUOp::IntToFloat, RNE, 0x01000001, 0, 0, 0x4b800000,
+      IXF },
+    { "itof(2^24+1)", FPUOp::IntToFloat, RUP, 0x01000001, 0, 0, 0x4b800001,
+      IXF },
+    /* (1 + 2^-12)^2 - 1 is exact when rounded once, 2^-11 otherwise */
+    { "madd", FPUOp::MulAdd, RNE, OnePlusUlp12, OnePlusUlp12, MinusOne,
+      0x3a000400, 0 },
+    { "sfeq(qNaN,1)", FPUOp::SetFlagEQ, RNE, QuietNaN, One, 0, 0, 0 },
+    { "sfne(qNaN,1)", FPUOp::SetFlagNE, RNE, QuietNaN, One, 0, 1, 0 },
+    { "sflt(qNaN,1)", FPUOp::SetFlagLT, RNE, QuietNaN, One, 0, 0, IVF },
+    { "sfgt(2,1)", FPUOp::SetFlagGT, RNE, Two, One, 0, 1, 0 },
+  };
+
+  static const char *const modeNames[] = { "RNE", "RTZ", "RUP", "RDN" };
+
+  size_t failures = 0;
+  auto report = [&failures](const std::string &what, uint64_t value,
+                            uint64_t expected)
+    {
+      std::cerr << "Error: FPU: " << what << " is " << std::hex
+                << std::showbase << value << ", expected " << expected
+                << std::dec << std::noshowbase << std::endl;
+      ++failures;
+    };
+
+  for (const auto &test : cases)
+    {
+      FPU fpu;
+      fpu.setFPCSR(test.mode << FPU::FPCSR_RM_SHIFT);
+      const RegValue result = fpu.execute(test.op, test.A, test.B, test.D);
+      const uint32_t flags = fpu.getFPCSR() & FPU::FPCSR_FLAGS;
+
+      const std::string name = std::string(test.name) + " (" +
+          modeNames[test.mode] + ")";
+      const bool isNaN = (result & 0x7fffffff) > Infinity;
+      if (test.result == AnyNaN ? ! isNaN : result != test.result)
+        report(name, result, test.result);
+      if (flags != test.flags)
+        report(name + " flags", flags, test.flags);
+    }
+
+  /* Flags accumulate until software clears them, an exception is only
+   * pending for the flags raised by the last operation.
+   */
+  FPU fpu;
+  fpu.setFPCSR(FPU::FPCSR_FPEE);
+  fpu.execute(FPUOp::Div, One, Zero);
+  if (! fpu.exceptionPending())
+    report("exception pending after 1/0", 0, 1);
+  fpu.execute(FPUOp::Add, One, Two);
+  if (fpu.exceptionPending())
+    report("exception pending after 1+2", 1, 0);
+  if ((fpu.getFPCSR() & FPU::FPCSR_FLAGS) != (DZF | INF))
+    report("sticky flags after 1/0, 1+2", fpu.getFPCSR() & FPU::FPCSR_FLAGS,
+           DZF | INF);
+
+  /* The host rounding mode is restored */
+  fpu.setFPCSR(RUP << FPU::FPCSR_RM_SHIFT);
+  fpu.execute(FPUOp::Div, One, Three);
+  if (std::fegetround() != FE_TONEAREST)
+    report("host rounding mode after RUP", std::fegetround(), FE_TONEAREST);
+
+  return failures;
+}
+
+/* The idle loop detector on synthetic streams of retired instructions:
+ * a polling loop must become steady, unless it stores, reads the serial
+ * data register, or executes l.sys, l.rfe or l.mtspr. Loops longer than
+ * MaxLoopLength are only detected with the idle hint. Returns the
+ * number of failures.
+ */
+static size_t
+checkIdleLoopDetector()
+{
+  static constexpr MemAddress SerialBase = 0x200;
+  static constexpr MemAddress LoopPC = 0x1000;
+  static constexpr MemAddress StatusAddress = 0x2000;
+
+  static constexpr uint32_t Nop = 0x15000000;            /* l.nop */
+  static constexpr uint32_t IdleHint = Nop | IdleLoopDetector::IdleHint;
+  static constexpr uint32_t LoadWord = 0x84640000;       /* l.lwz r3,0(r4) */
+  static constexpr uint32_t LoadByte = 0x8c640000;       /* l.lbz r3,0(r4) */
+  static constexpr uint32_t StoreWord = 0xd4051800;      /* l.sw 0(r5),r3 */
+  static constexpr uint32_t SetFlagEqual = 0xe4030000;   /* l.sfeq r3,r0 */
+  static constexpr uint32_t Sys = 0x20000000;            /* l.sys 0 */
+  static constexpr uint32_t ReturnFromException = 0x24000000;  /* l.rfe */
+  static constexpr uint32_t MoveToSPR = 0xc0002000;      /* l.mtspr r0,r4,0 */
+
+  MemoryBus bus{ std::vector<std::unique_ptr<MemoryInterface>>{} };
+  bus.addClient(std::make_unique<Serial>(SerialBase));
+
+  /* Builds a loop from "body", which ends with the loop branch and its
+   * delay slot, and returns the number of steady iterations detected
+   * in 8 iterations of one cycle per instruction.
+   */
+  auto countSteady = [&bus](std::vector<uint32_t> body)
+    {
+      const int32_t offset = -static_cast<int32_t>(body.size());
+      body.push_back(0x10000000 | (offset & 0x3ffffff));   /* l.bf loop */
+      body.push_back(Nop);
+
+      IdleLoopDetector detector{ bus };
+      uint64_t nCycles = 0;
+      size_t nSteady = 0;
+
+      for (int iteration = 0; iteration < 8; ++iteration)
+        for (size_t i = 0; i < body.size(); ++i)
+          {
+            RetiredInstruction retired{
+                static_cast<MemAddress>(LoopPC + 4 * i), body[i] };
+            switch (body[i] >> 26)
+              {
+                case LoadWord >> 26:
+                  retired.accessesMemory = true;
+                  retired.memAddress = StatusAddress;
+                  retired.writesRegister = true;
+                  retired.rd = 3;
+                  break;
+
+                case LoadByte >> 26:
+                  retired.accessesMemory = true;
+                  retired.memAddress = SerialBase;
+                  retired.writesRegister = true;
+                  retired.rd = 3;
+                  break;
+
+                case StoreWord >> 26:
+                  retired.accessesMemory = true;
+                  retired.memoryWrite = true;
+                  retired.memAddress = StatusAddress + 4;
+                  break;
+              }
+
+            if (detector.retire(retired, ++nCycles) ==
+                IdleLoopDetector::Event::SteadyIteration)
+              ++nSteady;
+          }
+
+      return nSteady;
+    };
+
+  struct Case
+  {
+    const char *name;
+    std::vector<uint32_t> body;
+    bool idle;
+  };
+
+  std::vector<uint32_t> hinted{ IdleHint, LoadWord };
+  hinted.insert(hinted.end(), IdleLoopDetector::MaxLoopLength, Nop);
+  hinted.push_back(SetFlagEqual);
+  std::vector<uint32_t> unhinted(hinted);
+  unhinted.front() = Nop;
+
+  const Case cases[] =
+  {
+    { "polling loop", { LoadWord, SetFlagEqual }, true },
+    { "loop without loads", { SetFlagEqual }, false },
+    { "loop with a store", { LoadWord, StoreWord, SetFlagEqual }, false },
+    { "loop reading serial data", { LoadByte, SetFlagEqual }, false },
+    { "loop with l.sys", { LoadWord, Sys, SetFlagEqual }, false },
+    { "loop with l.rfe", { LoadWord, ReturnFromException, SetFlagEqual },
+      false },
+    { "loop with l.mtspr", { LoadWord, MoveToSPR, SetFlagEqual }, false },
+    { "long loop with idle hint", hinted, true },
+    { "long loop without idle hint", unhinted, false },
+  };
+
+  size_t failures = 0;
+  for (const auto &test : cases)
+    {
+      const size_t nSteady = countSteady(test.body);
+      if ((nSteady > 0) == test.idle)
+        continue;
+
+      std::cerr << "Error: idle loop detector: " << test.name << " is "
+                << (test.idle ? "not " : "") << "detected as idle"
+                << std::endl;
+      ++failures;
+    }
+
+  return failures;
+}
+
+/* A stall driven in decode must be charged to the stalled instruction
+ * when its bubble reaches write back, and the instruction itself must
+ * retire once afterwards. Returns the number of failures.
+ */
+static size_t
+checkStallAttribution()
+{
+  static constexpr uint32_t LoadWord = 0x84640000;  /* l.lwz r3,0(r4) */
+  static constexpr MemAddress LoadPC = 0x1000;
+
+  IF_IDRegisters if_id;
+  ID_EXRegisters id_ex;
+  EX_MRegisters ex_m;
+  M_WBRegisters m_wb;
+
+  MemoryBus bus{ std::vector<std::unique_ptr<MemoryInterface>>{} };
+  RegisterFile regfile;
+  InstructionDecoder decoder;
+  FPU fpu;
+  bool flag = false;
+  ExceptionUnit exceptions(flag, fpu);
+  CommitRedirect redirect;
+  InstructionProfile profile;
+  RetiredInstruction retired;
+  uint64_t nInstrIssued = 0, nStalls = 0, nInstrCompleted = 0;
+
+  InstructionDecodeStage decode(true, if_id, id_ex, regfile, decoder,
+                                nInstrIssued, nStalls);
+  ExecuteStage execute(true, id_ex, ex_m, fpu);
+  MemoryStage memory(true, ex_m, m_wb, DataMemory{ bus });
+  WriteBackStage writeBack(true, m_wb, regfile, flag, exceptions, redirect,
+                           nInstrCompleted, profile, retired);
+  Stage *stages[] = { &decode, &execute, &memory, &writeBack };
+
+  /* The load stalls for one cycle in decode, then proceeds and is
+   * followed by bubbles.
+   */
+  if_id.PC = LoadPC;
+  if_id.instructionWord = LoadWord;
+  for (int cycle = 0; cycle < 6; ++cycle)
+    {
+      for (Stage *stage : stages)
+        stage->propagate();
+      decode.setStalled(cycle == 0);
+      for (Stage *stage : stages)
+        stage->clockPulse();
+
+      if (cycle == 1)
+        if_id = IF_IDRegisters{};
+    }
+
+  decoder.setInstructionWord(LoadWord);
+  const OpcodeID load = decoder.getOpcodeID();
+
+  size_t failures = 0;
+  auto expect = [&failures](const char *what, uint64_t value,
+                            uint64_t expected)
+    {
+      if (value == expected)
+        return;
+
+      std::cerr << "Error: stall attribution: " << what << " is " << value
+                << ", expected " << expected << std::endl;
+      ++failures;
+    };
+
+  expect("stall cycles", nStalls, 1);
+  expect("stalls charged to l.lwz", profile.getStalls(load), 1);
+  expect("retired l.lwz", profile.getCount(load), 1);
+  expect("retired instructions", nInstrCompleted, 1);
+
+  return failures;
+}
+
+/* DMA controller transfers through the guest-visible registers: a copy
+ * with interrupt, a fill, a copy that spans two memories, the cost of
+ * a transfer of almost 4 GiB, and writes while busy. Returns the number
+ * of failures.
+ */
+static size_t
+checkDMA()
+{
+  static constexpr MemAddress DMABase = 0x300;
+  static constexpr MemAddress PICBase = 0x340;
+  static constexpr unsigned int DMALine = 4;
+
+  enum : uint32_t
+  {
+    Source = DMABase + 0x00, Destination = DMABase + 0x04,
+    Length = DMABase + 0x08, FillValue = DMABase + 0x0c,
+    Control = DMABase + 0x10, Status = DMABase + 0x14
+  };
+  enum : uint32_t { Start = 1, Fill = 2, Interrupt = 4 };
+  enum : uint32_t { Busy = 1, Done = 2, Error = 4 };
+
+  /* Two adjacent memories of 4 KiB */
+  MemoryBus bus{ std::vector<std::unique_ptr<MemoryInterface>>{} };
+  bus.addClient(makeMemory(0x10000, 0x1000));
+  bus.addClient(makeMemory(0x11000, 0x1000));
+
+  InterruptController pic(PICBase);
+  DMAController dma(DMABase, bus);
+  dma.connectInterrupt(InterruptLine{ pic, DMALine });
+
+  size_t failures = 0;
+  auto expect = [&failures](const std::string &what, uint64_t value,
+                            uint64_t expected)
+    {
+      if (value == expected)
+        return;
+
+      std::cerr << "Error: DMA: " << what << " is " << std::hex
+                << std::showbase << value << ", expected " << expected
+                << std::dec << std::noshowbase << std::endl;
+      ++failures;
+    };
+
+  /* Runs the transfer to completion, returns the bus cycles taken */
+  auto run = [&dma]()
+    {
+      uint64_t cycles = 0;
+      while (dma.readWord(Status) & Busy)
+        {
+          dma.clockPulse();
+          ++cycles;
+        }
+      return cycles;
+    };
+
+  for (uint32_t i = 0; i < 100; ++i)
+    bus.writeByte(0x10000 + i, i * 7);
+
+  /* Copy with interrupt: 8 setup cycles plus 13 for 100 bytes */
+  dma.writeWord(Source, 0x10000);
+  dma.writeWord(Destination, 0x10800);
+  dma.writeWord(Length, 100);
+  dma.writeWord(Control, Start | Interrupt);
+  expect("status during copy", dma.readWord(Status), Busy);
+
+  bool rejected = false;
+  try
+    {
+      dma.writeWord(Length, 4);
+    }
+  catch (IllegalAccess &)
+    {
+      rejected = true;
+    }
+  expect("write during copy rejected", rejected, true);
+  expect("length after rejected write", dma.readWord(Length), 100);
+
+  expect("copy cycles", run(), 8 + 13);
+  expect("status after copy", dma.readWord(Status), Done);
+  expect("interrupt line after copy", pic.readWord(PICBase + 0x4),
+         1u << DMALine);
+  for (uint32_t i = 0; i < 100; ++i)
+    if (bus.readByte(0x10800 + i) != static_cast<uint8_t>(i * 7))
+      {
+        expect("copied byte " + std::to_string(i),
+               bus.readByte(0x10800 + i), static_cast<uint8_t>(i * 7));
+        break;
+      }
+
+  dma.writeWord(Status, Done);
+  expect("status after clearing done", dma.readWord(Status), 0);
+  expect("interrupt line after clearing done", pic.readWord(PICBase + 0x4),
+         0);
+
+  /* Fill without interrupt, the bytes around the block are unchanged */
+  dma.writeWord(Destination, 0x11001);
+  dma.writeWord(Length, 50);
+  dma.writeWord(FillValue, 0x1ab);
+  dma.writeWord(Control, Start | Fill);
+  run();
+  expect("status after fill", dma.readWord(Status), Done);
+  expect("interrupt line after fill", pic.readWord(PICBase + 0x4), 0);
+  expect("byte before fill", bus.readByte(0x11000), 0);
+  expect("first filled byte", bus.readByte(0x11001), 0xab);
+  expect("last filled byte", bus.readByte(0x11001 + 49), 0xab);
+  expect("byte after fill", bus.readByte(0x11001 + 50), 0);
+  dma.writeWord(Status, Done);
+
+  /* A copy that spans both memories is an error */
+  dma.writeWord(Source, 0x10f00);
+  dma.writeWord(Destination, 0x10000);
+  dma.writeWord(Length, 0x200);
+  dma.writeWord(Control, Start);
+  run();
+  expect("status after copy across memories", dma.readWord(Status),
+         Done | Error);
+  dma.writeWord(Status, Done | Error);
+
+  /* The cost of the longest transfers must not wrap around */
+  dma.writeWord(Length, 0xfffffff9);
+  dma.writeWord(Control, Start);
+  expect("idle cycles of a 4 GiB transfer", dma.getIdleCycles(),
+         8 + 0x20000000 - 1);
+
+  return failures;
+}
+
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage:" << std::endl;
+  std::cerr << progName << " [-c] [-t SECONDS] [-f FILTER]" << std::endl;
+  std::cerr <<
+R"HERE(
+    -t, runs every benchmark for at least SECONDS (default 0.2) and at
+        least five times. Reports the fastest run, and for component
+        benchmarks also the median and interquartile range per operation.
+    -f, only runs the benchmarks whose name contains FILTER.
+    -c, only runs the self-checks of the components, which are also run
+        before benchmarking. See the README for what they check.
+)HERE";
+}
+
+int
+main(int argc, char **argv)
+{
+  char c;
+  BenchOptions options;
+  bool checkOnly = false;
+  const char *progName = argv[0];
+
+  while ((c = getopt(argc, argv, "ct:f:h")) != -1)
+    {
+      switch (c)
+        {
+          case 't':
+            try
+              {
+                options.minSeconds = std::stod(optarg);
+              }
+            catch (std::exception &)
+              {
+                options.minSeconds = 0.0;
+              }
+
+            if (options.minSeconds <= 0.0)
+              {
+                std::cerr << "Error: Invalid benchmark time "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'f':
+            options.filter = optarg;
+            break;
+
+          case 'c':
+            checkOnly = true;
+            break;
+
+          case 'h':
+          default:
+            showHelp(progName);
+            return ExitCodes::HelpDisplayed;
+        }
+    }
+
+  /* Speedups are meaningless when the results differ, and benchmarks
+   * of components that do not work are as well.
+   */
+  size_t failures = checkVectorALU();
+  failures += checkPixelConversion();
+  failures += checkFPU();
+  failures += checkIdleLoopDetector();
+  failures += checkStallAttribution();
+  failures += checkDMA();
+  if (failures > 0)
+    return ExitCodes::UnitTestFailed;
+
+  if (checkOnly)
+    return ExitCodes::Success;
+
+  benchPixelConversion(options);
+
+  benchMemoryBus(options);
+  benchMemory(options);
+  benchDecoder(options);
+  benchRegisterFile(options);
+  benchMux(options);
+
+  return ExitCodes::Success;
+}
@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+
+# bench.py
+#
+# Run the benchmark kernels in the bench/ directory in all emulator modes
+# and report the host throughput as JSON. When a baseline (the JSON
+# output of an earlier run) is given, throughput regressions and changes
+# in the simulated results are reported.
+#
+# Copyright (C) 2022  Leiden University, The Netherlands
+#
+
+import os
+import sys
+import json
+import time
+import tempfile
+from pathlib import Path
+import subprocess
+
+from argparse import ArgumentParser
+try:
+    from colorama import init, Fore, Style
+    enable_color = True
+except ImportError:
+    enable_color = False
+
+# Returns posix on POSIX platform, nt on NT/Windows
+def posix_nt(posix, nt):
+    return posix if os.name == "posix" else nt
+
+
+# Wrapper functions for optional color output
+def bright(s):
+    if enable_color:
+        s = Style.BRIGHT + s + Style.RESET_ALL
+    return s
+
+def passed(s):
+    if enable_color:
+        s = Fore.GREEN + s + Style.RESET_ALL
+    return s
+
+def failed(s):
+    if enable_color:
+        s = Fore.RED + s + Style.RESET_ALL
+    return s
+
+
+if enable_color:
+    init(autoreset=True)
+
+# Emulator modes to benchmark, with their command-line arguments. Idle
+# loop fast-forwarding is enabled, except in the -plain modes, which
+# show what it gains on the polling kernels.
+MODES = {
+    "unpipelined": [],
+    "unpipelined-plain": ["-f"],
+    "pipelined": ["-p"],
+    "pipelined-plain": ["-p", "-f"],
+}
+
+# Simulated results, which must not change between runs.
+SIMULATED = ["cycles", "instructions", "output"]
+
+# Need emulator available
+RV64_EMU = Path(posix_nt("rv64-emu", "Windows\\rv64-emu.exe"))
+if not RV64_EMU.exists():
+    print("rv64-emu{} executable not available, compile it first.".format(posix_nt('', '.exe')), file=sys.stderr)
+    exit(1)
+RV64_EMU = RV64_EMU.resolve()
+
+# Parse arguments
+parser = ArgumentParser()
+parser.add_argument("-r", dest="repeat", type=int, default=3,
+                    help="Number of runs per benchmark, the fastest is reported")
+parser.add_argument("-m", dest="modes", action="append", choices=MODES.keys(),
+                    help="Only run in the given mode (can be repeated)")
+parser.add_argument("-o", dest="output", type=str,
+                    help="Write the JSON results to a file instead of standard output")
+parser.add_argument("-b", dest="baseline", type=str,
+                    help="Compare against the JSON results of an earlier run")
+parser.add_argument("-t", dest="threshold", type=float, default=5.0,
+                    help="Throughput loss in percent that counts as regression")
+parser.add_argument("--timeout", type=float, default=600,
+                    help="Timeout per run in seconds")
+parser.add_argument("kernels", type=str, nargs="*",
+                    help="Optional names of the kernels to run")
+args = parser.parse_args()
+
+# Determine which kernels to run. The kernels are checked in and rebuilt
+# from their sources with "make -C bench", which "make bench" does first.
+if args.kernels:
+    all_kernels = [Path("./bench") / (k + ".bin") for k in args.kernels]
+else:
+    all_kernels = [source.with_suffix(".bin")
+                   for source in Path("./bench").glob("*.s")]
+    all_kernels.sort()
+
+for kernel in all_kernels:
+    if not kernel.exists():
+        print("Kernel {} does not exist, build it with make -C bench".format(kernel),
+              file=sys.stderr)
+        exit(1)
+
+modes = args.modes if args.modes else list(MODES.keys())
+
+
+def run_once(kernel, mode, tmpdir):
+    """Run a kernel once, returns the result or raises RuntimeError."""
+    serial = Path(tmpdir) / "serial.txt"
+    stats = Path(tmpdir) / "stats.json"
+    cmd = [str(RV64_EMU)] + MODES[mode] + \
+          ["-o", str(serial), "-s", str(stats), str(kernel)]
+
+    start = time.perf_counter()
+    try:
+        result = subprocess.run(cmd, stdout=subprocess.DEVNULL,
+                                stderr=subprocess.PIPE, timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        raise RuntimeError("timeout after {} s".format(args.timeout))
+    wall_time = time.perf_counter() - start
+
+    if result.returncode != 0:
+        raise RuntimeError(result.stderr.decode().strip() or
+                           "exit code {}".format(result.returncode))
+
+    with stats.open() as fh:
+        counters = json.load(fh)
+
+    instructions = counters["pipeline.instructions_completed"]
+    return {
+        "wall_time": wall_time,
+        "cycles": counters["cpu.cycles"],
+        "instructions": instructions,
+        "mips": instructions / wall_time / 1e6,
+        "output": serial.read_text().strip(),
+    }
+
+
+def run(kernel, mode):
+    """Run a kernel args.repeat times and keep the fastest run."""
+    best = None
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for _ in range(args.repeat):
+            current = run_once(kernel, mode, tmpdir)
+            if best and current["output"] != best["output"]:
+                raise RuntimeError("output differs between runs")
+            if not best or current["wall_time"] < best["wall_time"]:
+                best = current
+    return best
+
+
+def compare_plain(results):
+    """Compare the fast-forwarded modes against their -plain modes,
+    which must simulate the same, returns the number of differences."""
+    differences = 0
+    for kernel, per_mode in results.items():
+        for mode, result in per_mode.items():
+            plain = per_mode.get(mode + "-plain")
+            if not plain or "error" in plain or "error" in result:
+                continue
+
+            name = "{} ({})".format(kernel, mode)
+            changed = [key for key in SIMULATED if result[key] != plain[key]]
+            if changed:
+                print(failed("CHANGED"), name, "vs plain:", ", ".join(changed),
+                      file=sys.stderr)
+                differences += 1
+            else:
+                print(passed("OK     "), name,
+                      "speedup {:.2f}x over plain".format(plain["wall_time"] / result["wall_time"]),
+                      file=sys.stderr)
+    return differences
+
+
+def compare(results, baseline):
+    """Compare results against the baseline, returns the number of
+    regressions."""
+    regressions = 0
+    for kernel, per_mode in results.items():
+        for mode, result in per_mode.items():
+            base = baseline.get(kernel, {}).get(mode)
+            if not base or "error" in base or "error" in result:
+                continue
+
+            name = "{} ({})".format(kernel, mode)
+            changed = [key for key in SIMULATED if result[key] != base[key]]
+            if changed:
+                print(failed("CHANGED"), name, ", ".join(changed),
+                      file=sys.stderr)
+                regressions += 1
+
+            change = (result["mips"] / base["mips"] - 1) * 100
+            result["baseline_mips"] = base["mips"]
+            if change < -args.threshold:
+                print(failed("SLOWER "), name,
+                      "{:.2f} -> {:.2f} MIPS ({:+.1f}%)".format(base["mips"], result["mips"], change),
+                      file=sys.stderr)
+                regressions += 1
+            else:
+                print(passed("OK     "), name,
+                      "{:.2f} -> {:.2f} MIPS ({:+.1f}%)".format(base["mips"], result["mips"], change),
+                      file=sys.stderr)
+    return regressions
+
+
+print(bright("collected {} kernels, {} modes".format(len(all_kernels), len(modes))),
+      file=sys.stderr)
+
+results = {}
+errors = 0
+for kernel in all_kernels:
+    results[kernel.stem] = {}
+    for mode in modes:
+        try:
+            result = run(kernel, mode)
+            print("{:<12} {:<18} {:>14} cycles {:>10.2f} MIPS {:>8.3f} s".format(
+                  kernel.stem, mode, result["cycles"], result["mips"], result["wall_time"]),
+                  file=sys.stderr)
+        except (RuntimeError, OSError, KeyError, ValueError) as e:
+            result = {"error": str(e)}
+            errors += 1
+            print("{:<12} {:<18} {}".format(kernel.stem, mode, failed("FAIL " + str(e))),
+                  file=sys.stderr)
+        results[kernel.stem][mode] = result
+
+print(file=sys.stderr)
+regressions = compare_plain(results)
+
+if args.baseline:
+    with open(args.baseline) as fh:
+        baseline = json.load(fh)["results"]
+    print(file=sys.stderr)
+    regressions += compare(results, baseline)
+
+report = {
+    "emulator": str(RV64_EMU),
+    "repeat": args.repeat,
+    "results": results,
+}
+
+if args.output:
+    with open(args.output, "w") as fh:
+        json.dump(report, fh, indent=2)
+        fh.write("\n")
+else:
+    json.dump(report, sys.stdout, indent=2)
+    print()
+
+exit(1 if errors or regressions else 0)
@@ -0,0 +1,44 @@
+/* Data-dependent branches: a linear congruential generator decides
+ * between three paths in every one of 1000000 iterations.
+ * Prints 6c5f1c4b.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.movhi	r3,0xf
+	l.ori	r3,r3,0x4240		/* 1000000 iterations */
+	l.movhi	r4,0x41c6
+	l.ori	r4,r4,0x4e6d		/* LCG multiplier */
+	l.ori	r5,r0,12345		/* seed */
+	l.addi	r6,r0,0
+	l.addi	r7,r0,0
+	l.addi	r8,r0,0
+loop:
+	l.mul	r5,r5,r4
+	l.addi	r5,r5,12345
+	l.srli	r11,r5,16
+	l.andi	r12,r11,1
+	l.sfeq	r12,r0
+	l.bf	1f
+	l.andi	r12,r11,2
+	l.j	next
+	l.addi	r6,r6,1
+1:	l.sfeq	r12,r0
+	l.bf	2f
+	l.nop
+	l.j	next
+	l.xor	r7,r7,r5
+2:	l.add	r8,r8,r11
+next:
+	l.addi	r3,r3,-1
+	l.sfne	r3,r0
+	l.bf	loop
+	l.nop
+	l.add	r3,r6,r7
+	l.j	exit_with_checksum
+	l.add	r3,r3,r8
+	.size	_start, .-_start
+
+	.include "common.inc"
@@ -0,0 +1,48 @@
+/* Call-heavy code: naive recursive fib(27), with the return address
+ * and arguments saved on the stack.
+ * Prints 0002ff42.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.movhi	r1,hi(stack_top)
+	l.ori	r1,r1,lo(stack_top)
+	l.jal	fib
+	l.addi	r3,r0,27
+	l.j	exit_with_checksum
+	l.addi	r3,r11,0
+	.size	_start, .-_start
+
+/* Returns fib(r3) in r11. */
+	.align 4
+	.type	fib, @function
+fib:
+	l.sflesi r3,1
+	l.bf	1f
+	l.addi	r11,r3,0
+	l.addi	r1,r1,-12
+	l.sw	0(r1),r9
+	l.sw	4(r1),r3
+	l.jal	fib
+	l.addi	r3,r3,-1
+	l.sw	8(r1),r11
+	l.lwz	r3,4(r1)
+	l.jal	fib
+	l.addi	r3,r3,-2
+	l.lwz	r4,8(r1)
+	l.add	r11,r11,r4
+	l.lwz	r9,0(r1)
+	l.addi	r1,r1,12
+1:	l.jr	r9
+	l.nop
+	.size	fib, .-fib
+
+	.include "common.inc"
+
+	.section .bss
+	.align 4
+stack:
+	.space	16384
+stack_top:
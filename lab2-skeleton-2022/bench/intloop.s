@@ -0,0 +1,33 @@
+/* Integer ALU throughput: a dependent chain of add, logic, shift and
+ * multiply instructions, 2000000 iterations.
+ * Prints c3cfcc8a.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.movhi	r3,0x1e
+	l.ori	r3,r3,0x8480		/* 2000000 iterations */
+	l.addi	r4,r0,1
+	l.addi	r5,r0,0
+	l.ori	r6,r0,0x1234
+loop:
+	l.add	r5,r5,r4
+	l.xor	r6,r6,r5
+	l.slli	r7,r6,3
+	l.sub	r6,r7,r6
+	l.mul	r8,r5,r4
+	l.srli	r7,r6,5
+	l.and	r8,r8,r7
+	l.or	r4,r4,r8
+	l.andi	r4,r4,0xff
+	l.addi	r3,r3,-1
+	l.sfne	r3,r0
+	l.bf	loop
+	l.addi	r4,r4,1
+	l.j	exit_with_checksum
+	l.xor	r3,r5,r6
+	.size	_start, .-_start
+
+	.include "common.inc"
@@ -0,0 +1,60 @@
+/* Memory streaming: b[i] = a[i] + pass over two 32 KiB arrays for 128
+ * passes, summing the stored values.
+ * Prints 03f00000.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.movhi	r10,hi(array_a)
+	l.ori	r10,r10,lo(array_a)
+	l.movhi	r12,hi(array_b)
+	l.ori	r12,r12,lo(array_b)
+	l.ori	r13,r0,8192		/* words per array */
+
+	/* a[i] = i */
+	l.addi	r4,r10,0
+	l.addi	r5,r0,0
+1:	l.sw	0(r4),r5
+	l.addi	r5,r5,1
+	l.sfne	r5,r13
+	l.bf	1b
+	l.addi	r4,r4,4
+
+	l.addi	r3,r0,0			/* sum */
+	l.addi	r7,r0,0			/* pass */
+	l.ori	r8,r0,128		/* passes */
+pass:
+	l.addi	r4,r10,0
+	l.addi	r5,r12,0
+	l.addi	r6,r13,0
+2:	l.lwz	r11,0(r4)
+	l.lwz	r14,4(r4)
+	l.add	r11,r11,r7
+	l.add	r14,r14,r7
+	l.sw	0(r5),r11
+	l.sw	4(r5),r14
+	l.add	r3,r3,r11
+	l.add	r3,r3,r14
+	l.addi	r4,r4,8
+	l.addi	r6,r6,-2
+	l.sfne	r6,r0
+	l.bf	2b
+	l.addi	r5,r5,8
+	l.addi	r7,r7,1
+	l.sfne	r7,r8
+	l.bf	pass
+	l.nop
+	l.j	exit_with_checksum
+	l.nop
+	.size	_start, .-_start
+
+	.include "common.inc"
+
+	.section .bss
+	.align 4
+array_a:
+	.space	32768
+array_b:
+	.space	32768
@@ -0,0 +1,62 @@
+/* MMIO-heavy code: 2000 lines of text written byte by byte to the
+ * serial interface, each followed by a 4 KiB DMA fill that is waited
+ * for by polling the status register.
+ * Prints 007c2270.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.ori	r10,r0,0x200		/* serial data register */
+	l.ori	r11,r0,0x300		/* DMA controller */
+	l.movhi	r12,hi(buffer)
+	l.ori	r12,r12,lo(buffer)
+	l.ori	r13,r0,2000		/* lines */
+	l.addi	r3,r0,0			/* checksum */
+	l.sw	4(r11),r12		/* destination */
+	l.ori	r4,r0,4096
+	l.sw	8(r11),r4		/* length */
+
+line:
+	l.movhi	r4,hi(message)
+	l.ori	r4,r4,lo(message)
+1:	l.lbz	r5,0(r4)
+	l.sfeq	r5,r0
+	l.bf	2f
+	l.addi	r4,r4,1
+	l.sb	0(r10),r5
+	l.j	1b
+	l.add	r3,r3,r5
+
+2:	l.sw	12(r11),r13		/* fill value */
+	l.ori	r4,r0,3
+	l.sw	16(r11),r4		/* start fill */
+3:	l.lwz	r5,20(r11)
+	l.andi	r5,r5,2
+	l.sfeq	r5,r0
+	l.bf	3b
+	l.nop
+	l.ori	r4,r0,2
+	l.sw	20(r11),r4		/* clear done */
+	l.lbz	r5,4095(r12)
+	l.xor	r3,r3,r5
+
+	l.addi	r13,r13,-1
+	l.sfne	r13,r0
+	l.bf	line
+	l.nop
+	l.j	exit_with_checksum
+	l.nop
+	.size	_start, .-_start
+
+	.include "common.inc"
+
+	.section .rodata
+message:
+	.string	"The quick brown fox jumps over the lazy dog\n"
+
+	.section .bss
+	.align 4
+buffer:
+	.space	4096
@@ -0,0 +1,459 @@
+#!/usr/bin/env python3
+
+# or1k-asm.py
+#
+# Minimal OpenRISC assembler, used to build the benchmark kernels when
+# the OpenRISC toolchain (or1k-elf-gcc) is not installed. It supports
+# the instructions and directives used by the kernels in this directory
+# and by the unit tests in tests/, and lays out the program like
+# "or1k-elf-gcc -Ttext=0x10000 -Tdata=0x11100": .text and .rodata from
+# 0x10000, .data and .bss from 0x11100. The output is a big-endian
+# ELF32 executable with section headers, which is what the emulator's
+# ELF loader uses.
+#
+# Copyright (C) 2022  Leiden University, The Netherlands
+#
+
+import os
+import re
+import sys
+import struct
+
+from argparse import ArgumentParser
+
+
+TEXT_BASE = 0x10000
+DATA_BASE = 0x11100
+
+SECTIONS = [".text", ".rodata", ".data", ".bss"]
+
+# Condition codes of l.sf* and l.sf*i.
+CONDITIONS = {
+    "eq": 0x0, "ne": 0x1, "gtu": 0x2, "geu": 0x3, "ltu": 0x4, "leu": 0x5,
+    "gts": 0xa, "ges": 0xb, "lts": 0xc, "les": 0xd
+}
+
+# Register-register ALU instructions: (bits 9-8, bits 3-0) of opcode 0x38.
+ALU = {
+    "add": (0, 0x0), "addc": (0, 0x1), "sub": (0, 0x2), "and": (0, 0x3),
+    "or": (0, 0x4), "xor": (0, 0x5), "mul": (3, 0x6), "div": (3, 0x9),
+    "divu": (3, 0xa), "mulu": (3, 0xb)
+}
+
+SHIFTS = {"sll": 0, "srl": 1, "sra": 2, "ror": 3}
+
+LOADS = {"lwz": 0x21, "lws": 0x22, "lbz": 0x23, "lbs": 0x24,
+         "lhz": 0x25, "lhs": 0x26}
+
+STORES = {"sw": 0x35, "sb": 0x36, "sh": 0x37}
+
+# Immediate ALU instructions: (opcode, sign-extended immediate).
+IMMEDIATES = {
+    "addi": (0x27, True), "addic": (0x28, True), "andi": (0x29, False),
+    "ori": (0x2a, False), "xori": (0x2b, True), "muli": (0x2c, True)
+}
+
+BRANCHES = {"j": 0x00, "jal": 0x01, "bnf": 0x03, "bf": 0x04}
+
+REGISTER_ALIASES = {"sp": 1, "fp": 2, "lr": 9}
+
+
+class AsmError(Exception):
+    pass
+
+
+def strip_comments(text):
+    '''Removes /* */ comments, keeping the line structure, and # line
+    comments outside of strings.'''
+    text = re.sub(r"/\*.*?\*/", lambda m: "\n" * m.group(0).count("\n"),
+                  text, flags=re.S)
+    lines = []
+    for line in text.split("\n"):
+        in_string = False
+        for i, c in enumerate(line):
+            if c == '"' and (i == 0 or line[i - 1] != "\\"):
+                in_string = not in_string
+            elif c == "#" and not in_string:
+                line = line[:i]
+                break
+        lines.append(line)
+    return lines
+
+
+def read_source(path):
+    '''Returns the lines of the source file, with .include expanded.'''
+    with open(path) as f:
+        text = f.read()
+    lines = []
+    for line in strip_comments(text):
+        m = re.match(r'\s*\.include\s+"(.*)"\s*$', line)
+        if m:
+            lines += read_source(os.path.join(os.path.dirname(path),
+                                              m.group(1)))
+        else:
+            lines.append(line)
+    return lines
+
+
+def register(s):
+    s = s.strip()
+    if s in REGISTER_ALIASES:
+        return REGISTER_ALIASES[s]
+    m = re.fullmatch(r"r(\d+)", s)
+    if not m or int(m.group(1)) > 31:
+        raise AsmError("invalid register: " + s)
+    return int(m.group(1))
+
+
+def split_arguments(s):
+    '''Splits on commas outside of strings.'''
+    args, current, in_string = [], "", False
+    for c in s:
+        if c == '"':
+            in_string = not in_string
+        if c == "," and not in_string:
+            args.append(current.strip())
+            current = ""
+        else:
+            current += c
+    if current.strip():
+        args.append(current.strip())
+    return args
+
+
+class Assembler:
+    '''Two-pass assembler: the first pass determines the section sizes
+    and label offsets, the second pass emits the code with all
+    addresses known.'''
+
+    def __init__(self, lines):
+        self.lines = lines
+        self.labels = {}
+        self.local_labels = []
+        self.globals = set()
+        self.types = {}
+        self.sizes = {}
+        self.base = {s: 0 for s in SECTIONS}
+
+        self.assemble(final=False)
+        self.layout()
+        self.assemble(final=True)
+
+    def assemble(self, final):
+        self.final = final
+        self.section = ".text"
+        self.contents = {s: bytearray() for s in SECTIONS}
+        self.n_local_labels = 0
+
+        for number, line in enumerate(self.lines, 1):
+            try:
+                line = line.strip()
+                while True:
+                    m = re.match(r"([A-Za-z_.][\w.]*|\d+):\s*(.*)", line)
+                    if not m:
+                        break
+                    self.define(m.group(1))
+                    line = m.group(2)
+                if line:
+                    self.statement(line)
+            except (AsmError, KeyError, ValueError) as e:
+                raise AsmError("line {}: {}: {}".format(number, line, e))
+
+    def layout(self):
+        address = TEXT_BASE
+        for s in [".text", ".rodata"]:
+            address = (address + 3) & ~3
+            self.base[s] = address
+            address += len(self.contents[s])
+        if address > DATA_BASE:
+            raise AsmError("text does not fit below the data section")
+
+        address = DATA_BASE
+        for s in [".data", ".bss"]:
+            address = (address + 3) & ~3
+            self.base[s] = address
+            address += len(self.contents[s])
+
+    def here(self):
+        return self.base[self.section] + len(self.contents[self.section])
+
+    def define(self, name):
+        if name.isdigit():
+            if not self.final:
+                self.local_labels.append((name, self.section,
+                                          len(self.contents[self.section])))
+            self.n_local_labels += 1
+        elif not self.final:
+            if name in self.labels:
+                raise AsmError("duplicate label " + name)
+            self.labels[name] = (self.section,
+                                 len(self.contents[self.section]))
+
+    def emit(self, data):
+        if self.section == ".bss" and any(data):
+            raise AsmError("initialized data in .bss")
+        self.contents[self.section] += data
+
+    def label_address(self, name):
+        section, offset = self.labels[name]
+        return self.base[section] + offset
+
+    def value(self, expr):
+        '''Evaluates an expression; addresses are 0 in the first pass.'''
+        expr = expr.strip()
+        m = re.fullmatch(r"(.+?)\s*([-+])\s*([^-+]+)", expr)
+        if m and not re.fullmatch(r"[-+]?\w+", expr):
+            a, b = self.value(m.group(1)), self.value(m.group(3))
+            return a - b if m.group(2) == "-" else a + b
+        if expr == ".":
+            return self.here()
+        m = re.fullmatch(r"(\d+)([bf])", expr)
+        if m:
+            return self.local_label_address(m.group(1), m.group(2))
+        if re.fullmatch(r"[A-Za-z_.][\w.]*", expr):
+            return self.label_address(expr) if self.final else 0
+        return int(expr, 0)
+
+    def local_label_address(self, name, direction):
+        if not self.final:
+            return 0
+        candidates = [(i, label) for i, label in enumerate(self.local_labels)
+                      if label[0] == name]
+        if direction == "b":
+            candidates = [c for c in candidates if c[0] < self.n_local_labels]
+            _, (_, section, offset) = candidates[-1]
+        else:
+            candidates = [c for c in candidates if c[0] >= self.n_local_labels]
+            _, (_, section, offset) = candidates[0]
+        return self.base[section] + offset
+
+    def immediate(self, expr, signed):
+        expr = expr.strip()
+        m = re.fullmatch(r"(hi|lo)\((.*)\)", expr)
+        if m:
+            v = self.value(m.group(2))
+            return (v >> 16) & 0xffff if m.group(1) == "hi" else v & 0xffff
+        v = self.value(expr)
+        low = -0x8000 if signed else 0
+        high = 0x7fff if signed else 0xffff
+        # Like the GNU assembler, also accept the unsigned spelling of
+        # a negative signed immediate.
+        if not low <= v <= max(high, 0xffff):
+            raise AsmError("immediate out of range: " + expr)
+        return v & 0xffff
+
+    def statement(self, line):
+        m = re.match(r"(\S+)\s*(.*)", line)
+        op, rest = m.group(1), m.group(2).strip()
+        args = split_arguments(rest)
+        if op.startswith("."):
+            self.directive(op, rest, args)
+        else:
+            self.emit(struct.pack(">I", self.encode(op, args)))
+
+    def align(self, n):
+        self.emit(bytes(-len(self.contents[self.section]) % n))
+
+    def directive(self, op, rest, args):
+        if op in [".text", ".data", ".bss"]:
+            self.section = op
+        elif op == ".section":
+            if args[0] not in SECTIONS:
+                raise AsmError("unsupported section " + args[0])
+            self.section = args[0]
+        elif op == ".align":
+            self.align(int(args[0], 0))
+        elif op == ".globl":
+            self.globals.add(args[0])
+        elif op == ".local":
+            pass
+        elif op == ".type":
+            self.types[args[0]] = args[1]
+        elif op == ".size":
+            if self.final:
+                self.sizes[args[0]] = self.value(args[1])
+        elif op == ".space":
+            self.emit(bytes(int(args[0], 0)))
+        elif op in [".word", ".int", ".long"]:
+            for a in args:
+                self.emit(struct.pack(">I", self.value(a) & 0xffffffff))
+        elif op == ".string":
+            s = rest[1:-1].encode("latin1").decode("unicode_escape")
+            self.emit(s.encode("latin1") + b"\0")
+        elif op == ".comm":
+            # Common symbols end up in .bss, as the linker places them.
+            name, size = args[0], int(args[1], 0)
+            alignment = int(args[2], 0) if len(args) > 2 else 4
+            current = self.section
+            self.section = ".bss"
+            self.align(alignment)
+            self.define(name)
+            self.emit(bytes(size))
+            self.section = current
+        else:
+            raise AsmError("unsupported directive " + op)
+
+    def branch(self, opcode, target):
+        offset = (self.value(target) - self.here()) >> 2
+        if self.final and not -(1 << 25) <= offset < (1 << 25):
+            raise AsmError("branch target out of range: " + target)
+        return (opcode << 26) | (offset & 0x3ffffff)
+
+    def memory_operand(self, operand):
+        m = re.fullmatch(r"(.*)\((\w+)\)", operand.strip())
+        if not m:
+            raise AsmError("invalid memory operand: " + operand)
+        return self.immediate(m.group(1) or "0", True), register(m.group(2))
+
+    def encode(self, op, a):
+        if not op.startswith("l."):
+            raise AsmError("unsupported instruction " + op)
+        op = op[2:]
+
+        if op in BRANCHES:
+            return self.branch(BRANCHES[op], a[0])
+        if op == "nop":
+            return 0x15000000 | (self.immediate(a[0], False) if a else 0)
+        if op == "movhi":
+            return ((0x06 << 26) | (register(a[0]) << 21) |
+                    self.immediate(a[1], False))
+        if op == "jr":
+            return (0x11 << 26) | (register(a[0]) << 11)
+        if op == "jalr":
+            return (0x12 << 26) | (register(a[0]) << 11)
+        if op in LOADS:
+            imm, base = self.memory_operand(a[1])
+            return ((LOADS[op] << 26) | (register(a[0]) << 21) |
+                    (base << 16) | imm)
+        if op in STORES:
+            imm, base = self.memory_operand(a[0])
+            return ((STORES[op] << 26) | ((imm >> 11) << 21) |
+                    (base << 16) | (register(a[1]) << 11) | (imm & 0x7ff))
+        if op in IMMEDIATES:
+            opcode, signed = IMMEDIATES[op]
+            return ((opcode << 26) | (register(a[0]) << 21) |
+                    (register(a[1]) << 16) | self.immediate(a[2], signed))
+        if op.endswith("i") and op[:-1] in SHIFTS:
+            amount = self.value(a[2])
+            if not 0 <= amount < 32:
+                raise AsmError("shift amount out of range: " + a[2])
+            return ((0x2e << 26) | (register(a[0]) << 21) |
+                    (register(a[1]) << 16) | (SHIFTS[op[:-1]] << 6) | amount)
+        if op in SHIFTS:
+            return ((0x38 << 26) | (register(a[0]) << 21) |
+                    (register(a[1]) << 16) | (register(a[2]) << 11) |
+                    (SHIFTS[op] << 6) | 0x8)
+        if op in ALU:
+            high, low = ALU[op]
+            return ((0x38 << 26) | (register(a[0]) << 21) |
+                    (register(a[1]) << 16) | (register(a[2]) << 11) |
+                    (high << 8) | low)
+        if op.startswith("sf"):
+            condition = op[2:]
+            if condition.endswith("i") and condition[:-1] in CONDITIONS:
+                return ((0x2f << 26) | (CONDITIONS[condition[:-1]] << 21) |
+                        (register(a[0]) << 16) | self.immediate(a[1], True))
+            if condition in CONDITIONS:
+                return ((0x39 << 26) | (CONDITIONS[condition] << 21) |
+                        (register(a[0]) << 16) | (register(a[1]) << 11))
+        raise AsmError("unsupported instruction l." + op)
+
+
+def write_elf(asm, path):
+    '''Writes a big-endian ELF32 OpenRISC executable with one loadable
+    segment for text and read-only data and one for data and bss.'''
+    sections = [s for s in SECTIONS if asm.contents[s]]
+    index = {s: i + 1 for i, s in enumerate(sections)}
+    flags = {".text": 0x6, ".rodata": 0x2, ".data": 0x3, ".bss": 0x3}
+
+    shstrtab = b"\0"
+    names = {}
+    for s in sections + [".symtab", ".strtab", ".shstrtab"]:
+        names[s] = len(shstrtab)
+        shstrtab += s.encode() + b"\0"
+
+    # Symbol table: local symbols first, as the ELF specification demands.
+    ordered = sorted(asm.labels, key=lambda n: (asm.label_address(n), n))
+    ordered = ([n for n in ordered if n not in asm.globals] +
+               [n for n in ordered if n in asm.globals])
+    n_locals = 1 + len(ordered) - len([n for n in ordered if n in asm.globals])
+    strtab = b"\0"
+    symtab = bytes(16)
+    for name in ordered:
+        bind = 1 if name in asm.globals else 0
+        kind = 2 if asm.types.get(name) == "@function" else 1
+        symtab += struct.pack(">IIIBBH", len(strtab), asm.label_address(name),
+                              asm.sizes.get(name, 0), (bind << 4) | kind, 0,
+                              index[asm.labels[name][0]])
+        strtab += name.encode() + b"\0"
+
+    segments = [[s for s in [".text", ".rodata"] if s in sections],
+                [s for s in [".data", ".bss"] if s in sections]]
+    segments = [s for s in segments if s]
+
+    image = bytearray(52 + 32 * len(segments))
+    offsets = {}
+
+    def append(data, alignment):
+        image.extend(bytes(-len(image) % alignment))
+        offset = len(image)
+        image.extend(data)
+        return offset
+
+    for s in sections:
+        offsets[s] = append(b"" if s == ".bss" else asm.contents[s], 4)
+    symtab_offset = append(symtab, 4)
+    strtab_offset = append(strtab, 1)
+    shstrtab_offset = append(shstrtab, 1)
+
+    headers = [bytes(40)]
+    for s in sections:
+        headers.append(struct.pack(">10I", names[s], 8 if s == ".bss" else 1,
+                                   flags[s], asm.base[s], offsets[s],
+                                   len(asm.contents[s]), 0, 0, 4, 0))
+    headers.append(struct.pack(">10I", names[".symtab"], 2, 0, 0,
+                               symtab_offset, len(symtab), len(sections) + 2,
+                               n_locals, 4, 16))
+    headers.append(struct.pack(">10I", names[".strtab"], 3, 0, 0,
+                               strtab_offset, len(strtab), 0, 0, 1, 0))
+    headers.append(struct.pack(">10I", names[".shstrtab"], 3, 0, 0,
+                               shstrtab_offset, len(shstrtab), 0, 0, 1, 0))
+    header_offset = append(b"".join(headers), 4)
+
+    program_headers = b""
+    for segment in segments:
+        first, last = segment[0], segment[-1]
+        memory_size = asm.base[last] + len(asm.contents[last]) - asm.base[first]
+        file_size = sum(len(asm.contents[s]) for s in segment if s != ".bss")
+        permissions = 0x5 if first in [".text", ".rodata"] else 0x6
+        program_headers += struct.pack(">8I", 1, offsets[first],
+                                       asm.base[first], asm.base[first],
+                                       file_size, memory_size, permissions, 4)
+
+    if "_start" not in asm.labels:
+        raise AsmError("no _start symbol")
+    elf_header = b"\x7fELF" + bytes([1, 2, 1]) + bytes(9)
+    elf_header += struct.pack(">HHIIIIIHHHHHH", 2, 92, 1,
+                              asm.label_address("_start"), 52, header_offset,
+                              0, 52, 32, len(segments), 40, len(headers),
+                              len(headers) - 1)
+    image[0:len(elf_header) + len(program_headers)] = \
+        elf_header + program_headers
+
+    with open(path, "wb") as f:
+        f.write(image)
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(description="Minimal OpenRISC assembler for "
+                            "the benchmark kernels.")
+    parser.add_argument("source", help="Assembly source file.")
+    parser.add_argument("-o", "--output", required=True,
+                        help="Output ELF file.")
+    args = parser.parse_args()
+
+    try:
+        write_elf(Assembler(read_source(args.source)), args.output)
+    except (AsmError, OSError) as e:
+        print("{}: {}".format(args.source, e), file=sys.stderr)
+        sys.exit(1)
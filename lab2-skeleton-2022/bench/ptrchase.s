@@ -0,0 +1,47 @@
+/* Pointer chasing: a cyclic list through a 64 KiB array with a large
+ * odd stride, followed for 2000000 dependent loads.
+ * Prints 00003600.
+ */
+	.text
+	.align 4
+	.globl	_start
+	.type	_start, @function
+_start:
+	l.movhi	r10,hi(nodes)
+	l.ori	r10,r10,lo(nodes)
+	l.ori	r13,r0,16383		/* index mask */
+
+	/* nodes[i] = &nodes[(i + 4099) & mask] */
+	l.addi	r4,r0,0
+1:	l.addi	r5,r4,4099
+	l.and	r5,r5,r13
+	l.slli	r5,r5,2
+	l.add	r5,r5,r10
+	l.slli	r6,r4,2
+	l.add	r6,r6,r10
+	l.sw	0(r6),r5
+	l.sfne	r4,r13
+	l.bf	1b
+	l.addi	r4,r4,1
+
+	l.movhi	r7,0x7
+	l.ori	r7,r7,0xa120		/* 500000 x 4 steps */
+	l.addi	r3,r10,0
+2:	l.lwz	r3,0(r3)
+	l.lwz	r3,0(r3)
+	l.lwz	r3,0(r3)
+	l.lwz	r3,0(r3)
+	l.addi	r7,r7,-1
+	l.sfne	r7,r0
+	l.bf	2b
+	l.nop
+	l.j	exit_with_checksum
+	l.sub	r3,r3,r10
+	.size	_start, .-_start
+
+	.include "common.inc"
+
+	.section .bss
+	.align 4
+nodes:
+	.space	65536
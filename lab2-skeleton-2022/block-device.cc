@@ -0,0 +1,289 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    block-device.cc - Block storage device backed by a disk image.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "block-device.h"
+#include "memory-bus.h"
+#include "statistics.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+BlockDevice::BlockDevice(const BlockDeviceConfig &config, MemoryBus &bus)
+  : config{ config }, bus{ bus }
+{
+  mapImage();
+
+  const size_t sectors = imageSize / SectorSize;
+  capacity = std::min<size_t>(sectors, std::numeric_limits<uint32_t>::max());
+}
+
+BlockDevice::~BlockDevice()
+{
+#ifdef _MSC_VER
+  UnmapViewOfFile(image);
+  CloseHandle(mapping);
+  CloseHandle(fd);
+#else
+  munmap(image, imageSize);
+  close(fd);
+#endif
+}
+
+/*
+ * MemoryInterface
+ */
+
+uint8_t
+BlockDevice::readByte(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+uint16_t
+BlockDevice::readHalfWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+uint32_t
+BlockDevice::readWord(MemAddress addr)
+{
+  switch (addr - config.base)
+    {
+      case SectorOffset:
+        return sector;
+      case AddressOffset:
+        return address;
+      case CountOffset:
+        return count;
+      case StatusOffset:
+        return status;
+      case CapacityOffset:
+        return capacity;
+      default:
+        throw IllegalAccess("Invalid block device address");
+    }
+}
+
+uint64_t
+BlockDevice::readDoubleWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+
+void
+BlockDevice::writeByte(MemAddress addr, uint8_t value)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+void
+BlockDevice::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+void
+BlockDevice::writeWord(MemAddress addr, uint32_t value)
+{
+  if (addr - config.base == StatusOffset)
+    {
+      status &= ~(value & (StatusDone | StatusError));
+      return;
+    }
+
+  if (status & StatusBusy)
+    throw IllegalAccess("Block device registers written during transfer");
+
+  switch (addr - config.base)
+    {
+      case SectorOffset:
+        sector = value;
+        break;
+      case AddressOffset:
+        address = value;
+        break;
+      case CountOffset:
+        count = value;
+        break;
+      case CommandOffset:
+        start(value);
+        break;
+      default:
+        throw IllegalAccess("Invalid block device address");
+    }
+}
+
+void
+BlockDevice::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  throw IllegalAccess("Not supported on block device interface");
+}
+
+bool
+BlockDevice::contains(MemAddress addr) const
+{
+  return config.base <= addr && addr < config.base + EndOffset;
+}
+
+/* Called every bus clock cycle, the command is carried out when its
+ * latency has passed.
+ */
+void
+BlockDevice::clockPulse()
+{
+  if (! (status & StatusBusy) || --remainingCycles > 0)
+    return;
+
+  transfer();
+  status = (status & ~StatusBusy) | StatusDone;
+}
+
+uint64_t
+BlockDevice::getIdleCycles() const
+{
+  if (! (status & StatusBusy))
+    return MemoryInterface::getIdleCycles();
+
+  return remainingCycles - 1;
+}
+
+void
+BlockDevice::skipCycles(uint64_t cycles)
+{
+  if (status & StatusBusy)
+    remainingCycles -= cycles;
+}
+
+void
+BlockDevice::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("block.sectors_read", "Sectors read from the image",
+                      &nSectorsRead);
+  registry.addCounter("block.sectors_written", "Sectors written to the image",
+                      &nSectorsWritten);
+}
+
+/*
+ * Private methods
+ */
+
+void
+BlockDevice::mapImage()
+{
+  const std::string &filename = config.image;
+
+#ifdef _MSC_VER
+  const DWORD access = config.readOnly ? GENERIC_READ
+      : GENERIC_READ | GENERIC_WRITE;
+  fd = CreateFileA(filename.c_str(), access, FILE_SHARE_READ, nullptr,
+                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("cannot open file " + filename);
+
+  LARGE_INTEGER fileSize;
+  if (! GetFileSizeEx(fd, &fileSize) || fileSize.QuadPart == 0)
+    {
+      CloseHandle(fd);
+      throw std::runtime_error("disk image is empty: " + filename);
+    }
+  imageSize = fileSize.QuadPart;
+
+  mapping = CreateFileMappingA(fd, nullptr, config.readOnly ? PAGE_READONLY
+                               : PAGE_READWRITE, 0, 0, nullptr);
+  if (mapping == nullptr)
+    {
+      CloseHandle(fd);
+      throw std::runtime_error("Failed to create memory map.");
+    }
+
+  image = static_cast<std::byte *>(
+      MapViewOfFile(mapping, config.readOnly ? FILE_MAP_READ : FILE_MAP_WRITE,
+                    0, 0, 0));
+  if (image == nullptr)
+    {
+      CloseHandle(mapping);
+      CloseHandle(fd);
+      throw std::runtime_error("Failed to setup memory map.");
+    }
+#else
+  fd = open(filename.c_str(), config.readOnly ? O_RDONLY : O_RDWR);
+  if (fd < 0)
+    throw std::runtime_error("cannot open file " + filename);
+
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) < 0 || statbuf.st_size == 0)
+    {
+      close(fd);
+      throw std::runtime_error("disk image is empty: " + filename);
+    }
+  imageSize = statbuf.st_size;
+
+  const int protection = config.readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+  void *addr = mmap(NULL, imageSize, protection, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("Failed to setup memory map.");
+    }
+  image = static_cast<std::byte *>(addr);
+
+  /* Guest programs typically stream through their input */
+  madvise(addr, imageSize, MADV_SEQUENTIAL);
+#endif
+}
+
+void
+BlockDevice::start(uint32_t value)
+{
+  command = value;
+  status = StatusBusy;
+  remainingCycles = std::max<uint64_t>(1, config.latency +
+      uint64_t{ config.cyclesPerSector } * count);
+}
+
+void
+BlockDevice::transfer()
+{
+  const uint64_t end = uint64_t{ sector } + count;
+  const size_t size = size_t{ count } * SectorSize;
+
+  if (end > capacity || (command != CommandRead && command != CommandWrite) ||
+      (command == CommandWrite && config.readOnly))
+    {
+      status |= StatusError;
+      return;
+    }
+
+  std::byte *data = image + size_t{ sector } * SectorSize;
+  try
+    {
+      if (command == CommandRead)
+        {
+          bus.writeBlock(address, data, size);
+          nSectorsRead += count;
+        }
+      else
+        {
+          bus.readBlock(address, data, size);
+          nSectorsWritten += count;
+        }
+    }
+  catch (IllegalAccess &)
+    {
+      status |= StatusError;
+    }
+}
@@ -0,0 +1,127 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    block-device.h - Block storage device backed by a disk image.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __BLOCK_DEVICE_H__
+#define __BLOCK_DEVICE_H__
+
+#include "memory-interface.h"
+
+#include <string>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+class MemoryBus;
+
+struct BlockDeviceConfig
+{
+  std::string image{};
+  MemAddress base = 0x400;
+  bool readOnly = false;
+
+  /* Latency model: a command takes latency bus cycles plus
+   * cyclesPerSector bus cycles for every sector transferred.
+   */
+  unsigned int latency = 100;
+  unsigned int cyclesPerSector = 64;
+};
+
+/* The block device exposes a host disk image as an array of 512-byte
+ * sectors. The image is memory-mapped, so it is paged in on demand and
+ * its size does not affect start-up time or memory usage. Transfers
+ * copy directly between the mapped image and guest memory.
+ *
+ * Register map (offsets relative to base, all word registers):
+ *   0x00 - first sector
+ *   0x04 - guest memory address
+ *   0x08 - number of sectors
+ *   0x0c - command (write-only): 1 = read sectors into memory,
+ *          2 = write sectors from memory
+ *   0x10 - status (read, write 1 to clear done and error)
+ *            bit 0: busy
+ *            bit 1: done
+ *            bit 2: error, invalid sector range, memory address or
+ *                   command, or a write to a read-only image
+ *   0x14 - capacity in sectors (read-only)
+ */
+class BlockDevice : public MemoryInterface
+{
+  public:
+    static constexpr size_t SectorSize = 512;
+
+    BlockDevice(const BlockDeviceConfig &config, MemoryBus &bus);
+    ~BlockDevice() override;
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override;
+
+    void clockPulse() override;
+    uint64_t getIdleCycles() const override;
+    void skipCycles(uint64_t cycles) override;
+
+    void registerStatistics(StatisticsRegistry &registry) override;
+
+    BlockDevice(const BlockDevice &) = delete;
+    BlockDevice &operator=(const BlockDevice &) = delete;
+
+  private:
+    static constexpr MemAddress SectorOffset = 0x00;
+    static constexpr MemAddress AddressOffset = 0x04;
+    static constexpr MemAddress CountOffset = 0x08;
+    static constexpr MemAddress CommandOffset = 0x0c;
+    static constexpr MemAddress StatusOffset = 0x10;
+    static constexpr MemAddress CapacityOffset = 0x14;
+    static constexpr MemAddress EndOffset = 0x18;
+
+    static constexpr uint32_t CommandRead = 1;
+    static constexpr uint32_t CommandWrite = 2;
+
+    static constexpr uint32_t StatusBusy = 1 << 0;
+    static constexpr uint32_t StatusDone = 1 << 1;
+    static constexpr uint32_t StatusError = 1 << 2;
+
+    const BlockDeviceConfig config;
+    MemoryBus &bus;
+
+#ifdef _MSC_VER
+    HANDLE fd{};
+    HANDLE mapping{};
+#else
+    int fd{};
+#endif
+    std::byte *image = nullptr;
+    size_t imageSize{};
+    uint32_t capacity{};
+
+    uint32_t sector{};
+    uint32_t address{};
+    uint32_t count{};
+    uint32_t command{};
+    uint32_t status{};
+
+    uint64_t remainingCycles{};
+
+    uint64_t nSectorsRead{};
+    uint64_t nSectorsWritten{};
+
+    void mapImage();
+    void start(uint32_t value);
+    void transfer();
+};
+
+#endif /* __BLOCK_DEVICE_H__ */
@@ -0,0 +1,260 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    call-graph.cc - Call graph profiler for guest programs.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "call-graph.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <set>
+
+/* Opcodes and registers relevant for tracking calls and returns */
+static constexpr uint32_t JumpAndLinkOpcode = 0x01;
+static constexpr uint32_t JumpRegisterOpcode = 0x11;
+static constexpr uint32_t JumpAndLinkRegisterOpcode = 0x12;
+static constexpr uint32_t LinkRegister = 9;
+
+/* Size of a branch or jump plus its delay slot */
+static constexpr MemAddress CallSize = 8;
+
+static const std::string unknownFunction{ "[unknown]" };
+
+
+CallGraphProfiler::CallGraphProfiler(const SymbolTable &symbols)
+  : symbols{ symbols }
+{
+}
+
+void
+CallGraphProfiler::retire(MemAddress PC, uint32_t instructionWord,
+                          uint64_t cycle)
+{
+  if (stack.empty())
+    push(PC, 0);
+  else if (inDelaySlot)
+    {
+      /* The delay slot still belongs to the calling function. */
+      inDelaySlot = false;
+    }
+  else
+    {
+      Pending current = pending;
+      pending = Pending::None;
+
+      if (current == Pending::Call)
+        push(PC, pendingReturnAddress);
+      else if ((current == Pending::Return && unwindTo(PC)) ||
+               (currentLow <= PC && PC < currentHigh))
+        {
+          /* Returned, or still executing within the current function */
+        }
+      else if (! unwindTo(PC))
+        {
+          /* Tail call: the new function replaces the current frame and
+           * will return to the caller of the current function.
+           */
+          if (stack.size() == 1)
+            {
+              stack.back().function = symbols.lookup(PC);
+              updateCurrentRange(PC);
+            }
+          else
+            {
+              MemAddress returnAddress = stack.back().returnAddress;
+              pop();
+              push(PC, returnAddress);
+            }
+        }
+    }
+
+  /* Account the retired instruction to the current function. */
+  Cost &cost = exclusive[stack.back().function];
+  cost.cycles += cycle - lastCycle;
+  ++cost.instructions;
+
+  lastCycle = cycle;
+  ++instructions;
+
+  /* Calls and returns take effect after the delay slot. */
+  const uint32_t opcode = instructionWord >> 26;
+  if (opcode == JumpAndLinkOpcode || opcode == JumpAndLinkRegisterOpcode)
+    {
+      pending = Pending::Call;
+      pendingReturnAddress = PC + CallSize;
+      inDelaySlot = true;
+    }
+  else if (opcode == JumpRegisterOpcode &&
+           ((instructionWord >> 11) & 0x1f) == LinkRegister)
+    {
+      pending = Pending::Return;
+      inDelaySlot = true;
+    }
+}
+
+void
+CallGraphProfiler::writeCallgrind(const std::string &filename,
+                                  const std::string &command) const
+{
+  std::ofstream file{ filename };
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  /* Account frames that are still active. */
+  auto allEdges(edges);
+  for (size_t i = stack.size(); i > 1; --i)
+    accountEdge(allEdges, stack[i - 2], stack[i - 1], lastCycle, instructions);
+
+  std::set<Function> functions;
+  Cost total;
+  for (const auto & [function, cost] : exclusive)
+    {
+      functions.insert(function);
+      total.cycles += cost.cycles;
+      total.instructions += cost.instructions;
+    }
+  for (const auto & [edge, cost] : allEdges)
+    functions.insert(edge.first);
+
+  file << "# callgrind format" << std::endl
+       << "version: 1" << std::endl
+       << "creator: rv64-emu" << std::endl
+       << "cmd: " << command << std::endl
+       << "positions: instr" << std::endl
+       << "events: Cycles Instructions" << std::endl
+       << "summary: " << total.cycles << " " << total.instructions
+       << std::endl;
+
+  file << std::hex << std::showbase;
+  for (Function function : functions)
+    {
+      const MemAddress address = function ? function->address : 0;
+
+      file << std::endl << "fn=" << getName(function) << std::endl;
+
+      auto it = exclusive.find(function);
+      if (it != exclusive.end())
+        file << address << std::dec << " " << it->second.cycles << " "
+             << it->second.instructions << std::hex << std::endl;
+
+      for (const auto & [edge, cost] : allEdges)
+        {
+          if (edge.first != function)
+            continue;
+
+          const MemAddress calleeAddress = edge.second ? edge.second->address : 0;
+          file << "cfn=" << getName(edge.second) << std::endl
+               << "calls=" << std::dec << cost.calls << " "
+               << std::hex << calleeAddress << std::endl
+               << address << std::dec << " " << cost.inclusive.cycles << " "
+               << cost.inclusive.instructions << std::hex << std::endl;
+        }
+    }
+}
+
+std::string
+CallGraphProfiler::getCallers() const
+{
+  std::string callers;
+
+  for (size_t i = 0; i + 1 < stack.size(); ++i)
+    {
+      callers += getName(stack[i].function);
+      callers += ';';
+    }
+
+  return callers;
+}
+
+/*
+ * Private methods
+ */
+
+void
+CallGraphProfiler::push(MemAddress PC, MemAddress returnAddress)
+{
+  stack.push_back(Frame{ symbols.lookup(PC), returnAddress,
+                         lastCycle, instructions });
+  updateCurrentRange(PC);
+}
+
+void
+CallGraphProfiler::pop()
+{
+  Frame callee = stack.back();
+  stack.pop_back();
+
+  if (! stack.empty())
+    accountEdge(edges, stack.back(), callee, lastCycle, instructions);
+}
+
+/* Unwind the stack up to the frame that returns to PC. Returns false
+ * when no such frame exists.
+ */
+bool
+CallGraphProfiler::unwindTo(MemAddress PC)
+{
+  /* The bottom frame has no caller to return to. */
+  auto it = std::find_if(stack.rbegin(), stack.rend() - 1,
+                         [PC](const Frame &frame)
+                         {
+                           return frame.returnAddress == PC;
+                         });
+  if (it == stack.rend() - 1)
+    return false;
+
+  const size_t depth = stack.rend() - it - 1;
+  while (stack.size() > depth)
+    pop();
+
+  updateCurrentRange(PC);
+  return true;
+}
+
+void
+CallGraphProfiler::updateCurrentRange(MemAddress PC)
+{
+  const ELFSymbol *symbol = symbols.lookup(PC);
+  if (symbol)
+    {
+      currentLow = symbol->address;
+      currentHigh = symbols.getEnd(*symbol);
+      return;
+    }
+
+  /* Code without symbol, determine the gap between the surrounding
+   * symbols.
+   */
+  currentLow = 0;
+  currentHigh = std::numeric_limits<MemAddress>::max();
+  for (const auto &s : symbols.getSymbols())
+    {
+      if (s.address > PC)
+        {
+          currentHigh = s.address;
+          break;
+        }
+      currentLow = std::max(currentLow, symbols.getEnd(s));
+    }
+}
+
+void
+CallGraphProfiler::accountEdge(std::map<std::pair<Function, Function>, EdgeCost> &edges,
+                               const Frame &caller, const Frame &callee,
+                               uint64_t cycle, uint64_t instructions)
+{
+  EdgeCost &cost = edges[std::make_pair(caller.function, callee.function)];
+
+  ++cost.calls;
+  cost.inclusive.cycles += cycle - callee.entryCycle;
+  cost.inclusive.instructions += instructions - callee.entryInstructions;
+}
+
+const std::string &
+CallGraphProfiler::getName(Function function) const
+{
+  return function ? function->name : unknownFunction;
+}
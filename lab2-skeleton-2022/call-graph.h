@@ -0,0 +1,112 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    call-graph.h - Call graph profiler for guest programs.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __CALL_GRAPH_H__
+#define __CALL_GRAPH_H__
+
+#include "symbol-table.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* The call graph profiler maintains a shadow call stack from the stream
+ * of retired instructions. Calls are recognized by l.jal and l.jalr, a
+ * return by l.jr r9. Both take effect after the delay slot has retired.
+ *
+ * Control transfers that are not matched by a call or return are
+ * handled as well: when execution continues at the return address of a
+ * frame further up the stack (e.g. longjmp), the frames above it are
+ * unwound. Otherwise, when execution leaves the current function, this
+ * is treated as a tail call which replaces the current frame.
+ *
+ * Exclusive cycles and instructions are accounted per function,
+ * inclusive cycles and instructions per call graph edge.
+ */
+class CallGraphProfiler
+{
+  public:
+    CallGraphProfiler(const SymbolTable &symbols);
+
+    CallGraphProfiler(const CallGraphProfiler &) = delete;
+    CallGraphProfiler &operator=(const CallGraphProfiler &) = delete;
+
+    void retire(MemAddress PC, uint32_t instructionWord, uint64_t cycle);
+
+    /* Write the profile in callgrind format. Frames that are still on
+     * the stack are accounted up to the last retired instruction.
+     */
+    void writeCallgrind(const std::string &filename,
+                        const std::string &command) const;
+
+    /* Returns the callers of the current function on the shadow stack,
+     * outermost first, each followed by ';'. Used to build the stacks
+     * of the sampling profiler.
+     */
+    std::string getCallers() const;
+
+  private:
+    /* nullptr represents code without symbol */
+    using Function = const ELFSymbol *;
+
+    struct Frame
+    {
+      Function function{};
+      MemAddress returnAddress{};
+      uint64_t entryCycle{};
+      uint64_t entryInstructions{};
+    };
+
+    struct Cost
+    {
+      uint64_t cycles{};
+      uint64_t instructions{};
+    };
+
+    struct EdgeCost
+    {
+      uint64_t calls{};
+      Cost inclusive{};
+    };
+
+    enum class Pending
+    {
+      None,
+      Call,
+      Return
+    };
+
+    const SymbolTable &symbols;
+
+    std::vector<Frame> stack{};
+
+    /* Address range of the function in the top frame */
+    MemAddress currentLow{};
+    MemAddress currentHigh{};
+
+    Pending pending = Pending::None;
+    bool inDelaySlot = false;
+    MemAddress pendingReturnAddress{};
+
+    uint64_t lastCycle{};
+    uint64_t instructions{};
+
+    std::map<Function, Cost> exclusive{};
+    std::map<std::pair<Function, Function>, EdgeCost> edges{};
+
+    void push(MemAddress PC, MemAddress returnAddress);
+    void pop();
+    bool unwindTo(MemAddress PC);
+    void updateCurrentRange(MemAddress PC);
+
+    static void accountEdge(std::map<std::pair<Function, Function>, EdgeCost> &edges,
+                            const Frame &caller, const Frame &callee,
+                            uint64_t cycle, uint64_t instructions);
+    const std::string &getName(Function function) const;
+};
+
+#endif /* __CALL_GRAPH_H__ */
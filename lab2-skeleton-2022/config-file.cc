@@ -9,103 +9,239 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
 
 #include <algorithm>
-#include <regex>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 /* All key-value pairs not designated to a section are placed in a
- * section __GLOBAL. Since this name is not accepted by sectionRegex,
- * there cannot be a collision.
+ * section __GLOBAL. Since a section name only consists of letters and
+ * digits, there cannot be a collision.
  */
 static constexpr std::string_view globalSectionName = "__GLOBAL";
 
 
+/*
+ * Line grammar. These match the same lines as the regular expressions
+ * the parser used before:
+ *
+ *   section:    \[([a-zA-Z0-9]+)\]\s*
+ *   key-value:  ([a-zA-Z]\S*)\s*=\s*(\S+)
+ *   empty:      \s*
+ */
+
+static bool
+isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' ||
+         c == '\v' || c == '\f' || c == '\r';
+}
+
+static bool
+isAlpha(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool
+isAlnum(char c)
+{
+  return isAlpha(c) || (c >= '0' && c <= '9');
+}
+
+static std::string_view
+skipSpace(std::string_view str)
+{
+  size_t i = 0;
+  while (i < str.size() && isSpace(str[i]))
+    ++i;
+  return str.substr(i);
+}
+
+static bool
+isBlank(std::string_view str)
+{
+  return skipSpace(str).empty();
+}
+
+/* A non-empty word without white space */
+static bool
+isWord(std::string_view str)
+{
+  return ! str.empty() && std::none_of(str.begin(), str.end(), isSpace);
+}
+
+static bool
+parseSection(std::string_view line, std::string_view &name)
+{
+  if (line.empty() || line[0] != '[')
+    return false;
+
+  size_t end = 1;
+  while (end < line.size() && isAlnum(line[end]))
+    ++end;
+
+  if (end == 1 || end == line.size() || line[end] != ']' ||
+      ! isBlank(line.substr(end + 1)))
+    return false;
+
+  name = line.substr(1, end - 1);
+  return true;
+}
+
+/* The key of a key-value pair may itself contain '=', like the greedy
+ * regular expression used to allow: the longest key for which the
+ * remainder of the line forms "= value" is taken.
+ */
+static bool
+parseKeyValue(std::string_view line,
+              std::string_view &key, std::string_view &value)
+{
+  if (line.empty() || ! isAlpha(line[0]))
+    return false;
+
+  size_t wordEnd = 1;
+  while (wordEnd < line.size() && ! isSpace(line[wordEnd]))
+    ++wordEnd;
+
+  const std::string_view word = line.substr(0, wordEnd);
+  const std::string_view rest = line.substr(wordEnd);
+
+  if (rest.empty())
+    {
+      /* "key=value" without white space */
+      const size_t eq = word.rfind('=', word.size() - 2);
+      if (eq == std::string_view::npos || eq == 0)
+        return false;
+
+      key = word.substr(0, eq);
+      value = word.substr(eq + 1);
+      return true;
+    }
+
+  /* "key = value" */
+  std::string_view tail = skipSpace(rest);
+  if (! tail.empty() && tail[0] == '=' && isWord(skipSpace(tail.substr(1))))
+    {
+      key = word;
+      value = skipSpace(tail.substr(1));
+      return true;
+    }
+
+  /* "key= value" */
+  if (word.size() >= 2 && word.back() == '=' && isWord(tail))
+    {
+      key = word.substr(0, word.size() - 1);
+      value = tail;
+      return true;
+    }
+
+  return false;
+}
+
+
 ConfigFile::ConfigFile(std::string_view filename)
 {
   load(filename);
 }
 
+ConfigFile::~ConfigFile()
+{
+  clear();
+}
+
 void
 ConfigFile::clear()
 {
   sections.clear();
   properties.clear();
+
+#ifndef _MSC_VER
+  if (mapAddr)
+    munmap(mapAddr, mapSize);
+#endif
+  mapAddr = nullptr;
+  mapSize = 0;
+  buffer.clear();
 }
 
 void
 ConfigFile::load(std::string_view filename)
 {
   clear();
+  readContents(filename);
 
   /* Add default "global" section and make active */
-  std::string currentSection{ globalSectionName };
-  sections.push_back(currentSection);
-
-  /* Regexes to use while parsing */
-  std::regex sectionRegex{ R"(\[([a-zA-Z0-9]+)\]\s*)" };
-  std::regex keyValueRegex{ R"(([a-zA-Z]\S*)\s*=\s*(\S+))" };
-  std::regex emptyLineRegex{ "^\\s*$" };
-  std::smatch match;
+  std::string_view currentSection{ globalSectionName };
+  addSection(currentSection);
 
-  /* Open and parse the file */
-  std::ifstream file{ filename.data() };
-  if (!file.good())
-    throw std::runtime_error("cannot open file " + std::string{ filename });
+  char *pos = mapAddr ? mapAddr : buffer.data();
+  char *const end = pos + (mapAddr ? mapSize : buffer.size());
 
-  std::string line;
   int lineNumber(0);
-  while (std::getline(file, line))
+  while (pos != end)
     {
+      char *lineEnd = std::find(pos, end, '\n');
       ++lineNumber;
 
-      /* Remove newline characters from string. */
-      line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
-      line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+      /* Remove carriage returns from the line. The contents are a
+       * private copy, so this is done in place.
+       */
+      char *last = std::remove(pos, lineEnd, '\r');
+      std::string_view line(pos, last - pos);
+
+      pos = lineEnd == end ? end : lineEnd + 1;
+
+      std::string_view name, key, value;
 
       /* Is this a section header? */
-      if (std::regex_match(line, match, sectionRegex))
+      if (parseSection(line, name))
         {
-          if (hasSection(match[1].str()))
+          if (hasSection(name))
             throw std::runtime_error(std::string{ filename } + ": line " +
                                      std::to_string(lineNumber) +
                                      ": duplicate definition of section '" +
-                                     match[1].str() + "'");
+                                     std::string{ name } + "'");
 
-          currentSection = match[1];
-          addSection(match[1].str());
+          currentSection = name;
+          addSection(name);
         }
       /* A key value pair? */
-      else if (std::regex_match(line, match, keyValueRegex))
+      else if (parseKeyValue(line, key, value))
         {
-          if (hasProperty(currentSection, match[1].str()))
+          if (hasProperty(currentSection, key))
             throw std::runtime_error(std::string{ filename } + ": line " +
                                      std::to_string(lineNumber) +
                                      ": duplicate definition of '" +
-                                     match[1].str() + "'");
+                                     std::string{ key } + "'");
 
-          addProperty(std::make_pair(currentSection, match[1]), match[2].str());
+          addProperty(currentSection, key, value);
         }
       /* An empty line, perhaps? Otherwise: give up. */
-      else if (!std::regex_match(line, match, emptyLineRegex))
+      else if (! isBlank(line))
         {
           std::cerr << "warning: " << filename
                     << ": cannot parse line " << lineNumber
                     << ", ignoring." << std::endl;
         }
     }
-
-  file.close();
 }
 
 
 bool
 ConfigFile::hasSection(std::string_view sectionName) const
 {
-  return sections.end() != std::find(sections.begin(), sections.end(), sectionName);
+  return properties.find(sectionName) != properties.end();
 }
 
-const std::list<std::string> &
+const std::vector<std::string_view> &
 ConfigFile::getSections() const
 {
   return sections;
@@ -115,38 +251,84 @@ bool
 ConfigFile::hasProperty(std::string_view sectionName,
                         std::string_view keyName) const
 {
-  return std::any_of(properties.begin(), properties.end(),
-                     [&](const auto &kvp) {
-                       return kvp.first.first == sectionName &&
-                              kvp.first.second == keyName;
-                     });
+  auto section = properties.find(sectionName);
+  return section != properties.end() &&
+         section->second.find(keyName) != section->second.end();
 }
 
 /* Translate properties of a specified section from the internal
- * data structure to a simple vector of key-value pairs.
+ * data structure to a simple vector of key-value pairs, ordered by key.
  */
 std::vector<ConfigFile::KeyValue>
 ConfigFile::getProperties(std::string_view sectionName) const
 {
   std::vector<KeyValue> result;
 
-  for (const auto & [key, val] : properties)
-    if (key.first == sectionName)
-      result.emplace_back(key.second, val);
+  auto section = properties.find(sectionName);
+  if (section == properties.end())
+    return result;
+
+  for (const auto & [key, val] : section->second)
+    result.emplace_back(key, val);
 
+  std::sort(result.begin(), result.end());
   return result;
 }
 
 
+/* Map the file privately, so that the parser can modify the contents
+ * in place. Files that cannot be mapped, such as pipes and empty files,
+ * are read into a buffer instead.
+ */
+void
+ConfigFile::readContents(std::string_view filename)
+{
+  const std::string name{ filename };
+
+#ifndef _MSC_VER
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("cannot open file " + name);
+
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode) &&
+      statbuf.st_size > 0)
+    {
+      void *addr = mmap(NULL, statbuf.st_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED)
+        {
+          mapAddr = static_cast<char *>(addr);
+          mapSize = statbuf.st_size;
+          madvise(addr, mapSize, MADV_SEQUENTIAL);
+        }
+    }
+  close(fd);
+
+  if (mapAddr)
+    return;
+#endif
+
+  std::ifstream file{ name, std::ios::binary };
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + name);
+
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  buffer = contents.str();
+}
+
 void
 ConfigFile::addSection(std::string_view sectionName)
 {
-  sections.emplace_back(sectionName);
+  sections.push_back(sectionName);
+  properties.emplace(sectionName, PropertyMap{});
 }
 
 void
-ConfigFile::addProperty(const PropertyName &propertyName,
+ConfigFile::addProperty(std::string_view sectionName,
+                        std::string_view keyName,
                         std::string_view value)
 {
-  properties.emplace(propertyName, value);
+  properties[sectionName].emplace(keyName, value);
 }
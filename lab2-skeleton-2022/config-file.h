@@ -9,38 +9,55 @@
 #define __CONFIG_FILE__
 
 #include <string>
+#include <string_view>
 
 #include <vector>
-#include <list>
-#include <map>
+#include <unordered_map>
 
+/* The configuration file is parsed in a single pass over the file
+ * contents, which are memory-mapped where possible. Section names, keys
+ * and values are stored as views into the file contents, so that no
+ * strings are allocated during parsing.
+ */
 class ConfigFile
 {
   public:
     using KeyValue = std::pair<std::string, std::string>;
 
     ConfigFile(std::string_view filename);
+    ~ConfigFile();
+
+    ConfigFile(const ConfigFile &) = delete;
+    ConfigFile &operator=(const ConfigFile &) = delete;
 
     void load(std::string_view filename);
 
     bool hasSection(std::string_view sectionName) const;
-    const std::list<std::string> &getSections() const;
+    const std::vector<std::string_view> &getSections() const;
 
     bool hasProperty(std::string_view sectionName,
                      std::string_view keyName) const;
     std::vector<KeyValue> getProperties(std::string_view sectionName) const;
 
   private:
-    using PropertyName = std::pair<std::string, std::string>;
-    using PropertyMap = std::map<PropertyName, std::string>;
-    PropertyMap properties{};
+    /* File contents, either mapped or read into the buffer when the
+     * file cannot be mapped (e.g. a pipe).
+     */
+    char *mapAddr = nullptr;
+    size_t mapSize = 0;
+    std::string buffer{};
+
+    using PropertyMap = std::unordered_map<std::string_view, std::string_view>;
+    std::unordered_map<std::string_view, PropertyMap> properties{};
 
-    std::list<std::string> sections{};
+    /* Sections in order of definition */
+    std::vector<std::string_view> sections{};
 
     void clear();
+    void readContents(std::string_view filename);
 
     void addSection(std::string_view sectionName);
-    void addProperty(const PropertyName &propertyName,
+    void addProperty(std::string_view sectionName, std::string_view keyName,
                      std::string_view value);
 };
 
@@ -0,0 +1,248 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    disassembler.cc - Bulk disassembly of instruction words.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "disassembler.h"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#define __builtin_bswap32 _byteswap_ulong
+#endif
+
+/* Instructions per chunk. Large enough to amortize the synchronization,
+ * small enough to keep all threads busy on images of a few megabytes.
+ */
+static constexpr size_t ChunkInstructions = 16384;
+
+/* Estimate of the length of a line, to size the chunk buffers */
+static constexpr size_t LineLength = 48;
+
+
+DisassemblyFormatter::DisassemblyFormatter(std::string &buffer)
+  : buffer{ buffer }, streamBuffer{ buffer }, os{ &streamBuffer }
+{
+}
+
+void
+DisassemblyFormatter::format(uint32_t instructionWord)
+{
+  formatInstruction(instructionWord);
+}
+
+void
+DisassemblyFormatter::format(MemAddress PC, uint32_t instructionWord)
+{
+  buffer += "0x";
+  appendHex(PC);
+  buffer += ":\t";
+  formatInstruction(instructionWord);
+}
+
+void
+DisassemblyFormatter::label(std::string_view name)
+{
+  buffer += '\n';
+  buffer += name;
+  buffer += ":\n";
+}
+
+void
+DisassemblyFormatter::appendHex(uint32_t value, int width)
+{
+  char digits[8];
+  const auto result = std::to_chars(digits, digits + sizeof(digits),
+                                    value, 16);
+  const int length = result.ptr - digits;
+
+  if (length < width)
+    buffer.append(width - length, '0');
+  buffer.append(digits, length);
+}
+
+void
+DisassemblyFormatter::formatInstruction(uint32_t instructionWord)
+{
+  buffer += "0x";
+  appendHex(instructionWord, 8);
+  buffer += '\t';
+
+  decoder.setInstructionWord(instructionWord);
+  try
+    {
+      os << decoder;
+    }
+  catch (IllegalInstruction &e)
+    {
+      buffer += "illegal instruction";
+    }
+  buffer += '\n';
+}
+
+
+/* Formats the instructions in [begin, end) of the text section, given
+ * as byte offsets, with a label before every symbol that starts there.
+ */
+static void
+formatChunk(std::string &buffer,
+            const std::byte *text, MemAddress base,
+            size_t begin, size_t end,
+            const std::vector<ELFSymbol> &symbols)
+{
+  buffer.reserve(buffer.size() +
+                 (end - begin) / INSTRUCTION_SIZE * LineLength);
+  DisassemblyFormatter formatter(buffer);
+
+  /* Symbols are sorted by address, find the first one in this chunk */
+  auto symbol = std::lower_bound(symbols.begin(), symbols.end(),
+                                 base + begin,
+                                 [](const ELFSymbol &symbol, MemAddress addr)
+                                 {
+                                   return symbol.address < addr;
+                                 });
+
+  for (size_t offset = begin; offset < end; offset += INSTRUCTION_SIZE)
+    {
+      const MemAddress PC = base + offset;
+      for (; symbol != symbols.end() &&
+             symbol->address < PC + INSTRUCTION_SIZE; ++symbol)
+        formatter.label(symbol->name);
+
+      uint32_t word;
+      std::memcpy(&word, text + offset, sizeof(word));
+      formatter.format(PC, __builtin_bswap32(word));
+    }
+
+  /* No blank line above a label at the very start of the output */
+  if (begin == 0 && ! buffer.empty() && buffer.front() == '\n')
+    buffer.erase(0, 1);
+}
+
+void
+disassembleText(std::ostream &os,
+                const std::byte *text, MemAddress base, size_t size,
+                const SymbolTable &symbols, unsigned int nThreads)
+{
+  /* Only whole instruction words are disassembled */
+  size -= size % INSTRUCTION_SIZE;
+
+  const size_t chunkSize = ChunkInstructions * INSTRUCTION_SIZE;
+  const size_t nChunks = (size + chunkSize - 1) / chunkSize;
+
+  auto chunkEnd = [&](size_t chunk)
+    {
+      return std::min(size, (chunk + 1) * chunkSize);
+    };
+
+  if (nThreads <= 1 || nChunks <= 1)
+    {
+      std::string buffer;
+      for (size_t chunk = 0; chunk < nChunks; ++chunk)
+        {
+          buffer.clear();
+          formatChunk(buffer, text, base, chunk * chunkSize, chunkEnd(chunk),
+                      symbols.getSymbols());
+          os.write(buffer.data(), buffer.size());
+        }
+      os.flush();
+      return;
+    }
+
+  /* The workers format chunks in increasing order, at most "window"
+   * chunks ahead of the chunk being written out, which bounds the
+   * memory used for large images. Every worker has its own decoder;
+   * decoding and formatting share no state, and are not instrumented
+   * with the host profile for that reason (see host-profile.h).
+   */
+  struct Chunk
+  {
+    std::string text{};
+    std::exception_ptr error{};
+    bool done = false;
+  };
+
+  std::vector<Chunk> chunks(nChunks);
+  const size_t window = 2 * nThreads;
+  size_t nextChunk = 0;
+  size_t nextWrite = 0;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  auto worker = [&]()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true)
+        {
+          changed.wait(lock, [&]()
+            {
+              return nextChunk >= nChunks || nextChunk < nextWrite + window;
+            });
+          if (nextChunk >= nChunks)
+            break;
+
+          const size_t chunk = nextChunk++;
+          lock.unlock();
+
+          std::string buffer;
+          std::exception_ptr error;
+          try
+            {
+              formatChunk(buffer, text, base, chunk * chunkSize,
+                          chunkEnd(chunk), symbols.getSymbols());
+            }
+          catch (...)
+            {
+              error = std::current_exception();
+            }
+
+          lock.lock();
+          chunks[chunk].text = std::move(buffer);
+          chunks[chunk].error = error;
+          chunks[chunk].done = true;
+          changed.notify_all();
+        }
+    };
+
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < nThreads && t < nChunks; ++t)
+    threads.emplace_back(worker);
+
+  std::exception_ptr error;
+  for (size_t chunk = 0; chunk < nChunks && !error; ++chunk)
+    {
+      std::string buffer;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return chunks[chunk].done; });
+
+        error = chunks[chunk].error;
+        buffer = std::move(chunks[chunk].text);
+        nextWrite = chunk + 1;
+
+        /* Stop handing out chunks after an error */
+        if (error)
+          nextChunk = nChunks;
+      }
+      changed.notify_all();
+
+      os.write(buffer.data(), buffer.size());
+    }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  if (error)
+    std::rethrow_exception(error);
+
+  os.flush();
+}
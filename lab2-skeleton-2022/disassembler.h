@@ -0,0 +1,93 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    disassembler.h - Bulk disassembly of instruction words.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __DISASSEMBLER_H__
+#define __DISASSEMBLER_H__
+
+#include "inst-decoder.h"
+#include "symbol-table.h"
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+/* Stream buffer that appends everything written to it to a string, so
+ * that the instruction formatter writes directly into the output
+ * buffer without flushes.
+ */
+class StringAppendBuffer : public std::streambuf
+{
+  public:
+    StringAppendBuffer(std::string &buffer)
+      : buffer{ buffer }
+    { }
+
+    StringAppendBuffer(const StringAppendBuffer &) = delete;
+    StringAppendBuffer &operator=(const StringAppendBuffer &) = delete;
+
+  protected:
+    int_type overflow(int_type ch) override
+    {
+      if (! traits_type::eq_int_type(ch, traits_type::eof()))
+        buffer.push_back(traits_type::to_char_type(ch));
+      return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize count) override
+    {
+      buffer.append(s, count);
+      return count;
+    }
+
+  private:
+    std::string &buffer;
+};
+
+/* Formats lines of disassembly into a string buffer:
+ *
+ *   0x<address>:\t0x<instruction word>\t<instruction>\n
+ *
+ * The address is left out when not known, as for instruction words
+ * given on the command line or in an ASCII file.
+ */
+class DisassemblyFormatter
+{
+  public:
+    DisassemblyFormatter(std::string &buffer);
+
+    DisassemblyFormatter(const DisassemblyFormatter &) = delete;
+    DisassemblyFormatter &operator=(const DisassemblyFormatter &) = delete;
+
+    void format(uint32_t instructionWord);
+    void format(MemAddress PC, uint32_t instructionWord);
+
+    /* Label line, preceded by a blank line, for a symbol starting at
+     * the next instruction.
+     */
+    void label(std::string_view name);
+
+  private:
+    std::string &buffer;
+    StringAppendBuffer streamBuffer;
+    std::ostream os;
+    InstructionDecoder decoder{};
+
+    void appendHex(uint32_t value, int width = 0);
+    void formatInstruction(uint32_t instructionWord);
+};
+
+/* Disassembles the big-endian instruction words of a text section of
+ * "size" bytes that starts at address "base", inserting a label before
+ * every symbol. The text is split in chunks that are formatted by
+ * nThreads threads in parallel and written to "os" in order.
+ */
+void disassembleText(std::ostream &os,
+                     const std::byte *text, MemAddress base, size_t size,
+                     const SymbolTable &symbols, unsigned int nThreads);
+
+#endif /* __DISASSEMBLER_H__ */
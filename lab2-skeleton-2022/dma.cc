@@ -0,0 +1,240 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    dma.cc - DMA controller for bulk memory copies and fills.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "dma.h"
+#include "memory-bus.h"
+#include "statistics.h"
+
+#include <algorithm>
+
+DMAController::DMAController(const MemAddress base, MemoryBus &bus,
+                             unsigned int setupCycles,
+                             unsigned int bytesPerCycle)
+  : base{ base }, bus{ bus }, setupCycles{ setupCycles },
+    bytesPerCycle{ std::max(1u, bytesPerCycle) }
+{
+}
+
+bool
+DMAController::interruptPending() const
+{
+  return (control & ControlInterrupt) && (status & StatusDone);
+}
+
+void
+DMAController::connectInterrupt(InterruptLine line)
+{
+  interruptLine = line;
+  updateInterrupt();
+}
+
+/*
+ * MemoryInterface
+ */
+
+uint8_t
+DMAController::readByte(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+uint16_t
+DMAController::readHalfWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+uint32_t
+DMAController::readWord(MemAddress addr)
+{
+  switch (addr - base)
+    {
+      case SourceOffset:
+        return source;
+      case DestinationOffset:
+        return destination;
+      case LengthOffset:
+        return length;
+      case FillValueOffset:
+        return fillValue;
+      case StatusOffset:
+        return status;
+      default:
+        throw IllegalAccess("Invalid DMA address");
+    }
+}
+
+uint64_t
+DMAController::readDoubleWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+
+void
+DMAController::writeByte(MemAddress addr, uint8_t value)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+void
+DMAController::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+void
+DMAController::writeWord(MemAddress addr, uint32_t value)
+{
+  if (addr - base == StatusOffset)
+    {
+      status &= ~(value & (StatusDone | StatusError));
+      updateInterrupt();
+      return;
+    }
+
+  if (status & StatusBusy)
+    throw IllegalAccess("DMA registers written during transfer");
+
+  switch (addr - base)
+    {
+      case SourceOffset:
+        source = value;
+        break;
+      case DestinationOffset:
+        destination = value;
+        break;
+      case LengthOffset:
+        length = value;
+        break;
+      case FillValueOffset:
+        fillValue = value;
+        break;
+      case ControlOffset:
+        start(value);
+        break;
+      default:
+        throw IllegalAccess("Invalid DMA address");
+    }
+}
+
+void
+DMAController::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  throw IllegalAccess("Not supported on DMA interface");
+}
+
+bool
+DMAController::contains(MemAddress addr) const
+{
+  return base <= addr && addr < base + EndOffset;
+}
+
+/* Called every bus clock cycle, the transfer is carried out when its
+ * cost has been paid.
+ */
+void
+DMAController::clockPulse()
+{
+  if (! (status & StatusBusy))
+    return;
+
+  ++nBusyCycles;
+  if (--remainingCycles > 0)
+    return;
+
+  transfer();
+  status = (status & ~StatusBusy) | StatusDone;
+  updateInterrupt();
+}
+
+/* The transfer is carried out in the last cycle of its cost. */
+uint64_t
+DMAController::getIdleCycles() const
+{
+  if (! (status & StatusBusy))
+    return MemoryInterface::getIdleCycles();
+
+  return remainingCycles - 1;
+}
+
+void
+DMAController::skipCycles(uint64_t cycles)
+{
+  if (! (status & StatusBusy))
+    return;
+
+  nBusyCycles += cycles;
+  remainingCycles -= cycles;
+}
+
+void
+DMAController::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("dma.transfers", "DMA transfers completed",
+                      &nTransfers);
+  registry.addCounter("dma.bytes", "Bytes transferred by DMA",
+                      &nBytesTransferred);
+  registry.addCounter("dma.busy_cycles", "Bus cycles the DMA was busy",
+                      &nBusyCycles);
+}
+
+/*
+ * Private methods
+ */
+
+void
+DMAController::start(uint32_t value)
+{
+  control = value;
+  if (! (control & ControlStart))
+    {
+      updateInterrupt();
+      return;
+    }
+
+  status = StatusBusy;
+  updateInterrupt();
+  /* In 64 bits, lengths close to 4 GiB must not wrap to a cheap transfer */
+  remainingCycles = setupCycles +
+      (uint64_t{ length } + bytesPerCycle - 1) / bytesPerCycle;
+  if (remainingCycles == 0)
+    remainingCycles = 1;
+}
+
+void
+DMAController::transfer()
+{
+  try
+    {
+      if (control & ControlFill)
+        bus.fillBlock(destination, fillValue & 0xff, length);
+      else
+        {
+          for (uint64_t offset = 0; offset < length; offset += ChunkSize)
+            {
+              const size_t size = std::min<size_t>(ChunkSize, length - offset);
+              buffer.resize(size);
+              bus.readBlock(source + offset, buffer.data(), size);
+              bus.writeBlock(destination + offset, buffer.data(), size);
+            }
+        }
+
+      ++nTransfers;
+      nBytesTransferred += length;
+    }
+  catch (IllegalAccess &)
+    {
+      status |= StatusError;
+    }
+}
+
+void
+DMAController::updateInterrupt()
+{
+  interruptLine.set(interruptPending());
+}
@@ -0,0 +1,133 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    dma.h - DMA controller for bulk memory copies and fills.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __DMA_H__
+#define __DMA_H__
+
+#include "memory-interface.h"
+#include "interrupt-controller.h"
+
+#include <vector>
+
+class MemoryBus;
+
+/* The DMA controller copies or fills blocks of guest memory without
+ * involving the processor. A transfer is programmed by writing the
+ * source, destination, length and fill value registers and then
+ * starting it through the control register. The transfer completes
+ * after a number of bus clock cycles that depends on its length, after
+ * which the data has been transferred and the done bit in the status
+ * register is set.
+ *
+ * Register map (offsets relative to base, all word registers):
+ *   0x00 - source address (copy mode)
+ *   0x04 - destination address
+ *   0x08 - length in bytes
+ *   0x0c - fill value (fill mode, lowest byte is used)
+ *   0x10 - control (write-only)
+ *            bit 0: start transfer
+ *            bit 1: fill mode (otherwise copy mode)
+ *            bit 2: raise interrupt on completion
+ *   0x14 - status (read, write 1 to clear done and error)
+ *            bit 0: busy
+ *            bit 1: done
+ *            bit 2: error, the transfer accessed an invalid address
+ *
+ * The source and destination blocks of a copy must not overlap and
+ * must each be contained within a single memory. Registers cannot be
+ * written while a transfer is in progress.
+ */
+class DMAController : public MemoryInterface
+{
+  public:
+    /* A transfer takes setupCycles plus one bus cycle per bytesPerCycle
+     * bytes.
+     */
+    DMAController(const MemAddress base, MemoryBus &bus,
+                  unsigned int setupCycles = 8,
+                  unsigned int bytesPerCycle = 8);
+    ~DMAController() override = default;
+
+    /* Level of the interrupt line: set when a transfer completed with
+     * interrupts enabled, until the done bit is cleared.
+     */
+    bool interruptPending() const;
+
+    /* Drive "line" with the interrupt level */
+    void connectInterrupt(InterruptLine line);
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override;
+
+    void clockPulse() override;
+    uint64_t getIdleCycles() const override;
+    void skipCycles(uint64_t cycles) override;
+
+    void registerStatistics(StatisticsRegistry &registry) override;
+
+    DMAController(const DMAController &) = delete;
+    DMAController &operator=(const DMAController &) = delete;
+
+  private:
+    static constexpr MemAddress SourceOffset = 0x00;
+    static constexpr MemAddress DestinationOffset = 0x04;
+    static constexpr MemAddress LengthOffset = 0x08;
+    static constexpr MemAddress FillValueOffset = 0x0c;
+    static constexpr MemAddress ControlOffset = 0x10;
+    static constexpr MemAddress StatusOffset = 0x14;
+    static constexpr MemAddress EndOffset = 0x18;
+
+    static constexpr uint32_t ControlStart = 1 << 0;
+    static constexpr uint32_t ControlFill = 1 << 1;
+    static constexpr uint32_t ControlInterrupt = 1 << 2;
+
+    static constexpr uint32_t StatusBusy = 1 << 0;
+    static constexpr uint32_t StatusDone = 1 << 1;
+    static constexpr uint32_t StatusError = 1 << 2;
+
+    /* Copies are performed in chunks of at most this size */
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    const MemAddress base;
+    MemoryBus &bus;
+
+    const unsigned int setupCycles;
+    const unsigned int bytesPerCycle;
+
+    uint32_t source{};
+    uint32_t destination{};
+    uint32_t length{};
+    uint32_t fillValue{};
+    uint32_t control{};
+    uint32_t status{};
+
+    uint64_t remainingCycles{};
+
+    InterruptLine interruptLine{};
+
+    std::vector<std::byte> buffer{};
+
+    uint64_t nTransfers{};
+    uint64_t nBytesTransferred{};
+    uint64_t nBusyCycles{};
+
+    void start(uint32_t value);
+    void transfer();
+    void updateInterrupt();
+};
+
+#endif /* __DMA_H__ */
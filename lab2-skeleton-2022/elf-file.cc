@@ -250,14 +250,13 @@ ELFFile::createMemories() const
 }
 
 bool
-ELFFile::getTextSegment(std::vector<std::byte> &segmentData,
-                        MemAddress &segmentBase,
-                        size_t &segmentSize) const
+ELFFile::getTextSection(const std::byte *&sectionData,
+                        MemAddress &sectionBase,
+                        size_t &sectionSize) const
 {
   bool found = false;
-  segmentData.clear();
 
-  foreachSegment(mapAddr, [&segmentData, &segmentBase, &segmentSize, &found](const Elf32_Ehdr *elf, const Elf32_Shdr &header) -> void
+  foreachSegment(mapAddr, [&sectionData, &sectionBase, &sectionSize, &found](const Elf32_Ehdr *elf, const Elf32_Shdr &header) -> void
     {
       Elf32_Word sh_flags = __builtin_bswap32(header.sh_flags);
       Elf32_Word sh_size = __builtin_bswap32(header.sh_size);
@@ -267,19 +266,14 @@ ELFFile::getTextSegment(std::vector<std::byte> &segmentData,
       if ((sh_flags & SHF_EXECINSTR) != SHF_EXECINSTR)
         return;
 
-       segmentData.resize(sh_size);
+      sectionData = reinterpret_cast<const std::byte *>(elf) + sh_offset;
+      sectionBase = sh_addr;
+      sectionSize = sh_size;
 
-       const auto *segdata =
-           reinterpret_cast<const std::byte *>(elf) + sh_offset;
-       std::copy_n(segdata, sh_size, segmentData.begin());
-
-       segmentBase = sh_addr;
-       segmentSize = sh_size;
-
-       found = true;
+      found = true;
     });
 
-    return found;
+  return found;
 }
 
 uint64_t
@@ -287,3 +281,68 @@ ELFFile::getEntrypoint() const
 {
   return __builtin_bswap32(static_cast<Elf64_Ehdr *>(mapAddr)->e_entry);
 }
+
+std::vector<ELFSymbol>
+ELFFile::getSymbols() const
+{
+  std::vector<ELFSymbol> symbols;
+
+  const auto *elf = static_cast<const Elf32_Ehdr *>(mapAddr);
+  const auto *base = static_cast<const std::byte *>(mapAddr);
+  const auto *sheaders = reinterpret_cast<const Elf32_Shdr *>(base + __builtin_bswap32(elf->e_shoff));
+  const int shnum = __builtin_bswap16(elf->e_shnum);
+
+  for (int i = 0; i < shnum; ++i)
+    {
+      const Elf32_Shdr &symtab = sheaders[i];
+      if (__builtin_bswap32(symtab.sh_type) != SHT_SYMTAB)
+        continue;
+
+      /* The linked section holds the symbol names. */
+      Elf32_Word link = __builtin_bswap32(symtab.sh_link);
+      if (link >= static_cast<Elf32_Word>(shnum))
+        continue;
+
+      const Elf32_Shdr &strtab = sheaders[link];
+      const auto *strings = reinterpret_cast<const char *>(base + __builtin_bswap32(strtab.sh_offset));
+      const Elf32_Word stringsSize = __builtin_bswap32(strtab.sh_size);
+
+      const auto *syms = reinterpret_cast<const Elf32_Sym *>(base + __builtin_bswap32(symtab.sh_offset));
+      const size_t count = __builtin_bswap32(symtab.sh_size) / sizeof(Elf32_Sym);
+
+      for (size_t j = 0; j < count; ++j)
+        {
+          const Elf32_Sym &sym = syms[j];
+          const unsigned char type = sym.st_info & 0xf;
+          const unsigned char binding = sym.st_info >> 4;
+          const Elf32_Word name = __builtin_bswap32(sym.st_name);
+          const Elf32_Half shndx = __builtin_bswap16(sym.st_shndx);
+
+          /* Functions, and global labels defined in assembly files that
+           * lack a type.
+           */
+          if (type != STT_FUNC && !(type == STT_NOTYPE && binding == STB_GLOBAL))
+            continue;
+
+          /* Skip undefined, absolute and other special symbols, and
+           * symbols that do not refer to code.
+           */
+          if (shndx == 0 || shndx >= shnum || name == 0 || name >= stringsSize)
+            continue;
+
+          const Elf32_Shdr &section = sheaders[shndx];
+          const Elf32_Addr value = __builtin_bswap32(sym.st_value);
+          const Elf32_Addr sectionAddr = __builtin_bswap32(section.sh_addr);
+          if ((__builtin_bswap32(section.sh_flags) & SHF_EXECINSTR) != SHF_EXECINSTR ||
+              value < sectionAddr ||
+              value >= sectionAddr + __builtin_bswap32(section.sh_size))
+            continue;
+
+          symbols.push_back(ELFSymbol{ value,
+                                       __builtin_bswap32(sym.st_size),
+                                       std::string{ strings + name } });
+        }
+    }
+
+  return symbols;
+}
@@ -18,6 +18,14 @@
 #include <windows.h>
 #endif
 
+/* A function symbol from the ELF symbol table. */
+struct ELFSymbol
+{
+  MemAddress address{};
+  size_t size{};
+  std::string name{};
+};
+
 /* The ELFFile class loads a program from an ELF file by creating memories
  * for every section that needs to be loaded. During construction of
  * the Processor class, these memories are added to the memory bus
@@ -33,11 +41,18 @@ class ELFFile
     void unload();
 
     std::vector<std::unique_ptr<MemoryInterface>> createMemories() const;
-    bool getTextSegment(std::vector<std::byte> &segmentData,
-                        MemAddress &segmentBase,
-                        size_t &segmentSize) const;
+
+    /* Points sectionData into the mapped file, which stays valid for
+     * the lifetime of this object, rather than copying the section.
+     */
+    bool getTextSection(const std::byte *&sectionData,
+                        MemAddress &sectionBase,
+                        size_t &sectionSize) const;
     uint64_t getEntrypoint() const;
 
+    /* Returns the function symbols found in .symtab, in table order. */
+    std::vector<ELFSymbol> getSymbols() const;
+
 
     ELFFile(const ELFFile &) = delete;
     ELFFile &operator=(const ELFFile &) = delete;
@@ -0,0 +1,70 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    event-scheduler.cc - Queue of device events in simulated time.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "event-scheduler.h"
+
+#include <algorithm>
+
+EventScheduler::EventID
+EventScheduler::schedule(uint64_t cycle, Callback callback)
+{
+  const EventID id = nextID++;
+
+  events.push_back(Event{ cycle, id, std::move(callback) });
+  std::push_heap(events.begin(), events.end(), later);
+  nextEventCycle = std::min(nextEventCycle, cycle);
+
+  return id;
+}
+
+/* Cancelled events are dropped when they reach the front of the queue. */
+void
+EventScheduler::cancel(EventID id)
+{
+  if (id == 0 || id >= nextID)
+    return;
+
+  cancelled.insert(id);
+  updateNextEvent();
+}
+
+void
+EventScheduler::runDue(uint64_t now)
+{
+  while (! events.empty() && events.front().cycle <= now)
+    {
+      Event event = std::move(events.front());
+      pop();
+
+      if (cancelled.erase(event.id) == 0)
+        event.callback(event.cycle);
+    }
+
+  updateNextEvent();
+}
+
+bool
+EventScheduler::later(const Event &a, const Event &b)
+{
+  return a.cycle > b.cycle || (a.cycle == b.cycle && a.id > b.id);
+}
+
+void
+EventScheduler::pop()
+{
+  std::pop_heap(events.begin(), events.end(), later);
+  events.pop_back();
+}
+
+void
+EventScheduler::updateNextEvent()
+{
+  while (! events.empty() && cancelled.erase(events.front().id) > 0)
+    pop();
+
+  nextEventCycle = events.empty() ? Never : events.front().cycle;
+}
@@ -0,0 +1,69 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    event-scheduler.h - Queue of device events in simulated time.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __EVENT_SCHEDULER_H__
+#define __EVENT_SCHEDULER_H__
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+/* Devices that need to act at a given clock cycle, such as a timer
+ * reaching its deadline, schedule an event instead of counting down in
+ * every clock cycle. The processor main loop only has to compare the
+ * cycle counter with the cycle of the earliest event.
+ */
+class EventScheduler
+{
+  public:
+    using Callback = std::function<void(uint64_t cycle)>;
+    using EventID = uint64_t;
+
+    static constexpr uint64_t Never = std::numeric_limits<uint64_t>::max();
+
+    EventScheduler() = default;
+
+    EventScheduler(const EventScheduler &) = delete;
+    EventScheduler &operator=(const EventScheduler &) = delete;
+
+    /* The callback is called with the cycle the event was scheduled at.
+     * Events at the same cycle run in the order they were scheduled.
+     */
+    EventID schedule(uint64_t cycle, Callback callback);
+    void cancel(EventID id);
+
+    uint64_t getNextEventCycle() const
+    {
+      return nextEventCycle;
+    }
+
+    /* Runs all events scheduled at or before cycle "now" */
+    void runDue(uint64_t now);
+
+  private:
+    struct Event
+    {
+      uint64_t cycle;
+      EventID id;
+      Callback callback;
+    };
+
+    /* Min-heap on (cycle, id) */
+    std::vector<Event> events{};
+    std::unordered_set<EventID> cancelled{};
+
+    EventID nextID = 1;
+    uint64_t nextEventCycle = Never;
+
+    static bool later(const Event &a, const Event &b);
+    void pop();
+    void updateNextEvent();
+};
+
+#endif /* __EVENT_SCHEDULER_H__ */
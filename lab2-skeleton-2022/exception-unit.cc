@@ -0,0 +1,92 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    exception-unit.cc - Supervision register and exception entry/return.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "exception-unit.h"
+#include "inst-decoder.h"
+
+#include <string>
+
+ExceptionUnit::ExceptionUnit(bool &flag, FPU &fpu)
+  : flag{ flag }, fpu{ fpu }
+{
+}
+
+MemAddress
+ExceptionUnit::enter(MemAddress vector, MemAddress returnAddress)
+{
+  EPCR = returnAddress;
+  ESR = getSR();
+
+  SR = (SR | SR_SM) & ~(SR_TEE | SR_IEE | SR_DSX);
+  return vector;
+}
+
+MemAddress
+ExceptionUnit::returnFromException()
+{
+  setSR(ESR);
+  return EPCR;
+}
+
+uint32_t
+ExceptionUnit::readSPR(uint16_t spr) const
+{
+  switch (spr)
+    {
+      case SPR_SR:
+        return getSR();
+      case SPR_EPCR0:
+        return EPCR;
+      case SPR_ESR0:
+        return ESR;
+      case FPU::SPR_FPCSR:
+        return fpu.getFPCSR();
+      default:
+        throw IllegalInstruction("Unsupported special-purpose register " +
+                                 std::to_string(spr));
+    }
+}
+
+void
+ExceptionUnit::writeSPR(uint16_t spr, uint32_t value)
+{
+  switch (spr)
+    {
+      case SPR_SR:
+        setSR(value);
+        break;
+      case SPR_EPCR0:
+        EPCR = value;
+        break;
+      case SPR_ESR0:
+        ESR = value;
+        break;
+      case FPU::SPR_FPCSR:
+        fpu.setFPCSR(value);
+        break;
+      default:
+        throw IllegalInstruction("Unsupported special-purpose register " +
+                                 std::to_string(spr));
+    }
+}
+
+/*
+ * Private methods
+ */
+
+uint32_t
+ExceptionUnit::getSR() const
+{
+  return SR | (flag ? SR_F : 0);
+}
+
+void
+ExceptionUnit::setSR(uint32_t value)
+{
+  SR = (value & ~SR_F) | SR_FO;
+  flag = value & SR_F;
+}
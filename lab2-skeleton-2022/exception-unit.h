@@ -0,0 +1,84 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    exception-unit.h - Supervision register and exception entry/return.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __EXCEPTION_UNIT_H__
+#define __EXCEPTION_UNIT_H__
+
+#include "arch.h"
+#include "fpu.h"
+
+/* Holds the supervision register (SR) and the exception registers of
+ * the OpenRISC architecture. On exception entry the PC and SR are saved
+ * in EPCR and ESR, supervisor mode is entered with interrupts disabled
+ * and execution continues at the exception vector; l.rfe restores them.
+ *
+ * The flag bit of SR is the flag shared by the pipeline stages, so that
+ * it is saved and restored together with the other bits. The FPCSR
+ * special-purpose register is held by the FPU.
+ */
+class ExceptionUnit
+{
+  public:
+    /* Exception vectors */
+    static constexpr MemAddress TickTimerVector = 0x500;
+    static constexpr MemAddress ExternalInterruptVector = 0x800;
+    static constexpr MemAddress FloatingPointVector = 0xd00;
+
+    /* Special-purpose register numbers, for l.mfspr and l.mtspr */
+    static constexpr uint16_t SPR_SR = 17;
+    static constexpr uint16_t SPR_EPCR0 = 32;
+    static constexpr uint16_t SPR_ESR0 = 64;
+
+    /* Supervision register bits */
+    static constexpr uint32_t SR_SM = 1 << 0;    /* supervisor mode */
+    static constexpr uint32_t SR_TEE = 1 << 1;   /* tick timer exceptions */
+    static constexpr uint32_t SR_IEE = 1 << 2;   /* external interrupts */
+    static constexpr uint32_t SR_F = 1 << 9;     /* flag */
+    static constexpr uint32_t SR_DSX = 1 << 13;  /* exception in delay slot */
+    static constexpr uint32_t SR_FO = 1 << 15;   /* fixed one */
+
+    ExceptionUnit(bool &flag, FPU &fpu);
+
+    ExceptionUnit(const ExceptionUnit &) = delete;
+    ExceptionUnit &operator=(const ExceptionUnit &) = delete;
+
+    bool tickTimerEnabled() const
+    {
+      return SR & SR_TEE;
+    }
+
+    bool externalInterruptsEnabled() const
+    {
+      return SR & SR_IEE;
+    }
+
+    /* Enters the exception handler at "vector", execution is to resume
+     * at "returnAddress". Returns the new PC.
+     */
+    MemAddress enter(MemAddress vector, MemAddress returnAddress);
+
+    /* l.rfe, returns the new PC */
+    MemAddress returnFromException();
+
+    /* Throw IllegalInstruction for unknown registers */
+    uint32_t readSPR(uint16_t spr) const;
+    void writeSPR(uint16_t spr, uint32_t value);
+
+  private:
+    bool &flag;
+    FPU &fpu;
+
+    /* SR without the flag bit, which is kept in "flag" */
+    uint32_t SR{ SR_SM | SR_FO };
+    uint32_t EPCR{};
+    uint32_t ESR{};
+
+    uint32_t getSR() const;
+    void setSR(uint32_t value);
+};
+
+#endif /* __EXCEPTION_UNIT_H__ */
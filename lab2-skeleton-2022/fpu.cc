@@ -0,0 +1,211 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    fpu.cc - Single-precision floating-point unit (ORFPX32).
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "fpu.h"
+#include "inst-decoder.h"
+
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+
+/* The host rounding mode and exception flags are accessed around every
+ * operation. The operands are read through volatile variables after the
+ * rounding mode has been set and the result is written to a volatile
+ * variable before the flags are tested, so that the compiler cannot move
+ * the operation outside this window. The Makefile also compiles this
+ * file with -frounding-math.
+ */
+#ifdef _MSC_VER
+#pragma fenv_access (on)
+#endif
+
+FPUOp
+getFPUOp(uint32_t function)
+{
+  switch (function)
+    {
+      case 0x00: return FPUOp::Add;
+      case 0x01: return FPUOp::Sub;
+      case 0x02: return FPUOp::Mul;
+      case 0x03: return FPUOp::Div;
+      case 0x04: return FPUOp::IntToFloat;
+      case 0x05: return FPUOp::FloatToInt;
+      case 0x06: return FPUOp::Rem;
+      case 0x07: return FPUOp::MulAdd;
+      case 0x08: return FPUOp::SetFlagEQ;
+      case 0x09: return FPUOp::SetFlagNE;
+      case 0x0a: return FPUOp::SetFlagGT;
+      case 0x0b: return FPUOp::SetFlagGE;
+      case 0x0c: return FPUOp::SetFlagLT;
+      case 0x0d: return FPUOp::SetFlagLE;
+      default:
+        throw IllegalInstruction("Unsupported floating-point instruction");
+    }
+}
+
+static float
+toFloat(RegValue value)
+{
+  float f;
+  std::memcpy(&f, &value, sizeof(f));
+  return f;
+}
+
+static RegValue
+toBits(float f)
+{
+  RegValue value;
+  std::memcpy(&value, &f, sizeof(value));
+  return value;
+}
+
+static bool
+isSignalingNaN(RegValue value)
+{
+  return (value & 0x7f800000) == 0x7f800000 && (value & 0x003fffff) != 0 &&
+      (value & 0x00400000) == 0;
+}
+
+/* Rounds according to the current rounding mode. NaNs and values out
+ * of range are invalid and result in the most negative integer, like
+ * on x86 hosts.
+ */
+static RegValue
+floatToInt(float value)
+{
+  const float rounded = std::rint(value);
+  if (! (rounded >= -2147483648.0f && rounded < 2147483648.0f))
+    {
+      std::feraiseexcept(FE_INVALID);
+      return 0x80000000;
+    }
+
+  return static_cast<RegValue>(static_cast<int32_t>(rounded));
+}
+
+static constexpr int hostRoundingModes[] =
+{
+  FE_TONEAREST,
+  FE_TOWARDZERO,
+  FE_UPWARD,
+  FE_DOWNWARD
+};
+
+RegValue
+FPU::execute(FPUOp op, RegValue A, RegValue B, RegValue D)
+{
+  const uint32_t mode = (FPCSR & FPCSR_RM) >> FPCSR_RM_SHIFT;
+  if (mode != RoundNearest)
+    std::fesetround(hostRoundingModes[mode]);
+  std::feclearexcept(FE_ALL_EXCEPT);
+
+  volatile float a = toFloat(A);
+  volatile float b = toFloat(B);
+  volatile float r = 0.0f;
+  volatile RegValue integer = 0;
+  bool floatResult = true;
+
+  switch (op)
+    {
+      case FPUOp::Add:
+        r = a + b;
+        break;
+      case FPUOp::Sub:
+        r = a - b;
+        break;
+      case FPUOp::Mul:
+        r = a * b;
+        break;
+      case FPUOp::Div:
+        r = a / b;
+        break;
+      case FPUOp::IntToFloat:
+        r = static_cast<float>(static_cast<int32_t>(A));
+        break;
+      case FPUOp::FloatToInt:
+        integer = floatToInt(a);
+        floatResult = false;
+        break;
+      case FPUOp::Rem:
+        r = std::remainder(static_cast<float>(a), static_cast<float>(b));
+        break;
+      case FPUOp::MulAdd:
+        /* Rounded once, like a fused multiply-add */
+        r = std::fma(static_cast<float>(a), static_cast<float>(b),
+                     toFloat(D));
+        break;
+
+      /* Equality compares are quiet, the others signal invalid for NaN
+       * operands.
+       */
+      case FPUOp::SetFlagEQ:
+        integer = a == b;
+        floatResult = false;
+        break;
+      case FPUOp::SetFlagNE:
+        integer = a != b;
+        floatResult = false;
+        break;
+      case FPUOp::SetFlagGT:
+        integer = a > b;
+        floatResult = false;
+        break;
+      case FPUOp::SetFlagGE:
+        integer = a >= b;
+        floatResult = false;
+        break;
+      case FPUOp::SetFlagLT:
+        integer = a < b;
+        floatResult = false;
+        break;
+      case FPUOp::SetFlagLE:
+        integer = a <= b;
+        floatResult = false;
+        break;
+    }
+
+  const int raised = std::fetestexcept(FE_ALL_EXCEPT);
+  if (mode != RoundNearest)
+    std::fesetround(FE_TONEAREST);
+
+  uint32_t flags = 0;
+  if (raised & FE_OVERFLOW)
+    flags |= FPCSR_OVF;
+  if (raised & FE_UNDERFLOW)
+    flags |= FPCSR_UNF;
+  if (raised & FE_INEXACT)
+    flags |= FPCSR_IXF;
+  if (raised & FE_INVALID)
+    flags |= FPCSR_IVF;
+  if (raised & FE_DIVBYZERO)
+    flags |= FPCSR_DZF;
+
+  const bool unary = op == FPUOp::IntToFloat || op == FPUOp::FloatToInt;
+  if ((op != FPUOp::IntToFloat && isSignalingNaN(A)) ||
+      (! unary && isSignalingNaN(B)) ||
+      (op == FPUOp::MulAdd && isSignalingNaN(D)))
+    flags |= FPCSR_SNF;
+
+  RegValue result = integer;
+  if (floatResult)
+    {
+      const float value = r;
+      result = toBits(value);
+
+      if (std::isnan(value))
+        flags |= FPCSR_QNF;
+      else if (value == 0.0f)
+        flags |= FPCSR_ZF;
+      else if (std::isinf(value))
+        flags |= FPCSR_INF;
+    }
+
+  lastFlags = flags;
+  FPCSR |= flags;
+
+  return result;
+}
@@ -0,0 +1,102 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    fpu.h - Single-precision floating-point unit (ORFPX32).
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __FPU_H__
+#define __FPU_H__
+
+#include "arch.h"
+
+enum class FPUOp
+{
+  Add,
+  Sub,
+  Mul,
+  Div,
+  IntToFloat,
+  FloatToInt,
+  Rem,
+  MulAdd,
+  SetFlagEQ,
+  SetFlagNE,
+  SetFlagGT,
+  SetFlagGE,
+  SetFlagLT,
+  SetFlagLE
+};
+
+/* FPU operation of the floating-point instruction (major opcode 0x32)
+ * with function code "function", see InstructionDecoder::getFunction().
+ * Throws IllegalInstruction for unsupported instructions.
+ */
+FPUOp getFPUOp(uint32_t function);
+
+
+/* The FPU executes the single-precision lf.* instructions on the host
+ * FPU, in the rounding mode selected in the floating-point control and
+ * status register (FPCSR). The exceptions raised by the host operation
+ * are accumulated in the flags of FPCSR until software clears them.
+ * Operands and results are the bit patterns of the registers.
+ */
+class FPU
+{
+  public:
+    /* Special-purpose register number of FPCSR */
+    static constexpr uint16_t SPR_FPCSR = 20;
+
+    /* FPCSR bits */
+    static constexpr uint32_t FPCSR_FPEE = 1 << 0;  /* exceptions enabled */
+    static constexpr uint32_t FPCSR_RM_SHIFT = 1;   /* rounding mode */
+    static constexpr uint32_t FPCSR_RM = 3 << FPCSR_RM_SHIFT;
+    static constexpr uint32_t FPCSR_OVF = 1 << 3;   /* overflow */
+    static constexpr uint32_t FPCSR_UNF = 1 << 4;   /* underflow */
+    static constexpr uint32_t FPCSR_SNF = 1 << 5;   /* signaling NaN */
+    static constexpr uint32_t FPCSR_QNF = 1 << 6;   /* quiet NaN */
+    static constexpr uint32_t FPCSR_ZF = 1 << 7;    /* zero */
+    static constexpr uint32_t FPCSR_IXF = 1 << 8;   /* inexact */
+    static constexpr uint32_t FPCSR_IVF = 1 << 9;   /* invalid */
+    static constexpr uint32_t FPCSR_INF = 1 << 10;  /* infinity */
+    static constexpr uint32_t FPCSR_DZF = 1 << 11;  /* divide by zero */
+    static constexpr uint32_t FPCSR_FLAGS = 0x1ff << 3;
+
+    /* Rounding modes */
+    static constexpr uint32_t RoundNearest = 0;
+    static constexpr uint32_t RoundZero = 1;
+    static constexpr uint32_t RoundUp = 2;
+    static constexpr uint32_t RoundDown = 3;
+
+    FPU() = default;
+
+    /* Executes "op" on the operands; "D" is the accumulator of
+     * lf.madd.s. The compares result in 1 if the compare is true and
+     * in 0 otherwise, to be written to the flag.
+     */
+    RegValue execute(FPUOp op, RegValue A, RegValue B, RegValue D = 0);
+
+    /* Whether the last operation raised an exception that is enabled
+     * in FPCSR, such that the floating-point exception is to be taken.
+     */
+    bool exceptionPending() const
+    {
+      return (FPCSR & FPCSR_FPEE) && lastFlags != 0;
+    }
+
+    uint32_t getFPCSR() const
+    {
+      return FPCSR;
+    }
+
+    void setFPCSR(uint32_t value)
+    {
+      FPCSR = value & (FPCSR_FPEE | FPCSR_RM | FPCSR_FLAGS);
+    }
+
+  private:
+    uint32_t FPCSR{};
+    uint32_t lastFlags{};
+};
+
+#endif /* __FPU_H__ */
@@ -23,11 +23,20 @@
  * - The framebuffer is just a large chunk of memory uploaded to a texture
  *   and rendered to the screen. This isn't the most efficient method
  *   but it is very simple in its design. For the indexed/Y8 modes
- *   we translate it to RGBA8888 first.
+ *   we translate it to RGBA8888 first, a row at a time using the
+ *   vector kernels from pixel-convert.h.
  * - Two base memory addresses, one for control/palette which only accepts
  *   aligned word size writes.
  *   The other writes directly to the framebuffer memory we allocate.
- * - Refreshes happen every X bus cycles if any of the memory changed.
+ * - Writes record, per row, the number of the frame in which the row
+ *   last changed. Only changed rows are copied to a frame and converted
+ *   and uploaded to the texture, so that small updates at large
+ *   resolutions are cheap. Palette changes dirty the whole screen.
+ * - Rendering runs on its own thread, which owns all SDL state. Every
+ *   X bus cycles, if any of the memory changed, the simulation thread
+ *   publishes a frame through a triple buffer and continues without
+ *   waiting for the display. Key events are passed back through a
+ *   lock-free queue and handled at the next publish.
  *   Refresh frequency can be adjusted with up/down arrow keys.
  *
  * Relevant addresses:
@@ -50,18 +59,14 @@
 #include <SDL_video.h>
 #include <SDL_events.h>
 
+#include "pixel-convert.h"
+#include "statistics.h"
+
+#include <algorithm>
 /* PRIu64 on MSVC */
 #include <cinttypes>
-
-enum FBmode
-{
-  FBMODE_Y8 = 0,
-  FBMODE_INDEXED,
-  FBMODE_RGB332,
-  FBMODE_RGB555,
-  FBMODE_RGB24,
-  FBMODE_RGBA32
-};
+#include <chrono>
+#include <cstring>
 
 /* We map most of our modes directly to SDL modes */
 static int
@@ -77,7 +82,7 @@ sdl_mode_map[] =
 
 /* bytes per pixel */
 static const
-int mem_mult[] =
+uint32_t mem_mult[] =
 {
   1, //Y8
   1, //INDEXED
@@ -87,44 +92,50 @@ int mem_mult[] =
   4  //RGBA32
 };
 
+/* Time the render thread sleeps when there is nothing to do */
+static constexpr uint32_t RenderIdleDelay = 5; /* ms */
+
 
 /*
  * RenderContext: Useful context for the current window and its contents.
- * Internal class.
+ * Internal class, only used on the render thread.
  */
 
 class RenderContext
 {
   public:
-    RenderContext(const uint32_t resx, const uint32_t resy,
-                  const uint32_t mode);
+    RenderContext(const FrameSnapshot &frame);
     ~RenderContext();
 
-    void redrawScreen();
+    uint32_t redrawScreen(const FrameSnapshot &frame);
+    void present();
 
     RenderContext(const RenderContext &) = delete;
     RenderContext &operator=(const RenderContext &) = delete;
 
-    /* public members, will be accessed directly by class FrameBuffer. */
     SDL_Window   *window{};
     SDL_Renderer *renderer{};
     SDL_Texture  *texture{};
-    uint8_t      *mem{};
-    size_t        memsize{};
 
-    bool active = false;
-    bool changed = true;
+    const uint64_t generation;
+
+  private:
     uint32_t mode;
     uint32_t resx;
     uint32_t resy;
-};
+    uint32_t pitch;
 
-static uint32_t palette[256];
+    /* Frame number of the uploaded contents of every row */
+    std::vector<uint32_t> uploadedVersions{};
+
+    void convertRows(const FrameSnapshot &frame, uint32_t begin, uint32_t end);
+};
 
 
-RenderContext::RenderContext(const uint32_t resx, const uint32_t resy,
-                             const uint32_t mode)
-  : mode{ mode }, resx{ resx }, resy{ resy }
+RenderContext::RenderContext(const FrameSnapshot &frame)
+  : generation{ frame.generation }, mode{ frame.mode }, resx{ frame.resx },
+    resy{ frame.resy }, pitch{ frame.resx * mem_mult[frame.mode] },
+    uploadedVersions(frame.resy)
 {
   /* Create a new window/renderer/texture */
   if (SDL_CreateWindowAndRenderer(resx, resy, 0,
@@ -143,12 +154,10 @@ RenderContext::RenderContext(const uint32_t resx, const uint32_t resy,
     {
       SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                    "Couldn't create texture: %s", SDL_GetError());
+      SDL_DestroyRenderer(renderer);
+      SDL_DestroyWindow(window);
       throw std::runtime_error("Error creating texture");
     }
-
-  memsize = resx * resy * mem_mult[mode];
-  mem = (uint8_t *) calloc(memsize, sizeof(uint8_t));
-  active  = true;
 }
 
 RenderContext::~RenderContext()
@@ -160,47 +169,85 @@ RenderContext::~RenderContext()
     SDL_DestroyRenderer(renderer);
   if (window)
     SDL_DestroyWindow(window);
-  if (mem)
-    free(mem);
 }
 
+/* Update the changed parts of the texture and render it to the window.
+ * Returns the number of rows that were converted and uploaded.
+ */
+uint32_t
+RenderContext::redrawScreen(const FrameSnapshot &frame)
+{
+  uint32_t nRows = 0;
+
+  for (uint32_t row = 0; row < resy; )
+    {
+      if (frame.rowVersions[row] == uploadedVersions[row])
+        {
+          ++row;
+          continue;
+        }
+
+      /* Upload spans of consecutive changed rows at once */
+      const uint32_t begin = row;
+      for (; row < resy && frame.rowVersions[row] != uploadedVersions[row]; ++row)
+        uploadedVersions[row] = frame.rowVersions[row];
+
+      convertRows(frame, begin, row);
+      nRows += row - begin;
+    }
+
+  present();
+  return nRows;
+}
+
+void
+RenderContext::present()
+{
+  SDL_RenderCopy(renderer, texture, 0, 0);
+  SDL_RenderPresent(renderer);
+}
 
-/* Update the texture and render it to the window */
-void RenderContext::redrawScreen()
+/* Upload the rows [begin, end) to the texture, converting them to
+ * RGBA8888 first for the Y8 and indexed modes.
+ */
+void
+RenderContext::convertRows(const FrameSnapshot &frame,
+                           uint32_t begin, uint32_t end)
 {
+  const SDL_Rect rect{ 0, static_cast<int>(begin),
+                       static_cast<int>(resx), static_cast<int>(end - begin) };
+  const uint8_t *mem = frame.mem.data();
+
   switch(mode)
     {
       case FBMODE_RGB332:
       case FBMODE_RGB555:
       case FBMODE_RGB24:
       case FBMODE_RGBA32:
-          SDL_UpdateTexture(texture, NULL, mem, resx * mem_mult[mode]);
+          SDL_UpdateTexture(texture, &rect, &mem[begin * pitch], pitch);
           break;
 
       case FBMODE_Y8:
       case FBMODE_INDEXED:
+        {
+          const PixelConversion &convert = getPixelConversion();
           uint8_t * pixels;
-          int pitch;
-          SDL_LockTexture(texture, NULL, (void**)&pixels, &pitch);
-          for (uint32_t y = 0; y < resy; y++)
-            for (uint32_t x = 0; x < resx; x++)
-              {
-                uint32_t * p = (uint32_t *)&pixels[pitch * y + x * sizeof(uint32_t)];
-                uint8_t mval = mem[y * resx + x];
-                uint32_t pval = 0;
-                if (mode == FBMODE_Y8)
-                  pval = mval << 24 | mval << 16 | mval << 8 | 0xff;
-                else if (mode == FBMODE_INDEXED)
-                  pval = palette[mval];
-                *p = pval;
+          int texturePitch;
+          /* pixels points at the start of rect */
+          SDL_LockTexture(texture, &rect, (void**)&pixels, &texturePitch);
+          for (uint32_t y = begin; y < end; y++)
+            {
+              uint32_t * row = (uint32_t *)&pixels[texturePitch * (y - begin)];
+              if (mode == FBMODE_Y8)
+                convert.y8(&mem[y * resx], row, resx);
+              else
+                convert.indexed(&mem[y * resx], row, resx,
+                                frame.palette.data());
             }
           SDL_UnlockTexture(texture);
           break;
+        }
     }
-
-  SDL_RenderCopy(renderer, texture, 0, 0);
-  SDL_RenderPresent(renderer);
-  changed = false;
 }
 
 
@@ -210,94 +257,293 @@ void RenderContext::redrawScreen()
 
 Framebuffer::Framebuffer(const MemAddress control_base,
                          const MemAddress framebuffer_base)
-  : control_base{ control_base }, framebuffer_base{ framebuffer_base },
-    context{}
+  : control_base{ control_base }, framebuffer_base{ framebuffer_base }
 {
-  if (SDL_Init(SDL_INIT_VIDEO) < 0)
+  /* SDL is initialized on the render thread, report failures here */
+  std::promise<void> initialized;
+  auto result = initialized.get_future();
+
+  renderThread = std::thread(&Framebuffer::renderLoop, this,
+                             std::move(initialized));
+  try
     {
-      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                   "Couldn't init SDL: %s", SDL_GetError());
-      SDL_Quit();
-      throw std::runtime_error("Error initialising SDL");
+      result.get();
+    }
+  catch (...)
+    {
+      renderThread.join();
+      throw;
     }
 }
 
 Framebuffer::~Framebuffer()
 {
-  finished = true;
-  processEvents(true);
+  /* The render thread keeps the window open until the user quits */
+  publishFrame(true);
+  renderThread.join();
+}
+
+void
+Framebuffer::enable()
+{
+  if (control.mode > FBMODE_RGBA32)
+    throw IllegalAccess("Invalid framebuffer mode " +
+                        std::to_string(control.mode));
+
+  pitch = control.resx * mem_mult[control.mode];
+  mem.assign(size_t{ pitch } * control.resy, 0);
+  rowVersions.assign(control.resy, 0);
+  markAllDirty();
+
+  ++generation;
+  active_window = true;
+  control.enable = 1;
+
+  /* Open the window right away */
+  publishFrame(false);
+}
+
+void
+Framebuffer::disable()
+{
+  active_window = false;
+  control.enable = 0;
+  mem.clear();
+
+  publishFrame(false);
+}
+
+void
+Framebuffer::markDirty(uint32_t offset, uint32_t size)
+{
+  const uint32_t last = (offset + size - 1) / pitch;
+
+  for (uint32_t row = offset / pitch; row <= last; ++row)
+    rowVersions[row] = currentFrame;
+  changed = true;
+}
+
+void
+Framebuffer::markAllDirty()
+{
+  std::fill(rowVersions.begin(), rowVersions.end(), currentFrame);
+  changed = true;
+}
+
+/* Handle the events sent by the render thread since the last frame. */
+void
+Framebuffer::handleEvents()
+{
+  FramebufferEvent event;
+
+  while (events.tryPop(event))
+    {
+      switch (event)
+        {
+          case FramebufferEvent::Quit:
+            /* The render thread already closed the window */
+            if (active_window)
+              {
+                active_window = false;
+                control.enable = 0;
+                mem.clear();
+              }
+            break;
+
+          case FramebufferEvent::FasterUpdates:
+            if (update_freq > 10)
+              update_freq /= 10;
+            changed = true;
+            break;
+
+          case FramebufferEvent::SlowerUpdates:
+            if (update_freq < 10000000)
+              update_freq *= 10;
+            changed = true;
+            break;
+        }
+    }
+}
+
+/* Copy the rows that changed since the back buffer was last published,
+ * and hand it over to the render thread.
+ */
+void
+Framebuffer::publishFrame(bool finished)
+{
+  FrameSnapshot &frame = frames.back();
+
+  frame.enabled = active_window;
+  frame.finished = finished;
+  frame.updateFreq = update_freq;
+
   if (active_window)
     {
-      SDL_SetWindowTitle(context->window, "Simulation over, press q/ESC to quit");
-      while (active_window)
+      if (frame.generation != generation)
         {
-          processEvents(true);
-          SDL_Delay(200);
+          frame.generation = generation;
+          frame.mode = control.mode;
+          frame.resx = control.resx;
+          frame.resy = control.resy;
+          frame.mem.resize(mem.size());
+          frame.rowVersions.assign(control.resy, 0);
         }
+
+      for (uint32_t row = 0; row < frame.resy; ++row)
+        if (frame.rowVersions[row] != rowVersions[row])
+          {
+            std::memcpy(&frame.mem[size_t{ row } * pitch],
+                        &mem[size_t{ row } * pitch], pitch);
+            frame.rowVersions[row] = rowVersions[row];
+          }
+
+      frame.palette = palette;
     }
 
-  if (context)
-    context.reset(nullptr);
+  frames.publish();
+  ++currentFrame;
+  changed = false;
 
-  SDL_Quit();
+  ++nFramesPublished;
+  nRedraws = renderRedraws.load(std::memory_order_relaxed);
+  nRowsUploaded = renderRowsUploaded.load(std::memory_order_relaxed);
+  redrawNanoseconds = renderNanoseconds.load(std::memory_order_relaxed);
 }
 
 void
-Framebuffer::processEvents(const bool redraw)
+Framebuffer::sendEvent(FramebufferEvent event)
 {
-  if (not active_window)
-    return;
+  /* Keys may be dropped when the queue is full, quitting may not */
+  while (! events.tryPush(event))
+    {
+      if (event != FramebufferEvent::Quit)
+        return;
+      SDL_Delay(RenderIdleDelay);
+    }
+}
 
-  SDL_Event event;
-  while (SDL_PollEvent(&event))
+/* The render thread owns all SDL state. It presents the frames published
+ * by the simulation thread and forwards key events, until the simulation
+ * is over and the window is closed.
+ */
+void
+Framebuffer::renderLoop(std::promise<void> initialized)
+{
+  if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
-      switch(event.type)
-        {
-          case SDL_KEYUP:
-              switch (event.key.keysym.sym)
-                {
-                  case SDLK_ESCAPE:
-                  case SDLK_q:
-                    if (active_window)
-                      {
-                        context.reset(nullptr);
-
-                        control.enable = 0;
-                        active_window = false;
-                      }
-                    break;
-
-                  case SDLK_UP:
-                    if (update_freq > 10)
-                      update_freq /= 10;
-                    break;
-
-                  case SDLK_DOWN:
-                    if (update_freq < 10000000)
-                      update_freq *= 10;
-                    break;
-                }
-              break;
-
-          default:
-              break;
-        }
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                   "Couldn't init SDL: %s", SDL_GetError());
+      SDL_Quit();
+      initialized.set_exception(std::make_exception_ptr(
+          std::runtime_error("Error initialising SDL")));
+      return;
     }
+  initialized.set_value();
 
-  /* Bail out if the window was just destroyed (due to quit command) */
-  if (not active_window)
-    return;
+  std::unique_ptr<RenderContext> context;
+  /* Generation of the window closed by the user, frames of this
+   * generation may still arrive before the simulation has seen the
+   * quit event.
+   */
+  uint64_t closedGeneration = 0;
+  bool finished = false;
 
-  /* Check if we need to update */
-  if (!finished)
+  while (! finished || context)
     {
+      SDL_Event event;
+      while (SDL_PollEvent(&event))
+        {
+          if (event.type == SDL_WINDOWEVENT && context)
+            context->present();
+          if (event.type != SDL_KEYUP)
+            continue;
+
+          switch (event.key.keysym.sym)
+            {
+              case SDLK_ESCAPE:
+              case SDLK_q:
+                if (context)
+                  {
+                    closedGeneration = context->generation;
+                    context.reset(nullptr);
+                    if (! finished)
+                      sendEvent(FramebufferEvent::Quit);
+                  }
+                break;
+
+              case SDLK_UP:
+                sendEvent(FramebufferEvent::FasterUpdates);
+                break;
+
+              case SDLK_DOWN:
+                sendEvent(FramebufferEvent::SlowerUpdates);
+                break;
+            }
+        }
+
+      if (! frames.consume())
+        {
+          SDL_Delay(RenderIdleDelay);
+          continue;
+        }
+
+      const FrameSnapshot &frame = frames.front();
+      finished = frame.finished;
+
+      if (! frame.enabled || frame.generation == closedGeneration)
+        {
+          context.reset(nullptr);
+          continue;
+        }
+
+      if (! context || context->generation != frame.generation)
+        {
+          try
+            {
+              context.reset(nullptr);
+              context = std::make_unique<RenderContext>(frame);
+            }
+          catch (std::exception &)
+            {
+              /* Already logged, act as if the user closed the window */
+              closedGeneration = frame.generation;
+              if (! finished)
+                sendEvent(FramebufferEvent::Quit);
+              continue;
+            }
+        }
+
       char tmp[256];
-      snprintf(tmp, 256, "rv64-emu - %" PRIu64 " bus cycles/update", update_freq);
+      if (finished)
+        snprintf(tmp, 256, "Simulation over, press q/ESC to quit");
+      else
+        snprintf(tmp, 256, "rv64-emu - %" PRIu64 " bus cycles/update",
+                 frame.updateFreq);
       SDL_SetWindowTitle(context->window, tmp);
+
+      const auto start = std::chrono::steady_clock::now();
+      renderRowsUploaded += context->redrawScreen(frame);
+      renderNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      ++renderRedraws;
     }
 
-  if (context->changed || redraw)
-    context->redrawScreen();
+  SDL_Quit();
+}
+
+void
+Framebuffer::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("framebuffer.frames_published",
+                      "Frames published to the render thread",
+                      &nFramesPublished);
+  registry.addCounter("framebuffer.redraws", "Screen redraws", &nRedraws);
+  registry.addCounter("framebuffer.rows_uploaded",
+                      "Changed rows converted and uploaded to the texture",
+                      &nRowsUploaded);
+  registry.addCounter("framebuffer.redraw_ns",
+                      "Host time spent converting, uploading and rendering",
+                      &redrawNanoseconds);
 }
 
 /* Because the control/palette/framebuffer sections are stored differently
@@ -312,7 +558,8 @@ Framebuffer::getZone(const MemAddress addr, const uint8_t size,
   FBzone r = FBzone::INVALID;
 
   if (addr >= control_base &&
-      addr + size <= control_base + sizeof(ControlInterface) + sizeof(palette))
+      addr + size <= control_base + sizeof(ControlInterface) +
+      palette.size() * sizeof(uint32_t))
     {
       if ((size > 0 && size != 4) || (size == 4 && addr % size != 0))
         throw IllegalAccess("Control/palette only support aligned 4 byte access");
@@ -337,7 +584,7 @@ Framebuffer::getZone(const MemAddress addr, const uint8_t size,
     throw IllegalAccess("Framebuffer device only accessible with an active window");
   /* From here onwards, an active window is guaranteed. */
   else if (addr >= framebuffer_base &&
-           addr + size <= framebuffer_base + context->memsize)
+           addr + size <= framebuffer_base + mem.size())
     {
       if (offset)
         *offset = addr - framebuffer_base;
@@ -361,7 +608,7 @@ Framebuffer::readByte(MemAddress addr)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal access on framebuffer");
 
-  return context->mem[offset];
+  return mem[offset];
 }
 
 uint16_t
@@ -372,7 +619,7 @@ Framebuffer::readHalfWord(MemAddress addr)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal halfword access on framebuffer");
 
-  return *(uint16_t*)&context->mem[offset];
+  return *(uint16_t*)&mem[offset];
 }
 
 uint32_t
@@ -390,7 +637,7 @@ Framebuffer::readWord(MemAddress addr)
           return palette[offset/sizeof(uint32_t)];
 
       case FBzone::BUFFER:
-          return *(uint32_t*)&context->mem[offset];
+          return *(uint32_t*)&mem[offset];
 
       default:
           throw IllegalAccess("Invalid word access on framebuffer");
@@ -405,7 +652,7 @@ Framebuffer::readDoubleWord(MemAddress addr)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal doubleword access on framebuffer");
 
-  return *(uint64_t *)&context->mem[offset];
+  return *(uint64_t *)&mem[offset];
 }
 
 void
@@ -416,8 +663,8 @@ Framebuffer::writeByte(MemAddress addr, uint8_t value)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal access on framebuffer");
 
-  context->mem[offset] = value;
-  context->changed = true;
+  mem[offset] = value;
+  markDirty(offset, sizeof(uint8_t));
 }
 
 void
@@ -428,8 +675,8 @@ Framebuffer::writeHalfWord(MemAddress addr, uint16_t value)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal access on framebuffer");
 
-  *(uint16_t*)&context->mem[offset] = value;
-  context->changed = true;
+  *(uint16_t*)&mem[offset] = value;
+  markDirty(offset, sizeof(uint16_t));
 }
 
 void
@@ -445,19 +692,9 @@ Framebuffer::writeWord(MemAddress addr, uint32_t value)
           {
             /* Turn the device on or off at address 0 */
             if (active_window && value == 0)
-              {
-                context.reset(nullptr);
-
-                active_window = false;
-                control.enable = 0;
-              }
+              disable();
             else if (not active_window && value > 0)
-              {
-                context.reset(new RenderContext(control.resx, control.resy,
-                                                control.mode));
-                active_window = true;
-                control.enable = 1;
-              }
+              enable();
           }
         else
           {
@@ -468,13 +705,13 @@ Framebuffer::writeWord(MemAddress addr, uint32_t value)
 
       case FBzone::PALETTE:
         palette[offset/sizeof(uint32_t)] = value;
-        if (active_window)
-          context->changed = true;
+        if (active_window && control.mode == FBMODE_INDEXED)
+          markAllDirty();
         break;
 
       case FBzone::BUFFER:
-        *(uint32_t*)&context->mem[offset] = value;
-        context->changed = true;
+        *(uint32_t*)&mem[offset] = value;
+        markDirty(offset, sizeof(uint32_t));
         break;
 
       default:
@@ -490,8 +727,8 @@ Framebuffer::writeDoubleWord(MemAddress addr, uint64_t value)
   if (zone == FBzone::INVALID)
     throw IllegalAccess("Illegal access on framebuffer");
 
-  *(uint64_t*)&context->mem[offset] = value;
-  context->changed = true;
+  *(uint64_t*)&mem[offset] = value;
+  markDirty(offset, sizeof(uint64_t));
 }
 
 void
@@ -499,10 +736,28 @@ Framebuffer::clockPulse()
 {
   if (cycles_since_update > update_freq)
     {
-      processEvents(true);
+      handleEvents();
+      if (changed)
+        publishFrame(false);
       cycles_since_update = 0;
     }
   ++cycles_since_update;
 }
 
+/* Events of the render thread are handled when a frame is published */
+uint64_t
+Framebuffer::getIdleCycles() const
+{
+  if (cycles_since_update > update_freq)
+    return 0;
+
+  return update_freq - cycles_since_update + 1;
+}
+
+void
+Framebuffer::skipCycles(uint64_t cycles)
+{
+  cycles_since_update += cycles;
+}
+
 #endif
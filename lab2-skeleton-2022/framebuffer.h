@@ -12,10 +12,14 @@
 #define __FRAMEBUFFER_H__
 
 #include "memory-interface.h"
+#include "ring-buffer.h"
+#include "triple-buffer.h"
 
-#include <memory>
-
-class RenderContext;
+#include <array>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
 
 struct ControlInterface
 {
@@ -25,6 +29,16 @@ struct ControlInterface
   uint32_t resy;
 };
 
+enum FBmode
+{
+  FBMODE_Y8 = 0,
+  FBMODE_INDEXED,
+  FBMODE_RGB332,
+  FBMODE_RGB555,
+  FBMODE_RGB24,
+  FBMODE_RGBA32
+};
+
 enum class FBzone
 {
   INVALID = 0,
@@ -33,6 +47,36 @@ enum class FBzone
   BUFFER
 };
 
+/* Copy of the framebuffer state, passed from the simulation thread to
+ * the render thread. For every row, the number of the frame in which it
+ * last changed is kept, so that only changed rows have to be copied
+ * and uploaded.
+ */
+struct FrameSnapshot
+{
+  bool enabled = false;
+  bool finished = false;
+
+  /* Incremented every time the framebuffer is enabled */
+  uint64_t generation{};
+  uint32_t mode{};
+  uint32_t resx{};
+  uint32_t resy{};
+  uint64_t updateFreq{};
+
+  std::vector<uint8_t> mem{};
+  std::vector<uint32_t> rowVersions{};
+  std::array<uint32_t, 256> palette{};
+};
+
+/* Input events, passed from the render thread to the simulation thread */
+enum class FramebufferEvent
+{
+  Quit,
+  FasterUpdates,
+  SlowerUpdates
+};
+
 
 class Framebuffer : public MemoryInterface
 {
@@ -55,26 +99,64 @@ class Framebuffer : public MemoryInterface
     bool contains(MemAddress addr) const override;
 
     void clockPulse() override;
+    uint64_t getIdleCycles() const override;
+    void skipCycles(uint64_t cycles) override;
 
-    void processEvents(const bool redraw);
-
+    void registerStatistics(StatisticsRegistry &registry) override;
 
+    Framebuffer(const Framebuffer &) = delete;
+    Framebuffer &operator=(const Framebuffer &) = delete;
 
   private:
     FBzone getZone(const MemAddress addr, const uint8_t size,
                    uint32_t *offset) const;
 
+    void enable();
+    void disable();
+    void markDirty(uint32_t offset, uint32_t size);
+    void markAllDirty();
+
+    void handleEvents();
+    void publishFrame(bool finished);
+
+    /* Runs on the render thread */
+    void renderLoop(std::promise<void> initialized);
+    void sendEvent(FramebufferEvent event);
+
     const MemAddress control_base;
     const MemAddress framebuffer_base;
 
     bool  active_window = false;
-    bool  finished = false;
+    bool  changed = false;
 
     uint64_t update_freq = 1000000;
     uint64_t cycles_since_update{};
 
     ControlInterface control{};
-    std::unique_ptr<RenderContext> context;
+    std::array<uint32_t, 256> palette{};
+
+    /* Framebuffer contents as seen by the guest */
+    std::vector<uint8_t> mem{};
+    uint32_t pitch{};
+    std::vector<uint32_t> rowVersions{};
+    uint32_t currentFrame = 1;
+    uint64_t generation{};
+
+    TripleBuffer<FrameSnapshot> frames{};
+    RingBuffer<FramebufferEvent, 64> events{};
+    std::thread renderThread{};
+
+    /* Statistics, the render thread counts in atomics which are copied
+     * on every published frame.
+     */
+    uint64_t nFramesPublished{};
+    uint64_t nRedraws{};
+    uint64_t nRowsUploaded{};
+    uint64_t redrawNanoseconds{};
+
+    std::atomic<uint64_t> renderRedraws{};
+    std::atomic<uint64_t> renderRowsUploaded{};
+    std::atomic<uint64_t> renderNanoseconds{};
 };
 
 #endif /* __FRAMEBUFFER_H__ */
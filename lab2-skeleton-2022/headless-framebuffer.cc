@@ -0,0 +1,474 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    headless-framebuffer.cc - Framebuffer that writes frames to a file.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "headless-framebuffer.h"
+#include "statistics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+/* bytes per pixel */
+static const
+uint32_t mem_mult[] =
+{
+  1, //Y8
+  1, //INDEXED
+  1, //RGB332
+  2, //RGB555
+  3, //RGB24
+  4  //RGBA32
+};
+
+/* Frame rate announced in the Y4M header, frames are captured per
+ * simulated cycle interval so this only affects playback speed.
+ */
+static constexpr int Y4MFrameRate = 25;
+
+
+HeadlessFramebuffer::HeadlessFramebuffer(const MemAddress control_base,
+                                         const MemAddress framebuffer_base,
+                                         const HeadlessFramebufferConfig &config)
+  : control_base{ control_base }, framebuffer_base{ framebuffer_base },
+    interval{ std::max<uint64_t>(1, config.interval) }
+{
+  const std::string &filename = config.output;
+
+  y4m = filename.size() >= 4 &&
+      filename.compare(filename.size() - 4, 4, ".y4m") == 0;
+
+  if (filename == "-")
+    {
+      output = &std::cout;
+      return;
+    }
+
+  outputFile.open(filename, std::ios::binary);
+  if (!outputFile.good())
+    throw std::runtime_error("cannot open file " + filename);
+}
+
+HeadlessFramebuffer::~HeadlessFramebuffer()
+{
+  if (control.enable)
+    captureFrame();
+  output->flush();
+}
+
+/* Same zone layout and access restrictions as Framebuffer::getZone. */
+FBzone
+HeadlessFramebuffer::getZone(const MemAddress addr, const uint8_t size,
+                             uint32_t *offset) const
+{
+  if (addr >= control_base &&
+      addr + size <= control_base + sizeof(ControlInterface) +
+      palette.size() * sizeof(uint32_t))
+    {
+      if ((size > 0 && size != 4) || (size == 4 && addr % size != 0))
+        throw IllegalAccess("Control/palette only support aligned 4 byte access");
+
+      MemAddress pos = addr - control_base;
+      if (pos < sizeof(ControlInterface))
+        {
+          if (offset)
+            *offset = pos;
+          return FBzone::CONTROL;
+        }
+
+      if (offset)
+        *offset = pos - sizeof(ControlInterface);
+      return FBzone::PALETTE;
+    }
+  else if (! control.enable && size == 0)
+    return FBzone::INVALID;
+  else if (! control.enable && size > 0)
+    throw IllegalAccess("Framebuffer device only accessible when enabled");
+  else if (addr >= framebuffer_base &&
+           addr + size <= framebuffer_base + mem.size())
+    {
+      if (offset)
+        *offset = addr - framebuffer_base;
+      return FBzone::BUFFER;
+    }
+
+  return FBzone::INVALID;
+}
+
+bool
+HeadlessFramebuffer::contains(MemAddress addr) const
+{
+  return getZone(addr, 0, nullptr) != FBzone::INVALID;
+}
+
+template <typename T>
+T
+HeadlessFramebuffer::readBuffer(MemAddress addr)
+{
+  uint32_t offset = 0;
+  if (getZone(addr, sizeof(T), &offset) != FBzone::BUFFER)
+    throw IllegalAccess("Illegal access on framebuffer");
+
+  T value;
+  std::memcpy(&value, &mem[offset], sizeof(T));
+  return value;
+}
+
+template <typename T>
+void
+HeadlessFramebuffer::writeBuffer(MemAddress addr, T value)
+{
+  uint32_t offset = 0;
+  if (getZone(addr, sizeof(T), &offset) != FBzone::BUFFER)
+    throw IllegalAccess("Illegal access on framebuffer");
+
+  std::memcpy(&mem[offset], &value, sizeof(T));
+  changed = true;
+}
+
+/*
+ * MemoryInterface
+ */
+
+uint8_t
+HeadlessFramebuffer::readByte(MemAddress addr)
+{
+  return readBuffer<uint8_t>(addr);
+}
+
+uint16_t
+HeadlessFramebuffer::readHalfWord(MemAddress addr)
+{
+  return readBuffer<uint16_t>(addr);
+}
+
+uint32_t
+HeadlessFramebuffer::readWord(MemAddress addr)
+{
+  uint32_t offset = 0;
+
+  switch (getZone(addr, sizeof(uint32_t), &offset))
+    {
+      case FBzone::CONTROL:
+        return ((uint32_t*)&control)[offset/sizeof(uint32_t)];
+
+      case FBzone::PALETTE:
+        return palette[offset/sizeof(uint32_t)];
+
+      case FBzone::BUFFER:
+        return readBuffer<uint32_t>(addr);
+
+      default:
+        throw IllegalAccess("Invalid word access on framebuffer");
+    }
+}
+
+uint64_t
+HeadlessFramebuffer::readDoubleWord(MemAddress addr)
+{
+  return readBuffer<uint64_t>(addr);
+}
+
+void
+HeadlessFramebuffer::writeByte(MemAddress addr, uint8_t value)
+{
+  writeBuffer(addr, value);
+}
+
+void
+HeadlessFramebuffer::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  writeBuffer(addr, value);
+}
+
+void
+HeadlessFramebuffer::writeWord(MemAddress addr, uint32_t value)
+{
+  uint32_t offset = 0;
+
+  switch (getZone(addr, sizeof(uint32_t), &offset))
+    {
+      case FBzone::CONTROL:
+        if (offset == 0)
+          {
+            if (control.enable && value == 0)
+              disable();
+            else if (! control.enable && value > 0)
+              enable();
+          }
+        else
+          {
+            /* Takes effect when the framebuffer is next enabled */
+            ((uint32_t*)&control)[offset/sizeof(uint32_t)] = value;
+          }
+        break;
+
+      case FBzone::PALETTE:
+        palette[offset/sizeof(uint32_t)] = value;
+        changed = true;
+        break;
+
+      case FBzone::BUFFER:
+        writeBuffer(addr, value);
+        break;
+
+      default:
+        throw IllegalAccess("Invalid Word access on framebuffer");
+    }
+}
+
+void
+HeadlessFramebuffer::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  writeBuffer(addr, value);
+}
+
+void
+HeadlessFramebuffer::clockPulse()
+{
+  if (++cycles_since_update < interval)
+    return;
+
+  cycles_since_update = 0;
+  if (control.enable)
+    captureFrame();
+}
+
+/* A frame is captured in the cycle the interval elapses */
+uint64_t
+HeadlessFramebuffer::getIdleCycles() const
+{
+  if (cycles_since_update + 1 >= interval)
+    return 0;
+
+  return interval - 1 - cycles_since_update;
+}
+
+void
+HeadlessFramebuffer::skipCycles(uint64_t cycles)
+{
+  cycles_since_update += cycles;
+}
+
+void
+HeadlessFramebuffer::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("video.frames_written", "Frames written to the output",
+                      &nFramesWritten);
+  registry.addCounter("video.frames_skipped",
+                      "Captured frames skipped because they did not change",
+                      &nFramesSkipped);
+}
+
+/*
+ * Private methods
+ */
+
+void
+HeadlessFramebuffer::enable()
+{
+  if (control.mode > FBMODE_RGBA32)
+    throw IllegalAccess("Invalid framebuffer mode " +
+                        std::to_string(control.mode));
+  if (control.resx == 0 || control.resy == 0)
+    throw IllegalAccess("Invalid framebuffer resolution");
+
+  /* A Y4M stream has a single resolution, announced in its header */
+  if (y4m && y4mHeaderWritten)
+    {
+      const size_t pixels = rgb.size() / 3;
+      if (pixels != size_t{ control.resx } * control.resy)
+        throw IllegalAccess("Framebuffer resolution cannot change in a Y4M stream");
+    }
+
+  const size_t nPixels = size_t{ control.resx } * control.resy;
+  mem.assign(nPixels * mem_mult[control.mode], 0);
+  rgb.resize(nPixels * 3);
+  if (y4m)
+    yuv.resize(nPixels * 3);
+
+  control.enable = 1;
+  active = control;
+  changed = true;
+  haveLastFrame = false;
+  cycles_since_update = 0;
+}
+
+void
+HeadlessFramebuffer::disable()
+{
+  captureFrame();
+
+  control.enable = 0;
+  mem.clear();
+}
+
+void
+HeadlessFramebuffer::captureFrame()
+{
+  /* Writes that do not change the contents, e.g. redrawing the same
+   * image, are caught by comparing content hashes.
+   */
+  if (changed)
+    {
+      const uint64_t hash = hashFrame();
+      changed = false;
+
+      if (! haveLastFrame || hash != lastHash)
+        {
+          lastHash = hash;
+          haveLastFrame = true;
+
+          convertToRGB();
+          if (y4m)
+            writeY4M();
+          else
+            writePPM();
+
+          ++nFramesWritten;
+          return;
+        }
+    }
+
+  ++nFramesSkipped;
+}
+
+/* 64-bit multiplicative hash over the framebuffer contents, processing
+ * a word per step. The palette is included in the indexed mode.
+ */
+uint64_t
+HeadlessFramebuffer::hashFrame() const
+{
+  constexpr uint64_t Multiplier = 0x9e3779b97f4a7c15ull;
+  uint64_t hash = mem.size();
+
+  auto mix = [&hash](uint64_t word)
+    {
+      hash = (hash ^ word) * Multiplier;
+      hash ^= hash >> 29;
+    };
+
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= mem.size(); i += sizeof(uint64_t))
+    {
+      uint64_t word;
+      std::memcpy(&word, &mem[i], sizeof(word));
+      mix(word);
+    }
+  for (; i < mem.size(); ++i)
+    mix(mem[i]);
+
+  if (active.mode == FBMODE_INDEXED)
+    for (uint32_t entry : palette)
+      mix(entry);
+
+  return hash;
+}
+
+void
+HeadlessFramebuffer::convertToRGB()
+{
+  const size_t nPixels = rgb.size() / 3;
+  uint8_t *out = rgb.data();
+
+  /* 5 and 3-bit channels are scaled to the full 8-bit range */
+  auto expand5 = [](uint32_t v) -> uint8_t { return (v << 3) | (v >> 2); };
+  auto expand3 = [](uint32_t v) -> uint8_t { return (v << 5) | (v << 2) | (v >> 1); };
+
+  switch (active.mode)
+    {
+      case FBMODE_Y8:
+        for (size_t i = 0; i < nPixels; ++i, out += 3)
+          out[0] = out[1] = out[2] = mem[i];
+        break;
+
+      case FBMODE_INDEXED:
+        for (size_t i = 0; i < nPixels; ++i, out += 3)
+          {
+            const uint32_t p = palette[mem[i]];
+            out[0] = p >> 24;
+            out[1] = p >> 16;
+            out[2] = p >> 8;
+          }
+        break;
+
+      case FBMODE_RGB332:
+        for (size_t i = 0; i < nPixels; ++i, out += 3)
+          {
+            const uint8_t p = mem[i];
+            out[0] = expand3(p >> 5);
+            out[1] = expand3((p >> 2) & 0x7);
+            out[2] = (p & 0x3) * 0x55;
+          }
+        break;
+
+      case FBMODE_RGB555:
+        for (size_t i = 0; i < nPixels; ++i, out += 3)
+          {
+            uint16_t p;
+            std::memcpy(&p, &mem[i * 2], sizeof(p));
+            out[0] = expand5((p >> 10) & 0x1f);
+            out[1] = expand5((p >> 5) & 0x1f);
+            out[2] = expand5(p & 0x1f);
+          }
+        break;
+
+      case FBMODE_RGB24:
+        std::memcpy(out, mem.data(), rgb.size());
+        break;
+
+      case FBMODE_RGBA32:
+        for (size_t i = 0; i < nPixels; ++i, out += 3)
+          {
+            uint32_t p;
+            std::memcpy(&p, &mem[i * 4], sizeof(p));
+            out[0] = p >> 24;
+            out[1] = p >> 16;
+            out[2] = p >> 8;
+          }
+        break;
+    }
+}
+
+void
+HeadlessFramebuffer::writePPM()
+{
+  *output << "P6\n" << active.resx << " " << active.resy << "\n255\n";
+  output->write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+}
+
+/* Frames are converted to YUV 4:4:4 using BT.601 limited range. */
+void
+HeadlessFramebuffer::writeY4M()
+{
+  const size_t nPixels = rgb.size() / 3;
+
+  if (! y4mHeaderWritten)
+    {
+      *output << "YUV4MPEG2 W" << active.resx << " H" << active.resy
+              << " F" << Y4MFrameRate << ":1 Ip A1:1 C444\n";
+      y4mHeaderWritten = true;
+    }
+
+  uint8_t *y = yuv.data();
+  uint8_t *u = y + nPixels;
+  uint8_t *v = u + nPixels;
+
+  for (size_t i = 0; i < nPixels; ++i)
+    {
+      const int r = rgb[i * 3 + 0];
+      const int g = rgb[i * 3 + 1];
+      const int b = rgb[i * 3 + 2];
+
+      y[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+      u[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+      v[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+
+  *output << "FRAME\n";
+  output->write(reinterpret_cast<const char *>(yuv.data()), yuv.size());
+}
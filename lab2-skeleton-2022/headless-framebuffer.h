@@ -0,0 +1,112 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    headless-framebuffer.h - Framebuffer that writes frames to a file.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __HEADLESS_FRAMEBUFFER_H__
+#define __HEADLESS_FRAMEBUFFER_H__
+
+#include "framebuffer.h"
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct HeadlessFramebufferConfig
+{
+  /* Frames are written as a YUV4MPEG2 stream when the filename ends
+   * with .y4m and as a sequence of binary PPM images otherwise. "-"
+   * writes to standard output.
+   */
+  std::string output{};
+
+  /* Bus cycles between captured frames */
+  uint64_t interval = 1000000;
+};
+
+/* The headless framebuffer has the same control, palette and buffer
+ * layout as the SDL framebuffer (see framebuffer.cc), but needs no
+ * display. Every interval bus cycles, the contents of the enabled
+ * framebuffer are written to the output as a frame. Frames of which the
+ * contents did not change since the previous frame are skipped, so
+ * frames are not written at a constant rate.
+ */
+class HeadlessFramebuffer : public MemoryInterface
+{
+  public:
+    HeadlessFramebuffer(const MemAddress control_base,
+                        const MemAddress framebuffer_base,
+                        const HeadlessFramebufferConfig &config);
+    ~HeadlessFramebuffer() override;
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override;
+
+    void clockPulse() override;
+    uint64_t getIdleCycles() const override;
+    void skipCycles(uint64_t cycles) override;
+
+    void registerStatistics(StatisticsRegistry &registry) override;
+
+    HeadlessFramebuffer(const HeadlessFramebuffer &) = delete;
+    HeadlessFramebuffer &operator=(const HeadlessFramebuffer &) = delete;
+
+  private:
+    const MemAddress control_base;
+    const MemAddress framebuffer_base;
+    const uint64_t interval;
+
+    std::ofstream outputFile{};
+    std::ostream *output = &outputFile;
+    bool y4m = false;
+    bool y4mHeaderWritten = false;
+
+    ControlInterface control{};
+    ControlInterface active{};  /* settings at the time of enabling */
+    std::array<uint32_t, 256> palette{};
+    std::vector<uint8_t> mem{};
+
+    bool changed = false;
+    uint64_t lastHash{};
+    bool haveLastFrame = false;
+    uint64_t cycles_since_update{};
+
+    /* Frame in RGB24 and, for Y4M, in planar YUV 4:4:4 */
+    std::vector<uint8_t> rgb{};
+    std::vector<uint8_t> yuv{};
+
+    /* Statistics */
+    uint64_t nFramesWritten{};
+    uint64_t nFramesSkipped{};
+
+    FBzone getZone(const MemAddress addr, const uint8_t size,
+                   uint32_t *offset) const;
+    template <typename T>
+    T readBuffer(MemAddress addr);
+    template <typename T>
+    void writeBuffer(MemAddress addr, T value);
+
+    void enable();
+    void disable();
+
+    void captureFrame();
+    uint64_t hashFrame() const;
+    void convertToRGB();
+    void writePPM();
+    void writeY4M();
+};
+
+#endif /* __HEADLESS_FRAMEBUFFER_H__ */
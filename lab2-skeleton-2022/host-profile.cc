@@ -0,0 +1,86 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-profile.cc - Host-side profiling of the simulator itself.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "host-profile.h"
+
+#ifdef ENABLE_HOST_PROFILE
+
+#include <iomanip>
+
+HostProfile hostProfile;
+
+static const char *componentNames[] =
+{
+  "IF propagate",
+  "IF clockPulse",
+  "ID propagate",
+  "ID clockPulse",
+  "EX propagate",
+  "EX clockPulse",
+  "MEM propagate",
+  "MEM clockPulse",
+  "WB propagate",
+  "WB clockPulse",
+  "bus routing",
+  "device clockPulse"
+};
+
+static_assert(std::size(componentNames) ==
+              static_cast<size_t>(HostComponent::LAST),
+              "component name missing");
+
+void
+HostProfile::start()
+{
+  startTime = std::chrono::steady_clock::now();
+  startTimestamp = readTimestamp();
+}
+
+void
+HostProfile::stop()
+{
+  elapsedTicks += readTimestamp() - startTimestamp;
+  elapsedTime += std::chrono::steady_clock::now() - startTime;
+}
+
+void
+HostProfile::dump(std::ostream &os, uint64_t nCycles,
+                  uint64_t nInstructions) const
+{
+  auto storeFlags(os.flags());
+  const double elapsedNs = elapsedTime.count();
+
+  if (elapsedNs == 0.0 || elapsedTicks == 0)
+    return;
+
+  const double nsPerTick = elapsedNs / elapsedTicks;
+
+  os << std::fixed << std::setprecision(2)
+     << "Host time " << elapsedNs / 1e6 << " ms, ";
+  if (nCycles)
+    os << elapsedNs / nCycles << " ns per simulated cycle, ";
+  os << nInstructions / (elapsedNs / 1e3) << " simulated MIPS." << std::endl;
+
+  os << "Host time per component (inclusive):" << std::endl;
+  for (size_t i = 0; i < NumComponents; ++i)
+    {
+      if (calls[i] == 0)
+        continue;
+
+      const double ns = ticks[i] * nsPerTick;
+      os << "  " << std::left << std::setw(18) << componentNames[i]
+         << std::right << std::setw(12) << std::setprecision(2)
+         << ns / 1e6 << " ms " << std::setw(6)
+         << 100.0 * ns / elapsedNs << "% " << std::setw(12) << calls[i]
+         << " calls " << std::setw(8) << ns / calls[i] << " ns/call"
+         << std::endl;
+    }
+
+  os.flags(storeFlags);
+}
+
+#endif /* ENABLE_HOST_PROFILE */
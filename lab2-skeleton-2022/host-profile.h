@@ -0,0 +1,138 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-profile.h - Host-side profiling of the simulator itself.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __HOST_PROFILE_H__
+#define __HOST_PROFILE_H__
+
+/* The host profile measures the host time spent in the components of
+ * the simulator, to find out where the simulator spends its time. It
+ * is only compiled in when ENABLE_HOST_PROFILE is defined (make
+ * ENABLE_HOST_PROFILE=1), otherwise HOST_PROFILE_SCOPE expands to
+ * nothing.
+ *
+ * Time is measured using the time-stamp counter where available,
+ * which is calibrated against the wall clock over the entire run.
+ * Scopes may be nested, e.g. bus routing is also accounted to the
+ * stage that accessed the bus, so the reported times are inclusive.
+ *
+ * The accounting is not synchronized: scopes may only be used on the
+ * simulation thread. Code that also runs on other threads, such as the
+ * instruction decoder and formatter used by the parallel disassembler,
+ * must not be instrumented.
+ */
+
+/* The stage components are ordered by stage, such that the components
+ * of stage i are at 2 * i (propagate) and 2 * i + 1 (clockPulse).
+ */
+enum class HostComponent
+{
+  FetchPropagate,
+  FetchClockPulse,
+  DecodePropagate,
+  DecodeClockPulse,
+  ExecutePropagate,
+  ExecuteClockPulse,
+  MemoryPropagate,
+  MemoryClockPulse,
+  WriteBackPropagate,
+  WriteBackClockPulse,
+  BusRouting,
+  DeviceClockPulse,
+  LAST
+};
+
+#ifdef ENABLE_HOST_PROFILE
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+class HostProfile
+{
+  public:
+    static uint64_t readTimestamp()
+    {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    void add(HostComponent component, uint64_t ticks)
+    {
+      const size_t index = static_cast<size_t>(component);
+      this->ticks[index] += ticks;
+      ++calls[index];
+    }
+
+    /* Start and stop of the measured run, used for calibration of
+     * the time-stamp counter and the totals.
+     */
+    void start();
+    void stop();
+
+    void dump(std::ostream &os, uint64_t nCycles,
+              uint64_t nInstructions) const;
+
+  private:
+    static constexpr size_t NumComponents =
+        static_cast<size_t>(HostComponent::LAST);
+
+    std::array<uint64_t, NumComponents> ticks{};
+    std::array<uint64_t, NumComponents> calls{};
+
+    std::chrono::steady_clock::time_point startTime{};
+    uint64_t startTimestamp{};
+
+    std::chrono::nanoseconds elapsedTime{};
+    uint64_t elapsedTicks{};
+};
+
+extern HostProfile hostProfile;
+
+/* Accounts the host time until the end of the enclosing scope to
+ * a component.
+ */
+class HostProfileScope
+{
+  public:
+    explicit HostProfileScope(HostComponent component)
+      : component{ component }, start{ HostProfile::readTimestamp() }
+    { }
+
+    ~HostProfileScope()
+    {
+      hostProfile.add(component, HostProfile::readTimestamp() - start);
+    }
+
+    HostProfileScope(const HostProfileScope &) = delete;
+    HostProfileScope &operator=(const HostProfileScope &) = delete;
+
+  private:
+    const HostComponent component;
+    const uint64_t start;
+};
+
+#define HOST_PROFILE_SCOPE(component) \
+  HostProfileScope hostProfileScope{ component }
+
+#else /* ENABLE_HOST_PROFILE */
+
+#define HOST_PROFILE_SCOPE(component) do { } while (0)
+
+#endif /* ENABLE_HOST_PROFILE */
+
+#endif /* __HOST_PROFILE_H__ */
@@ -0,0 +1,155 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    idle-loop.cc - Detection of idle loops that can be fast-forwarded.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "idle-loop.h"
+
+#include <algorithm>
+
+/* Major opcodes */
+static constexpr uint32_t JumpOpcode = 0x00;
+static constexpr uint32_t BranchNoFlagOpcode = 0x03;
+static constexpr uint32_t BranchFlagOpcode = 0x04;
+static constexpr uint32_t NopOpcode = 0x05;
+static constexpr uint32_t SysOpcode = 0x08;
+static constexpr uint32_t ReturnFromExceptionOpcode = 0x09;
+static constexpr uint32_t MoveToSPROpcode = 0x30;
+
+static bool
+isBackwardBranch(uint32_t instructionWord)
+{
+  const uint32_t major = instructionWord >> 26;
+  if (major != JumpOpcode && major != BranchNoFlagOpcode &&
+      major != BranchFlagOpcode)
+    return false;
+
+  /* The 26-bit offset is negative */
+  return instructionWord & (1u << 25);
+}
+
+static bool
+isIdleHint(uint32_t instructionWord)
+{
+  return (instructionWord >> 26) == NopOpcode &&
+      (instructionWord & 0xffff) == IdleLoopDetector::IdleHint;
+}
+
+static bool
+sameExecution(const RetiredInstruction &a, const RetiredInstruction &b)
+{
+  return a.PC == b.PC && a.instructionWord == b.instructionWord &&
+      a.writesRegister == b.writesRegister && a.rd == b.rd &&
+      a.value == b.value && a.accessesMemory == b.accessesMemory &&
+      a.memAddress == b.memAddress && a.memData == b.memData;
+}
+
+IdleLoopDetector::Event
+IdleLoopDetector::retire(const RetiredInstruction &retired, uint64_t nCycles)
+{
+  if (hasSideEffects(retired))
+    {
+      reset();
+      return Event::None;
+    }
+
+  /* Iterations start after the delay slot of the loop branch; another
+   * backward branch than the loop branch starts a new loop.
+   */
+  if (retired.PC != branchPC && ! inDelaySlot &&
+      isBackwardBranch(retired.instructionWord))
+    {
+      reset();
+      branchPC = retired.PC;
+      inDelaySlot = true;
+      firstIteration = true;
+      return Event::None;
+    }
+
+  if (branchPC == 0)
+    return Event::None;
+
+  if (current.empty())
+    hinted = isIdleHint(retired.instructionWord);
+
+  current.push_back(retired);
+
+  if (inDelaySlot)
+    {
+      inDelaySlot = false;
+      return endIteration(nCycles);
+    }
+
+  if (retired.PC == branchPC)
+    inDelaySlot = true;
+  else if (current.size() >= (hinted ? MaxHintedLoopLength : MaxLoopLength))
+    reset();
+
+  return Event::None;
+}
+
+void
+IdleLoopDetector::reset()
+{
+  branchPC = 0;
+  inDelaySlot = false;
+  hinted = false;
+  previous.clear();
+  current.clear();
+}
+
+/*
+ * Private methods
+ */
+
+/* Instructions that change state other than the registers written, as
+ * recorded in the retired instruction. The loads of a skipped iteration
+ * are not performed, so loads with side effects count as well.
+ */
+bool
+IdleLoopDetector::hasSideEffects(const RetiredInstruction &retired) const
+{
+  const uint32_t major = retired.instructionWord >> 26;
+
+  if (retired.accessesMemory && ! retired.memoryWrite &&
+      memory.hasReadSideEffects(retired.memAddress))
+    return true;
+
+  return retired.memoryWrite || major == SysOpcode ||
+      major == ReturnFromExceptionOpcode || major == MoveToSPROpcode ||
+      getOpcodeInfo(major).type == InstructionClass::Store;
+}
+
+IdleLoopDetector::Event
+IdleLoopDetector::endIteration(uint64_t nCycles)
+{
+  const uint64_t cycles = nCycles - iterationStart;
+  iterationStart = nCycles;
+
+  /* The first iteration consists of the delay slot only */
+  if (firstIteration)
+    {
+      firstIteration = false;
+      current.clear();
+      return Event::Iteration;
+    }
+
+  /* Polling loops read memory. Requiring a recorded load also ensures
+   * that the write back stage records the register writes and memory
+   * accesses, without which counting loops would look idle.
+   */
+  const bool steady = cycles == previousCycles &&
+      current.size() == previous.size() &&
+      std::any_of(current.begin(), current.end(),
+                  [](const RetiredInstruction &r) { return r.accessesMemory; }) &&
+      std::equal(current.begin(), current.end(), previous.begin(),
+                 sameExecution);
+
+  previousCycles = cycles;
+  previous.swap(current);
+  current.clear();
+
+  return steady ? Event::SteadyIteration : Event::Iteration;
+}
@@ -0,0 +1,86 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    idle-loop.h - Detection of idle loops that can be fast-forwarded.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __IDLE_LOOP_H__
+#define __IDLE_LOOP_H__
+
+#include "memory-interface.h"
+#include "stages.h"
+
+#include <vector>
+
+/* Guest programs often wait for a device by polling a status register
+ * in a short loop. Such a loop does not change any state while it waits:
+ * every iteration retires the same instructions, writing the same values
+ * to the same registers and reading the same values from memory. The
+ * detector observes the retired instructions and reports when a loop
+ * reached this steady state, after which simulated time can jump ahead
+ * by whole iterations until the next device event.
+ *
+ * A loop is a backward l.j, l.bf or l.bnf and the instructions from its
+ * target up to and including its delay slot. Loops of at most
+ * MaxLoopLength instructions are detected automatically; longer loops
+ * of at most MaxHintedLoopLength instructions are detected when they
+ * start with the idle hint "l.nop 0x10". Loops containing stores or
+ * instructions that change the processor state, such as l.mtspr, are
+ * never idle, and neither are loops that do not read memory or that
+ * load from a device whose reads have side effects, such as the serial
+ * data register.
+ *
+ * Loops are recognized by the memory accesses recorded in the retired
+ * instructions. As long as the write back stage does not record them
+ * (a TODO in stages.cc), no loop is ever idle.
+ */
+class IdleLoopDetector
+{
+  public:
+    static constexpr size_t MaxLoopLength = 16;
+    static constexpr size_t MaxHintedLoopLength = 256;
+    static constexpr uint16_t IdleHint = 0x10;
+
+    enum class Event
+    {
+      None,
+      Iteration,        /* an iteration of a loop ended */
+      SteadyIteration   /* ... identical to the previous iteration */
+    };
+
+    /* "memory" is asked which loads have side effects, no ownership */
+    explicit IdleLoopDetector(const MemoryInterface &memory)
+      : memory{ memory }
+    { }
+
+    /* Called for every retired instruction, in order; "nCycles" is the
+     * current cycle count.
+     */
+    Event retire(const RetiredInstruction &retired, uint64_t nCycles);
+
+    /* Forgets the current loop, e.g. after the state changed */
+    void reset();
+
+    IdleLoopDetector(const IdleLoopDetector &) = delete;
+    IdleLoopDetector &operator=(const IdleLoopDetector &) = delete;
+
+  private:
+    const MemoryInterface &memory;
+
+    MemAddress branchPC{};  /* loop branch, 0 if not in a loop */
+    bool inDelaySlot{};
+    bool firstIteration{};
+    bool hinted{};
+
+    std::vector<RetiredInstruction> previous{};
+    std::vector<RetiredInstruction> current{};
+
+    uint64_t iterationStart{};
+    uint64_t previousCycles{};
+
+    bool hasSideEffects(const RetiredInstruction &retired) const;
+    Event endIteration(uint64_t nCycles);
+};
+
+#endif /* __IDLE_LOOP_H__ */
@@ -9,6 +9,209 @@
 #include "inst-decoder.h"
 
 #include <map>
+#include <array>
+
+/* Major opcodes that are split into multiple opcode IDs. */
+static constexpr uint32_t ShiftImmOpcode = 0x2e;
+static constexpr uint32_t ALUOpcode = 0x38;
+static constexpr uint32_t ALUShiftFunction = 0x8;
+static constexpr uint32_t VectorOpcode = 0x0a;
+static constexpr uint32_t FloatOpcode = 0x32;
+static constexpr uint32_t MoveToSPROpcode = 0x30;
+
+static constexpr OpcodeID ALUFirstID = NumMajorOpcodes;
+static constexpr OpcodeID ALUShiftFirstID = ALUFirstID + 16;
+static constexpr OpcodeID ShiftImmFirstID = ALUShiftFirstID + 4;
+static constexpr OpcodeID VectorFirstID = ShiftImmFirstID + 4;
+static constexpr OpcodeID FloatFirstID = VectorFirstID + NumVectorOpcodeIDs;
+
+/* Floating-point instructions, by function code */
+static constexpr std::array<const char *, NumFloatOpcodeIDs> floatMnemonics
+{{
+  "lf.add.s", "lf.sub.s", "lf.mul.s", "lf.div.s",
+  "lf.itof.s", "lf.ftoi.s", "lf.rem.s", "lf.madd.s",
+  "lf.sfeq.s", "lf.sfne.s", "lf.sfgt.s", "lf.sfge.s",
+  "lf.sflt.s", "lf.sfle.s"
+}};
+
+/* Vector instructions operate on the bytes (.b) or half-words (.h) of
+ * a register, see ALUOp for their semantics.
+ */
+struct VectorFunction
+{
+  uint8_t function;
+  const char *mnemonic;
+};
+
+static constexpr std::array<VectorFunction, NumVectorOpcodeIDs> vectorOpcodes
+{{
+  { 0x10, "lv.all_eq.b" }, { 0x11, "lv.all_eq.h" },
+  { 0x12, "lv.all_ge.b" }, { 0x13, "lv.all_ge.h" },
+  { 0x14, "lv.all_gt.b" }, { 0x15, "lv.all_gt.h" },
+  { 0x16, "lv.all_le.b" }, { 0x17, "lv.all_le.h" },
+  { 0x18, "lv.all_lt.b" }, { 0x19, "lv.all_lt.h" },
+  { 0x1a, "lv.all_ne.b" }, { 0x1b, "lv.all_ne.h" },
+  { 0x20, "lv.any_eq.b" }, { 0x21, "lv.any_eq.h" },
+  { 0x22, "lv.any_ge.b" }, { 0x23, "lv.any_ge.h" },
+  { 0x24, "lv.any_gt.b" }, { 0x25, "lv.any_gt.h" },
+  { 0x26, "lv.any_le.b" }, { 0x27, "lv.any_le.h" },
+  { 0x28, "lv.any_lt.b" }, { 0x29, "lv.any_lt.h" },
+  { 0x2a, "lv.any_ne.b" }, { 0x2b, "lv.any_ne.h" },
+  { 0x30, "lv.add.b" }, { 0x31, "lv.add.h" },
+  { 0x32, "lv.adds.b" }, { 0x33, "lv.adds.h" },
+  { 0x34, "lv.addu.b" }, { 0x35, "lv.addu.h" },
+  { 0x36, "lv.addus.b" }, { 0x37, "lv.addus.h" },
+  { 0x40, "lv.cmp_eq.b" }, { 0x41, "lv.cmp_eq.h" },
+  { 0x42, "lv.cmp_ge.b" }, { 0x43, "lv.cmp_ge.h" },
+  { 0x44, "lv.cmp_gt.b" }, { 0x45, "lv.cmp_gt.h" },
+  { 0x46, "lv.cmp_le.b" }, { 0x47, "lv.cmp_le.h" },
+  { 0x48, "lv.cmp_lt.b" }, { 0x49, "lv.cmp_lt.h" },
+  { 0x4a, "lv.cmp_ne.b" }, { 0x4b, "lv.cmp_ne.h" },
+  { 0x5c, "lv.muls.h" },
+  { 0x71, "lv.sub.b" }, { 0x72, "lv.sub.h" },
+  { 0x73, "lv.subs.b" }, { 0x74, "lv.subs.h" },
+  { 0x75, "lv.subu.b" }, { 0x76, "lv.subu.h" },
+  { 0x77, "lv.subus.b" }, { 0x78, "lv.subus.h" },
+}};
+
+/* Opcode ID per vector function code, 0 if not supported */
+static const std::array<OpcodeID, 256> vectorIDs = []
+{
+  std::array<OpcodeID, 256> ids{};
+  for (size_t i = 0; i < vectorOpcodes.size(); ++i)
+    ids[vectorOpcodes[i].function] = VectorFirstID + i;
+
+  return ids;
+}();
+
+using IC = InstructionClass;
+
+static const OpcodeInfo unknownOpcode{ "unknown", IC::Other, 0 };
+
+static const std::array<OpcodeInfo, NumOpcodeIDs> opcodeTable = []
+{
+  std::array<OpcodeInfo, NumOpcodeIDs> table;
+  table.fill(unknownOpcode);
+
+  /* Major opcodes */
+  table[0x00] = { "l.j", IC::Branch, 0 };
+  table[0x01] = { "l.jal", IC::Branch, 0 };
+  table[0x02] = { "l.adrp", IC::ALU, 0 };
+  table[0x03] = { "l.bnf", IC::Branch, 0 };
+  table[0x04] = { "l.bf", IC::Branch, 0 };
+  table[0x05] = { "l.nop", IC::Other, 0 };
+  table[0x06] = { "l.movhi", IC::ALU, 0 };
+  table[0x08] = { "l.sys", IC::Other, 0 };
+  table[0x09] = { "l.rfe", IC::Branch, 0 };
+  table[0x0a] = { "lv.*", IC::Vector, 0 };
+  table[0x11] = { "l.jr", IC::Branch, 0 };
+  table[0x12] = { "l.jalr", IC::Branch, 0 };
+  table[0x13] = { "l.maci", IC::MulDiv, 0 };
+  table[0x1b] = { "l.lwa", IC::Load, 4 };
+  table[0x1c] = { "l.cust1", IC::Other, 0 };
+  table[0x1d] = { "l.cust2", IC::Other, 0 };
+  table[0x1e] = { "l.cust3", IC::Other, 0 };
+  table[0x1f] = { "l.cust4", IC::Other, 0 };
+  table[0x20] = { "l.ld", IC::Load, 8 };
+  table[0x21] = { "l.lwz", IC::Load, 4 };
+  table[0x22] = { "l.lws", IC::Load, 4 };
+  table[0x23] = { "l.lbz", IC::Load, 1 };
+  table[0x24] = { "l.lbs", IC::Load, 1 };
+  table[0x25] = { "l.lhz", IC::Load, 2 };
+  table[0x26] = { "l.lhs", IC::Load, 2 };
+  table[0x27] = { "l.addi", IC::ALU, 0 };
+  table[0x28] = { "l.addic", IC::ALU, 0 };
+  table[0x29] = { "l.andi", IC::ALU, 0 };
+  table[0x2a] = { "l.ori", IC::ALU, 0 };
+  table[0x2b] = { "l.xori", IC::ALU, 0 };
+  table[0x2c] = { "l.muli", IC::MulDiv, 0 };
+  table[0x2d] = { "l.mfspr", IC::Other, 0 };
+  table[0x2f] = { "l.sfi", IC::ALU, 0 };
+  table[0x30] = { "l.mtspr", IC::Other, 0 };
+  table[0x31] = { "l.mac", IC::MulDiv, 0 };
+  table[0x32] = { "lf.*", IC::Float, 0 };
+  table[0x33] = { "l.swa", IC::Store, 4 };
+  table[0x34] = { "l.sd", IC::Store, 8 };
+  table[0x35] = { "l.sw", IC::Store, 4 };
+  table[0x36] = { "l.sb", IC::Store, 1 };
+  table[0x37] = { "l.sh", IC::Store, 2 };
+  table[0x39] = { "l.sf", IC::ALU, 0 };
+  table[0x3c] = { "l.cust5", IC::Other, 0 };
+  table[0x3d] = { "l.cust6", IC::Other, 0 };
+  table[0x3e] = { "l.cust7", IC::Other, 0 };
+  table[0x3f] = { "l.cust8", IC::Other, 0 };
+
+  /* Register-register ALU instructions, by function code */
+  table[ALUFirstID + 0x0] = { "l.add", IC::ALU, 0 };
+  table[ALUFirstID + 0x1] = { "l.addc", IC::ALU, 0 };
+  table[ALUFirstID + 0x2] = { "l.sub", IC::ALU, 0 };
+  table[ALUFirstID + 0x3] = { "l.and", IC::ALU, 0 };
+  table[ALUFirstID + 0x4] = { "l.or", IC::ALU, 0 };
+  table[ALUFirstID + 0x5] = { "l.xor", IC::ALU, 0 };
+  table[ALUFirstID + 0x6] = { "l.mul", IC::MulDiv, 0 };
+  table[ALUFirstID + 0x7] = { "l.muld", IC::MulDiv, 0 };
+  table[ALUFirstID + 0x9] = { "l.div", IC::MulDiv, 0 };
+  table[ALUFirstID + 0xa] = { "l.divu", IC::MulDiv, 0 };
+  table[ALUFirstID + 0xb] = { "l.mulu", IC::MulDiv, 0 };
+  table[ALUFirstID + 0xc] = { "l.ext", IC::ALU, 0 };
+  table[ALUFirstID + 0xd] = { "l.extw", IC::ALU, 0 };
+  table[ALUFirstID + 0xe] = { "l.cmov", IC::ALU, 0 };
+  table[ALUFirstID + 0xf] = { "l.ff1", IC::ALU, 0 };
+
+  /* Shifts, by shift type */
+  table[ALUShiftFirstID + 0] = { "l.sll", IC::ALU, 0 };
+  table[ALUShiftFirstID + 1] = { "l.srl", IC::ALU, 0 };
+  table[ALUShiftFirstID + 2] = { "l.sra", IC::ALU, 0 };
+  table[ALUShiftFirstID + 3] = { "l.ror", IC::ALU, 0 };
+  table[ShiftImmFirstID + 0] = { "l.slli", IC::ALU, 0 };
+  table[ShiftImmFirstID + 1] = { "l.srli", IC::ALU, 0 };
+  table[ShiftImmFirstID + 2] = { "l.srai", IC::ALU, 0 };
+  table[ShiftImmFirstID + 3] = { "l.rori", IC::ALU, 0 };
+
+  /* Vector instructions, by function code */
+  for (size_t i = 0; i < vectorOpcodes.size(); ++i)
+    table[VectorFirstID + i] = { vectorOpcodes[i].mnemonic, IC::Vector, 0 };
+
+  /* Floating-point instructions, by function code */
+  for (size_t i = 0; i < floatMnemonics.size(); ++i)
+    table[FloatFirstID + i] = { floatMnemonics[i], IC::Float, 0 };
+
+  return table;
+}();
+
+
+const OpcodeInfo &
+getOpcodeInfo(OpcodeID id)
+{
+  if (id >= opcodeTable.size())
+    return unknownOpcode;
+
+  return opcodeTable[id];
+}
+
+const char *
+getInstructionClassName(InstructionClass type)
+{
+  switch (type)
+    {
+      case InstructionClass::ALU:
+        return "alu";
+      case InstructionClass::MulDiv:
+        return "mul/div";
+      case InstructionClass::Load:
+        return "load";
+      case InstructionClass::Store:
+        return "store";
+      case InstructionClass::Branch:
+        return "branch";
+      case InstructionClass::Vector:
+        return "vector";
+      case InstructionClass::Float:
+        return "float";
+      default:
+        return "other";
+    }
+}
 
 /*
  * Class InstructionDecoder -- helper class for getting specific
@@ -27,27 +230,68 @@ InstructionDecoder::getInstructionWord() const
   return instructionWord;
 }
 
+OpcodeID
+InstructionDecoder::getOpcodeID() const
+{
+  const uint32_t major = instructionWord >> 26;
+  const uint32_t shiftType = (instructionWord >> 6) & 0x3;
+
+  if (major == ALUOpcode)
+    {
+      const uint32_t function = instructionWord & 0xf;
+      if (function == ALUShiftFunction)
+        return ALUShiftFirstID + shiftType;
+      return ALUFirstID + function;
+    }
+  else if (major == ShiftImmOpcode)
+    return ShiftImmFirstID + shiftType;
+  else if (major == VectorOpcode)
+    {
+      const OpcodeID id = vectorIDs[instructionWord & 0xff];
+      return id != 0 ? id : major;
+    }
+  else if (major == FloatOpcode)
+    {
+      const uint32_t function = instructionWord & 0xff;
+      if (function < NumFloatOpcodeIDs)
+        return FloatFirstID + function;
+      return major;
+    }
+
+  return major;
+}
+
+uint32_t
+InstructionDecoder::getFunction() const
+{
+  return instructionWord & 0xff;
+}
+
+uint16_t
+InstructionDecoder::getSPRImmediate() const
+{
+  /* l.mtspr has rB in bits 15-11, so K is split around it. */
+  if ((instructionWord >> 26) == MoveToSPROpcode)
+    return ((instructionWord >> 10) & 0xf800) | (instructionWord & 0x7ff);
+
+  return instructionWord & 0xffff;
+}
+
 
 RegNumber
 InstructionDecoder::getA() const
 {
-  /* TODO: implement */
-
-  return 0;  /* result undefined */
+  return (instructionWord >> 16) & 0x1f;
 }
 
 RegNumber
 InstructionDecoder::getB() const
 {
-  /* TODO: implement */
-
-  return 0;  /* result undefined */
+  return (instructionWord >> 11) & 0x1f;
 }
 
 RegNumber
 InstructionDecoder::getD() const
 {
-  /* TODO: implement */
-
-  return 0; /* result undefined */
+  return (instructionWord >> 21) & 0x1f;
 }
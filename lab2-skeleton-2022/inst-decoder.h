@@ -17,6 +17,45 @@ static const int INSTRUCTION_SIZE = 4;
 
 /* TODO: add enums and constants necessary for your instruction decoder. */
 
+/* Opcode IDs identify the operation an instruction performs and can be
+ * used to index flat arrays, e.g. for statistics. For most instructions
+ * this is the major opcode (bits 31-26). The register-register ALU
+ * instructions (major opcode 0x38) are distinguished further by their
+ * function code, the shift instructions by their shift type and the
+ * supported vector (major opcode 0x0a) and floating-point (major
+ * opcode 0x32) instructions by their function code (bits 7-0).
+ */
+using OpcodeID = uint8_t;
+
+static constexpr size_t NumMajorOpcodes = 64;
+static constexpr size_t NumVectorOpcodeIDs = 53;
+static constexpr size_t NumFloatOpcodeIDs = 14;
+static constexpr size_t NumOpcodeIDs =
+    NumMajorOpcodes + 16 + 4 + 4 + NumVectorOpcodeIDs + NumFloatOpcodeIDs;
+
+enum class InstructionClass
+{
+  ALU,
+  MulDiv,
+  Load,
+  Store,
+  Branch,
+  Vector,
+  Float,
+  Other,
+  LAST
+};
+
+struct OpcodeInfo
+{
+  const char *mnemonic;
+  InstructionClass type;
+  uint8_t memSize;  /* access size in bytes for loads and stores */
+};
+
+const OpcodeInfo &getOpcodeInfo(OpcodeID id);
+const char *getInstructionClassName(InstructionClass type);
+
 
 /* Exception that should be thrown when an illegal instruction
  * is encountered.
@@ -45,6 +84,18 @@ class InstructionDecoder
     RegNumber           getB() const;
     RegNumber           getD() const;
 
+    OpcodeID            getOpcodeID() const;
+
+    /* Function code of vector and floating-point instructions, see
+     * getVectorALUOp() and getFPUOp().
+     */
+    uint32_t            getFunction() const;
+
+    /* Immediate K of l.mfspr and l.mtspr, which is or'ed with rA to
+     * form the special-purpose register number.
+     */
+    uint16_t            getSPRImmediate() const;
+
     /* TODO: probably want methods to get opcode, function code */
 
     /* TODO: need a method to obtain the immediate */
@@ -12,9 +12,94 @@
 #include <iostream>
 
 
+/* Vector instructions all have the form "lv.op rD,rA,rB" */
+static bool
+formatVector(std::ostream &os, const InstructionDecoder &decoder)
+{
+  const uint32_t word = decoder.getInstructionWord();
+  const OpcodeID id = decoder.getOpcodeID();
+  const OpcodeInfo &info = getOpcodeInfo(id);
+
+  /* Unsupported vector instructions have the major opcode as ID */
+  if (info.type != InstructionClass::Vector || id == (word >> 26))
+    return false;
+
+  os << info.mnemonic << " r" << ((word >> 21) & 0x1f)
+     << ",r" << ((word >> 16) & 0x1f)
+     << ",r" << ((word >> 11) & 0x1f);
+
+  return true;
+}
+
+/* Floating-point instructions: "lf.op rD,rA,rB", conversions have no
+ * rB and compares have no rD.
+ */
+static bool
+formatFloat(std::ostream &os, const InstructionDecoder &decoder)
+{
+  const uint32_t word = decoder.getInstructionWord();
+  const OpcodeID id = decoder.getOpcodeID();
+  const OpcodeInfo &info = getOpcodeInfo(id);
+
+  if (info.type != InstructionClass::Float || id == (word >> 26))
+    return false;
+
+  const uint32_t function = decoder.getFunction();
+  const uint32_t rD = (word >> 21) & 0x1f;
+  const uint32_t rA = (word >> 16) & 0x1f;
+  const uint32_t rB = (word >> 11) & 0x1f;
+
+  os << info.mnemonic << " ";
+  if (function >= 0x08)
+    os << "r" << rA << ",r" << rB;
+  else if (function == 0x04 || function == 0x05)
+    os << "r" << rD << ",r" << rA;
+  else
+    os << "r" << rD << ",r" << rA << ",r" << rB;
+
+  return true;
+}
+
+/* Exception return and special-purpose register moves:
+ * "l.rfe", "l.mfspr rD, rA, $K" and "l.mtspr rA, rB, $K".
+ */
+static bool
+formatSystem(std::ostream &os, const InstructionDecoder &decoder)
+{
+  const uint32_t major = decoder.getInstructionWord() >> 26;
+  const char *mnemonic = getOpcodeInfo(major).mnemonic;
+  const unsigned int rD = decoder.getD();
+  const unsigned int rA = decoder.getA();
+  const unsigned int rB = decoder.getB();
+
+  switch (major)
+    {
+      case 0x09:
+        os << mnemonic;
+        return true;
+
+      case 0x2d:
+        os << mnemonic << " r" << rD << ", r" << rA
+           << ", $" << decoder.getSPRImmediate();
+        return true;
+
+      case 0x30:
+        os << mnemonic << " r" << rA << ", r" << rB
+           << ", $" << decoder.getSPRImmediate();
+        return true;
+
+      default:
+        return false;
+    }
+}
+
 std::ostream &
 operator<<(std::ostream &os, const InstructionDecoder &decoder)
 {
+  if (formatVector(os, decoder) || formatFloat(os, decoder) ||
+      formatSystem(os, decoder))
+    return os;
+
   /* TODO: write a textual representation of the decoded instruction
    * in "decoder" to the output stream "os". Do not include a newline.
    * And remove the statement below.
@@ -0,0 +1,200 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-profile.cc - Instruction mix statistics collected at retire.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "inst-profile.h"
+
+#include <iomanip>
+
+/* Major opcodes of the conditional branches */
+static constexpr uint32_t BranchNoFlagOpcode = 0x03;
+static constexpr uint32_t BranchFlagOpcode = 0x04;
+
+static size_t
+sizeIndex(uint8_t size)
+{
+  switch (size)
+    {
+      case 1:
+        return 0;
+      case 2:
+        return 1;
+      case 4:
+        return 2;
+      default:
+        return 3;
+    }
+}
+
+void
+InstructionProfile::retire(uint32_t instructionWord, bool flag)
+{
+  decoder.setInstructionWord(instructionWord);
+  const OpcodeID id = decoder.getOpcodeID();
+  const OpcodeInfo &info = getOpcodeInfo(id);
+
+  ++counts[id];
+  ++classCounts[static_cast<size_t>(info.type)];
+
+  switch (info.type)
+    {
+      case InstructionClass::Load:
+        ++loadSizes[sizeIndex(info.memSize)];
+        break;
+
+      case InstructionClass::Store:
+        ++storeSizes[sizeIndex(info.memSize)];
+        break;
+
+      case InstructionClass::Branch:
+        {
+          const uint32_t major = instructionWord >> 26;
+          if (major == BranchFlagOpcode || major == BranchNoFlagOpcode)
+            {
+              if (flag == (major == BranchFlagOpcode))
+                ++branchesTaken;
+              else
+                ++branchesNotTaken;
+            }
+        }
+        break;
+
+      default:
+        break;
+    }
+}
+
+void
+InstructionProfile::stall(uint32_t instructionWord)
+{
+  decoder.setInstructionWord(instructionWord);
+  ++stalls[decoder.getOpcodeID()];
+}
+
+void
+InstructionProfile::repeat(const InstructionProfile &from,
+                           const InstructionProfile &to, uint64_t times)
+{
+  repeat(counts, from.counts, to.counts, times);
+  repeat(stalls, from.stalls, to.stalls, times);
+  repeat(classCounts, from.classCounts, to.classCounts, times);
+
+  branchesTaken += (to.branchesTaken - from.branchesTaken) * times;
+  branchesNotTaken += (to.branchesNotTaken - from.branchesNotTaken) * times;
+
+  repeat(loadSizes, from.loadSizes, to.loadSizes, times);
+  repeat(storeSizes, from.storeSizes, to.storeSizes, times);
+}
+
+void
+InstructionProfile::dump(std::ostream &os, bool withStalls) const
+{
+  auto storeFlags(os.flags());
+  uint64_t total{};
+  for (auto count : counts)
+    total += count;
+
+  auto percentage = [total](uint64_t count)
+    {
+      return total ? 100.0 * count / total : 0.0;
+    };
+
+  os << "Instruction mix:" << std::endl;
+  for (size_t id = 0; id < counts.size(); ++id)
+    {
+      if (counts[id] == 0)
+        continue;
+
+      os << "  " << std::left << std::setw(10)
+         << getOpcodeInfo(id).mnemonic << std::right
+         << std::setw(12) << counts[id] << " "
+         << std::fixed << std::setprecision(2)
+         << std::setw(6) << percentage(counts[id]) << "%";
+      if (withStalls)
+        os << std::setw(12) << stalls[id] << " stall cycles";
+      os << std::endl;
+    }
+
+  os << "Instruction classes:" << std::endl;
+  for (size_t i = 0; i < classCounts.size(); ++i)
+    {
+      os << "  " << std::left << std::setw(10)
+         << getInstructionClassName(static_cast<InstructionClass>(i))
+         << std::right << std::setw(12) << classCounts[i] << " "
+         << std::fixed << std::setprecision(2)
+         << std::setw(6) << percentage(classCounts[i]) << "%" << std::endl;
+    }
+  os.flags(storeFlags);
+
+  const uint64_t branches = branchesTaken + branchesNotTaken;
+  os << branches << " conditional branches, "
+     << branchesTaken << " taken, "
+     << branchesNotTaken << " not taken";
+  if (branches)
+    os << " (" << std::fixed << std::setprecision(2)
+       << 100.0 * branchesTaken / branches << "% taken)";
+  os << "." << std::endl;
+  os.flags(storeFlags);
+
+  dumpSizes(os, "Load", loadSizes);
+  dumpSizes(os, "Store", storeSizes);
+}
+
+void
+InstructionProfile::registerStatistics(StatisticsRegistry &registry,
+                                       const std::string &prefix) const
+{
+  /* Opcode IDs without a mnemonic are labeled by their number, such
+   * that all labels are unique.
+   */
+  std::vector<std::string> opcodeLabels;
+  for (size_t i = 0; i < counts.size(); ++i)
+    {
+      const OpcodeInfo &info = getOpcodeInfo(i);
+      if (info.type == InstructionClass::Other &&
+          std::string{ info.mnemonic } == "unknown")
+        opcodeLabels.push_back("opcode_" + std::to_string(i));
+      else
+        opcodeLabels.push_back(info.mnemonic);
+    }
+
+  std::vector<std::string> classLabels;
+  for (size_t i = 0; i < classCounts.size(); ++i)
+    classLabels.push_back(
+        getInstructionClassName(static_cast<InstructionClass>(i)));
+
+  const std::vector<std::string> sizeLabels{ "byte", "halfword", "word",
+      "doubleword" };
+
+  registry.addHistogram(prefix + ".opcode_mix",
+                        "Retired instructions per opcode",
+                        counts.data(), opcodeLabels);
+  registry.addHistogram(prefix + ".opcode_stalls",
+                        "Stall cycles per retired opcode",
+                        stalls.data(), opcodeLabels);
+  registry.addHistogram(prefix + ".class_mix",
+                        "Retired instructions per instruction class",
+                        classCounts.data(), classLabels);
+  registry.addHistogram(prefix + ".load_sizes", "Loads per access size",
+                        loadSizes.data(), sizeLabels);
+  registry.addHistogram(prefix + ".store_sizes", "Stores per access size",
+                        storeSizes.data(), sizeLabels);
+  registry.addCounter(prefix + ".branches_taken",
+                      "Conditional branches taken", &branchesTaken);
+  registry.addCounter(prefix + ".branches_not_taken",
+                      "Conditional branches not taken", &branchesNotTaken);
+}
+
+void
+InstructionProfile::dumpSizes(std::ostream &os, const char *name,
+                              const SizeHistogram &sizes)
+{
+  os << name << " sizes: "
+     << sizes[0] << " byte, "
+     << sizes[1] << " halfword, "
+     << sizes[2] << " word, "
+     << sizes[3] << " doubleword." << std::endl;
+}
@@ -0,0 +1,87 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-profile.h - Instruction mix statistics collected at retire.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __INST_PROFILE_H__
+#define __INST_PROFILE_H__
+
+#include "inst-decoder.h"
+#include "statistics.h"
+
+#include <array>
+#include <iostream>
+
+/* The instruction profile counts retired instructions per opcode ID
+ * and per instruction class. Counters are kept in flat arrays indexed
+ * by opcode ID, such that the profile is cheap enough to always be
+ * collected.
+ */
+class InstructionProfile
+{
+  public:
+    /* Account a retired instruction. "flag" is the value of the
+     * branch flag at retire.
+     */
+    void retire(uint32_t instructionWord, bool flag);
+
+    /* Account a stall cycle to the instruction that caused it. */
+    void stall(uint32_t instructionWord);
+
+    /* Accounts the instructions retired between the snapshots "from"
+     * and "to" another "times" times.
+     */
+    void repeat(const InstructionProfile &from, const InstructionProfile &to,
+                uint64_t times);
+
+    uint64_t getCount(OpcodeID id) const { return counts[id]; }
+    uint64_t getStalls(OpcodeID id) const { return stalls[id]; }
+    uint64_t getClassCount(InstructionClass type) const
+    {
+      return classCounts[static_cast<size_t>(type)];
+    }
+
+    uint64_t getBranchesTaken() const { return branchesTaken; }
+    uint64_t getBranchesNotTaken() const { return branchesNotTaken; }
+
+    void dump(std::ostream &os, bool withStalls) const;
+
+    /* Registers the per-opcode and per-class histograms and the branch
+     * counters under the name "prefix".
+     */
+    void registerStatistics(StatisticsRegistry &registry,
+                            const std::string &prefix) const;
+
+  private:
+    /* Access sizes 1, 2, 4 and 8 are mapped to index 0 to 3. */
+    static constexpr size_t NumAccessSizes = 4;
+    using SizeHistogram = std::array<uint64_t, NumAccessSizes>;
+
+    InstructionDecoder decoder{};
+
+    std::array<uint64_t, NumOpcodeIDs> counts{};
+    std::array<uint64_t, NumOpcodeIDs> stalls{};
+    std::array<uint64_t, static_cast<size_t>(InstructionClass::LAST)> classCounts{};
+
+    uint64_t branchesTaken{};
+    uint64_t branchesNotTaken{};
+
+    SizeHistogram loadSizes{};
+    SizeHistogram storeSizes{};
+
+    static void dumpSizes(std::ostream &os, const char *name,
+                          const SizeHistogram &sizes);
+
+    template <size_t N>
+    static void repeat(std::array<uint64_t, N> &counters,
+                       const std::array<uint64_t, N> &from,
+                       const std::array<uint64_t, N> &to, uint64_t times)
+    {
+      for (size_t i = 0; i < N; ++i)
+        counters[i] += (to[i] - from[i]) * times;
+    }
+};
+
+#endif /* __INST_PROFILE_H__ */
@@ -0,0 +1,101 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    interrupt-controller.cc - Programmable interrupt controller.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "interrupt-controller.h"
+
+InterruptController::InterruptController(const MemAddress base)
+  : base{ base }
+{
+}
+
+void
+InterruptController::setLine(unsigned int line, bool level)
+{
+  if (line >= 32)
+    throw std::out_of_range("Invalid interrupt line " + std::to_string(line));
+
+  if (level)
+    PICSR |= uint32_t{ 1 } << line;
+  else
+    PICSR &= ~(uint32_t{ 1 } << line);
+}
+
+/*
+ * MemoryInterface
+ */
+
+uint8_t
+InterruptController::readByte(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+uint16_t
+InterruptController::readHalfWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+uint32_t
+InterruptController::readWord(MemAddress addr)
+{
+  switch (addr - base)
+    {
+      case MaskOffset:
+        return PICMR;
+      case StatusOffset:
+        return PICSR;
+      default:
+        throw IllegalAccess("Invalid interrupt controller address");
+    }
+}
+
+uint64_t
+InterruptController::readDoubleWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+
+void
+InterruptController::writeByte(MemAddress addr, uint8_t value)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+void
+InterruptController::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+void
+InterruptController::writeWord(MemAddress addr, uint32_t value)
+{
+  switch (addr - base)
+    {
+      case MaskOffset:
+        PICMR = value;
+        break;
+      case StatusOffset:
+        break;
+      default:
+        throw IllegalAccess("Invalid interrupt controller address");
+    }
+}
+
+void
+InterruptController::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  throw IllegalAccess("Not supported on interrupt controller interface");
+}
+
+bool
+InterruptController::contains(MemAddress addr) const
+{
+  return base <= addr && addr < base + EndOffset;
+}
@@ -0,0 +1,81 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    interrupt-controller.h - Programmable interrupt controller.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __INTERRUPT_CONTROLLER_H__
+#define __INTERRUPT_CONTROLLER_H__
+
+#include "memory-interface.h"
+
+/* Programmable interrupt controller following the OpenRISC PIC, with
+ * its special-purpose registers mapped into memory. Devices drive up to
+ * 32 level-triggered interrupt lines; an external interrupt is pending
+ * while an unmasked line is high. Interrupts are acknowledged at the
+ * device that raised them.
+ *
+ * Register map (offsets relative to base, all word registers):
+ *   0x00 - PICMR, interrupt mask, a set bit enables the line
+ *   0x04 - PICSR, interrupt status, the level of every line (read-only,
+ *          writes are ignored)
+ */
+class InterruptController : public MemoryInterface
+{
+  public:
+    InterruptController(const MemAddress base);
+    ~InterruptController() override = default;
+
+    void setLine(unsigned int line, bool level);
+
+    bool interruptPending() const
+    {
+      return (PICSR & PICMR) != 0;
+    }
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override;
+
+  private:
+    static constexpr MemAddress MaskOffset = 0x00;
+    static constexpr MemAddress StatusOffset = 0x04;
+    static constexpr MemAddress EndOffset = 0x08;
+
+    const MemAddress base;
+
+    uint32_t PICMR{};
+    uint32_t PICSR{};
+};
+
+/* Connection of a device to a line of the interrupt controller. */
+class InterruptLine
+{
+  public:
+    InterruptLine() = default;
+    InterruptLine(InterruptController &pic, unsigned int line)
+      : pic{ &pic }, line{ line }
+    { }
+
+    void set(bool level)
+    {
+      if (pic)
+        pic->setLine(line, level);
+    }
+
+  private:
+    InterruptController *pic{};  /* no ownership */
+    unsigned int line{};
+};
+
+#endif /* __INTERRUPT_CONTROLLER_H__ */
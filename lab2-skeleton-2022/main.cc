@@ -7,10 +7,12 @@
 
 #include "testing.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <regex>
+#include <thread>
 
 #ifdef _MSC_VER
 #include "XGetopt.h"
@@ -18,13 +20,13 @@
 #include <getopt.h>
 #endif
 
+#include "disassembler.h"
 #include "elf-file.h"
 #include "processor.h"
 
 #ifdef _MSC_VER
 /* Defined *somewhere* */
 #undef AbnormalTermination
-#define __builtin_bswap32 _byteswap_ulong
 #endif
 
 #include <filesystem>
@@ -62,14 +64,99 @@ validateRegisters(const Processor &p,
 }
 
 
+/* Settings for the emulator, as given on the command line. */
+struct LaunchOptions
+{
+  bool pipelining = false;
+  bool debugMode = false;
+  bool instructionMix = false;
+  bool fastForward = true;
+
+  uint64_t profileInterval{};
+  std::string profileOutput{};
+  std::string callGraphOutput{};
+
+  std::string statisticsOutput{};
+  uint64_t seriesInterval{};
+  std::string seriesOutput{};
+
+  std::string traceOutput{};
+  std::string timingConfigs{};
+
+  std::string serialOutput{};
+  std::string serialInput{};
+
+  BlockDeviceConfig blockDevice{};
+  HeadlessFramebufferConfig video{};
+};
+
+/* Parse a block device specifier of the form IMAGE[,key=value...] */
+static void
+parseBlockDevice(const std::string &spec, BlockDeviceConfig &config)
+{
+  size_t pos = spec.find(',');
+  config.image = spec.substr(0, pos);
+  if (config.image.empty())
+    throw std::invalid_argument("missing disk image");
+
+  while (pos != std::string::npos)
+    {
+      const size_t next = spec.find(',', pos + 1);
+      const std::string option = spec.substr(pos + 1, next - pos - 1);
+      pos = next;
+
+      if (option == "ro")
+        {
+          config.readOnly = true;
+          continue;
+        }
+
+      const size_t equals = option.find('=');
+      if (equals == std::string::npos)
+        throw std::invalid_argument("malformed option " + option);
+
+      const std::string key = option.substr(0, equals);
+      const unsigned long value = std::stoul(option.substr(equals + 1),
+                                             nullptr, 0);
+      if (key == "base")
+        config.base = value;
+      else if (key == "latency")
+        config.latency = value;
+      else if (key == "sector")
+        config.cyclesPerSector = value;
+      else
+        throw std::invalid_argument("unknown option " + key);
+    }
+}
+
+/* Parse a video output specifier of the form FILE[,interval=CYCLES] */
+static void
+parseVideoOutput(const std::string &spec, HeadlessFramebufferConfig &config)
+{
+  const size_t pos = spec.find(',');
+  config.output = spec.substr(0, pos);
+  if (config.output.empty())
+    throw std::invalid_argument("missing output file");
+
+  if (pos == std::string::npos)
+    return;
+
+  const std::string option = spec.substr(pos + 1);
+  if (option.compare(0, 9, "interval=") != 0)
+    throw std::invalid_argument("unknown option " + option);
+
+  config.interval = std::stoull(option.substr(9), nullptr, 0);
+  if (config.interval == 0)
+    throw std::invalid_argument("invalid interval");
+}
+
 /* Start the emulator by either executing a test or running a regular
  * program.
  */
 static int
 launcher(const char *testFilename,
          const char *execFilename,
-         bool pipelining,
-         bool debugMode,
+         const LaunchOptions &options,
          std::vector<RegisterInit> initializers)
 {
   try
@@ -107,18 +194,53 @@ launcher(const char *testFilename,
 
       /* Read the ELF file and start the emulator */
       ELFFile program(programFilename);
-      Processor p(program, pipelining, debugMode);
+      Processor p(program, options.pipelining, options.debugMode);
 
       for (auto &initializer : initializers)
         p.initRegister(initializer.number, initializer.value);
 
+      p.configureSerial(options.serialOutput, options.serialInput);
+      if (!options.blockDevice.image.empty())
+        p.attachBlockDevice(options.blockDevice);
+      if (!options.video.output.empty())
+        p.attachHeadlessFramebuffer(options.video);
+
+      if (!options.fastForward)
+        p.disableFastForward();
+      if (options.profileInterval)
+        p.enableProfiler(options.profileInterval);
+      /* The collapsed stacks of the sampling profiler are taken from
+       * the shadow call stack of the call graph profiler.
+       */
+      if (!options.callGraphOutput.empty() || !options.profileOutput.empty())
+        p.enableCallGraph();
+      if (options.seriesInterval)
+        p.enableStatisticsSeries(options.seriesInterval, options.seriesOutput);
+      if (!options.traceOutput.empty())
+        p.enableTrace(options.traceOutput);
+      if (!options.timingConfigs.empty())
+        p.enableTimingSweep(options.timingConfigs);
+
       p.run(testFilename != nullptr);
+      p.closeTrace();
+      p.finishStatisticsSeries();
+
+      if (!options.statisticsOutput.empty())
+        p.writeStatistics(options.statisticsOutput);
 
       /* Dump registers and statistics when not running a unit test. */
       if (!testFilename)
         {
           p.dumpRegisters();
           p.dumpStatistics();
+#ifdef ENABLE_HOST_PROFILE
+          p.dumpHostProfile();
+#endif
+          if (options.instructionMix)
+            p.dumpInstructionMix();
+          p.dumpProfile(options.profileOutput);
+          p.writeCallGraph(options.callGraphOutput, programFilename);
+          p.dumpTimingSweep();
         }
 
       if (!validateRegisters(p, postRegisters))
@@ -140,46 +262,19 @@ launcher(const char *testFilename,
   return ExitCodes::Success;
 }
 
-static void
-formatDisassembly(InstructionDecoder &decoder, MemAddress PC=0)
-{
-  auto storeFlags(std::cout.flags());
-  std::cout << std::hex;
-  if (PC != 0)
-    std::cout << "0x" << PC << ":\t";
-  std::cout << "0x" << std::setfill('0') << std::setw(8);
-  std::cout << decoder.getInstructionWord() << "\t";
-  std::cout.setf(storeFlags);
-
-  try
-    {
-      std::cout << decoder << std::endl;
-    }
-  catch (IllegalInstruction &e)
-    {
-      std::cout << "illegal instruction" << std::endl;
-    }
-}
-
 static int
 disasmELFFile(const ELFFile &program)
 {
-  std::vector<std::byte> segment;
-  MemAddress segmentBase{};
-  size_t segmentSize{};
+  const std::byte *section{};
+  MemAddress sectionBase{};
+  size_t sectionSize{};
 
-  if (!program.getTextSegment(segment, segmentBase, segmentSize))
+  if (!program.getTextSection(section, sectionBase, sectionSize))
     return ExitCodes::InitializationError;
 
-  InstructionDecoder decoder;
-  size_t i = 0;
-  while (i < segmentSize)
-    {
-      const RegValue *instr = reinterpret_cast<const RegValue*>(&segment[i]);
-      decoder.setInstructionWord(__builtin_bswap32(*instr));
-      formatDisassembly(decoder, segmentBase + i);
-      i += INSTRUCTION_SIZE;
-    }
+  SymbolTable symbols(program.getSymbols());
+  disassembleText(std::cout, section, sectionBase, sectionSize, symbols,
+                  std::max(1u, std::thread::hardware_concurrency()));
 
   return ExitCodes::Success;
 }
@@ -187,28 +282,46 @@ disasmELFFile(const ELFFile &program)
 static int
 disasmASCIIFile(const char *disasmArg)
 {
-  InstructionDecoder decoder;
+  std::string buffer;
+  DisassemblyFormatter formatter(buffer);
+
+  /* Write out the buffer every so often to bound its size */
+  constexpr size_t writeThreshold = 1 << 16;
+  auto writeBuffer = [&buffer]()
+    {
+      std::cout.write(buffer.data(), buffer.size());
+      buffer.clear();
+    };
+
   std::ifstream infile(disasmArg);
   std::string line;
   int line_no = 1;
   while (std::getline(infile, line))
     {
+      uint32_t instructionWord;
       try
         {
-          decoder.setInstructionWord(std::stoul(line, nullptr, 16));
+          instructionWord = std::stoul(line, nullptr, 16);
         }
       catch (std::exception &e)
         {
+          writeBuffer();
+          std::cout.flush();
           std::cerr << "Error: failed to parse instruction at line "
                     << line_no << std::endl;
           return ExitCodes::InvalidArgument;
         }
 
-      formatDisassembly(decoder);
+      formatter.format(instructionWord);
+      if (buffer.size() >= writeThreshold)
+        writeBuffer();
 
       ++line_no;
     }
 
+  writeBuffer();
+  std::cout.flush();
+
   return ExitCodes::Success;
 }
 
@@ -254,9 +367,12 @@ disasmSingle(const char *disasmArg)
    */
   try
     {
-      InstructionDecoder decoder;
-      decoder.setInstructionWord(std::stoul(disasmArg, nullptr, 16));
-      formatDisassembly(decoder);
+      const uint32_t instructionWord = std::stoul(disasmArg, nullptr, 16);
+
+      std::string buffer;
+      DisassemblyFormatter formatter(buffer);
+      formatter.format(instructionWord);
+      std::cout << buffer << std::flush;
       return ExitCodes::Success;
     }
   catch (std::exception &e)
@@ -273,7 +389,7 @@ static void
 showHelp(const char *progName)
 {
   std::cerr << "Usage:" << std::endl;
-  std::cerr << progName << " [-d] [-p] [-r REGINIT] <programFilename>" << std::endl;
+  std::cerr << progName << " [-d] [-p] [-f] [-m] [-P INTERVAL] [-F FILE] [-G FILE] [-s FILE] [-i INTERVAL -I FILE] [-T FILE] [-S CONFIG] [-o FILE] [-n FILE] [-b IMAGE[,OPTIONS]] [-V FILE[,interval=CYCLES]] [-r REGINIT] <programFilename>" << std::endl;
   std::cerr << "    or" << std::endl;
   std::cerr << progName << " [-d] [-p] -t <testFilename>" << std::endl;
   std::cerr << "    or" << std::endl;
@@ -286,6 +402,40 @@ R"HERE(
         to the terminal.
     -p, enables pipelining. When omitted, the emulator runs in non-pipelined
         mode.
+    -f, disables fast-forwarding of idle loops, which are then simulated
+        cycle by cycle.
+    -m, prints the instruction mix (per opcode and per instruction class)
+        together with the statistics at program end.
+    -P, enables the sampling profiler, which samples the committed PC
+        every INTERVAL clock cycles and prints a flat profile per
+        function at program end.
+    -F, writes the profile in collapsed stack format to FILE, for use
+        with flame graph tools. Implies -P 1000 when -P is not given.
+        The call stacks are reconstructed as for -G.
+    -G, writes a call graph profile with inclusive and exclusive cycles
+        per function to FILE, in callgrind format.
+    -s, writes all statistics to FILE at program end, as CSV when FILE
+        ends with .csv and as JSON otherwise.
+    -i, -I, write a time series of the statistics to FILE in CSV format,
+        with a row per INTERVAL clock cycles. Every row contains the
+        counter increments over that interval.
+    -T, records a binary trace of all retired instructions to FILE,
+        which can be converted to text using rv64-trace.
+    -S, evaluates the timing configurations in CONFIG during the run
+        and prints the cycles and IPC per configuration at program end.
+    -o, writes the output of the serial interface to FILE instead of
+        standard error, use "-" for standard output.
+    -n, provides input to the serial interface from FILE, use "-" for
+        standard input.
+    -b, attaches a block storage device backed by the disk image IMAGE.
+        OPTIONS is a comma-separated list of: base=ADDRESS (default
+        0x400), latency=CYCLES (per command, default 100),
+        sector=CYCLES (per sector, default 64) and ro (read-only).
+    -V, writes the contents of the framebuffer to FILE every CYCLES bus
+        cycles (default 1000000) instead of showing a window. FILE is a
+        YUV4MPEG2 video when it ends with .y4m and a sequence of PPM
+        images otherwise, use "-" for standard output. Unchanged frames
+        are skipped.
     -r, specifies a register initializer REGINIT, in the form
         rX=Y with X a register number and Y the initializer value.
     -t, enables unit test mode, with testFilename a unit test
@@ -303,8 +453,7 @@ int
 main(int argc, char **argv)
 {
   char c;
-  bool pipelining = false;
-  bool debugMode = false;
+  LaunchOptions options;
   std::vector<RegisterInit> initializers;
   const char *testFilename = nullptr;
   const char *disasmArg = nullptr;
@@ -313,16 +462,118 @@ main(int argc, char **argv)
   /* Command line option processing */
   const char *progName = argv[0];
 
-  while ((c = getopt(argc, argv, "dpr:t:x:X:h")) != -1)
+  while ((c = getopt(argc, argv, "dfmpr:t:x:X:P:F:G:s:i:I:T:S:o:n:b:V:h")) != -1)
     {
       switch (c)
         {
           case 'd':
-            debugMode = true;
+            options.debugMode = true;
+            break;
+
+          case 'f':
+            options.fastForward = false;
+            break;
+
+          case 'm':
+            options.instructionMix = true;
             break;
 
           case 'p':
-            pipelining = true;
+            options.pipelining = true;
+            break;
+
+          case 'P':
+            try
+              {
+                options.profileInterval = std::stoull(optarg, nullptr, 0);
+              }
+            catch (std::exception &)
+              {
+                options.profileInterval = 0;
+              }
+
+            if (options.profileInterval == 0)
+              {
+                std::cerr << "Error: Invalid profiler interval "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'F':
+            options.profileOutput = optarg;
+            break;
+
+          case 'G':
+            options.callGraphOutput = optarg;
+            break;
+
+          case 's':
+            options.statisticsOutput = optarg;
+            break;
+
+          case 'i':
+            try
+              {
+                options.seriesInterval = std::stoull(optarg, nullptr, 0);
+              }
+            catch (std::exception &)
+              {
+                options.seriesInterval = 0;
+              }
+
+            if (options.seriesInterval == 0)
+              {
+                std::cerr << "Error: Invalid statistics interval "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'I':
+            options.seriesOutput = optarg;
+            break;
+
+          case 'T':
+            options.traceOutput = optarg;
+            break;
+
+          case 'S':
+            options.timingConfigs = optarg;
+            break;
+
+          case 'o':
+            options.serialOutput = optarg;
+            break;
+
+          case 'n':
+            options.serialInput = optarg;
+            break;
+
+          case 'b':
+            try
+              {
+                parseBlockDevice(optarg, options.blockDevice);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Malformed block device specifier "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'V':
+            try
+              {
+                parseVideoOutput(optarg, options.video);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Malformed video output specifier "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
             break;
 
           case 'r':
@@ -407,6 +658,15 @@ main(int argc, char **argv)
       return ExitCodes::InvalidArgument;
     }
 
-  return launcher(testFilename, argv[0], pipelining,
-                  debugMode, initializers);
+  if (!options.profileOutput.empty() && options.profileInterval == 0)
+    options.profileInterval = 1000;
+
+  if ((options.seriesInterval == 0) != options.seriesOutput.empty())
+    {
+      std::cerr << "Error: -i and -I must be specified together."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  return launcher(testFilename, argv[0], options, initializers);
 }
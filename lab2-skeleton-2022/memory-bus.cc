@@ -6,6 +6,10 @@
  */
 
 #include "memory-bus.h"
+#include "statistics.h"
+#include "host-profile.h"
+
+#include <algorithm>
 
 MemoryBus::MemoryBus(std::vector<std::unique_ptr<MemoryInterface> > &&clients)
   : clients{ std::move(clients) }
@@ -32,6 +36,13 @@ MemoryBus::getBytesWritten() const
   return bytesWritten;
 }
 
+void
+MemoryBus::addTraffic(uint64_t read, uint64_t written)
+{
+  bytesRead += read;
+  bytesWritten += written;
+}
+
 
 uint8_t
 MemoryBus::readByte(MemAddress addr)
@@ -96,11 +107,83 @@ MemoryBus::contains(MemAddress addr) const
   return true;
 }
 
+bool
+MemoryBus::hasReadSideEffects(MemAddress addr) const
+{
+  for (auto &client : clients)
+    if (client->contains(addr))
+      return client->hasReadSideEffects(addr);
+
+  return false;
+}
+
+void
+MemoryBus::readBlock(MemAddress addr, std::byte *buffer, size_t size)
+{
+  if (size == 0)
+    return;
+
+  bytesRead += size;
+  getBlockClient(addr, size)->readBlock(addr, buffer, size);
+}
+
+void
+MemoryBus::writeBlock(MemAddress addr, const std::byte *buffer, size_t size)
+{
+  if (size == 0)
+    return;
+
+  bytesWritten += size;
+  getBlockClient(addr, size)->writeBlock(addr, buffer, size);
+}
+
+void
+MemoryBus::fillBlock(MemAddress addr, uint8_t value, size_t size)
+{
+  if (size == 0)
+    return;
+
+  bytesWritten += size;
+  getBlockClient(addr, size)->fillBlock(addr, value, size);
+}
+
 void
 MemoryBus::clockPulse()
 {
   for (auto &client : clients)
-    client->clockPulse();
+    {
+      HOST_PROFILE_SCOPE(HostComponent::DeviceClockPulse);
+      client->clockPulse();
+    }
+}
+
+uint64_t
+MemoryBus::getIdleCycles() const
+{
+  uint64_t cycles = MemoryInterface::getIdleCycles();
+  for (auto &client : clients)
+    cycles = std::min(cycles, client->getIdleCycles());
+
+  return cycles;
+}
+
+void
+MemoryBus::skipCycles(uint64_t cycles)
+{
+  for (auto &client : clients)
+    client->skipCycles(cycles);
+}
+
+void
+MemoryBus::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("bus.bytes_read", "Bytes read from the memory bus",
+                      &bytesRead);
+  registry.addCounter("bus.bytes_written", "Bytes written to the memory bus",
+                      &bytesWritten);
+
+  for (auto &client : clients)
+    client->registerStatistics(registry);
 }
 
 /*
@@ -119,9 +202,22 @@ MemoryBus::findClient(MemAddress addr) noexcept
 MemoryInterface *
 MemoryBus::getClient(MemAddress addr)
 {
+  HOST_PROFILE_SCOPE(HostComponent::BusRouting);
   auto *client = findClient(addr);
   if (!client)
     throw IllegalAccess(addr);
 
   return client;
 }
+
+/* Block transfers must be contained within a single client. */
+MemoryInterface *
+MemoryBus::getBlockClient(MemAddress addr, size_t size)
+{
+  auto *client = getClient(addr);
+  const MemAddress last = addr + (size - 1);
+  if (last < addr || !client->contains(last))
+    throw IllegalAccess(addr, size);
+
+  return client;
+}
@@ -24,6 +24,11 @@ class MemoryBus : public MemoryInterface
     uint64_t getBytesRead() const;
     uint64_t getBytesWritten() const;
 
+    /* Accounts traffic of accesses that were not simulated one by one,
+     * such as those of fast-forwarded idle loops.
+     */
+    void addTraffic(uint64_t read, uint64_t written);
+
     /* MemoryInterface */
     uint8_t readByte(MemAddress addr) override;
     uint16_t readHalfWord(MemAddress addr) override;
@@ -36,14 +41,24 @@ class MemoryBus : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    bool hasReadSideEffects(MemAddress addr) const override;
+
+    void readBlock(MemAddress addr, std::byte *buffer, size_t size) override;
+    void writeBlock(MemAddress addr, const std::byte *buffer,
+                    size_t size) override;
+    void fillBlock(MemAddress addr, uint8_t value, size_t size) override;
 
     void clockPulse() override;
+    uint64_t getIdleCycles() const override;
+    void skipCycles(uint64_t cycles) override;
+    void registerStatistics(StatisticsRegistry &registry) override;
 
   private:
     std::vector<std::unique_ptr<MemoryInterface> > clients;
 
     MemoryInterface *findClient(MemAddress addr) noexcept;
     MemoryInterface *getClient(MemAddress addr);
+    MemoryInterface *getBlockClient(MemAddress addr, size_t size);
 
     uint64_t bytesRead = 0;     /* Bytes read from bus */
     uint64_t bytesWritten = 0;  /* Bytes written to bus */
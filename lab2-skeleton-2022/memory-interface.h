@@ -15,7 +15,11 @@
 #include <sstream>
 #include <iomanip>
 
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+
+class StatisticsRegistry;
 
 class MemoryInterface
 {
@@ -32,8 +36,59 @@ class MemoryInterface
 
     virtual bool contains(MemAddress addr) const = 0;
 
+    /* Whether reading "addr" changes the state of the client, such as
+     * consuming input. Loops performing such reads are never
+     * fast-forwarded.
+     */
+    virtual bool hasReadSideEffects(MemAddress addr) const
+    {
+      return false;
+    }
+
+    /* Bulk transfers of "size" bytes, in the byte order of the guest.
+     * The default implementations use byte accesses, memories override
+     * these with a single copy.
+     */
+    virtual void readBlock(MemAddress addr, std::byte *buffer, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        buffer[i] = std::byte{ readByte(addr + i) };
+    }
+
+    virtual void writeBlock(MemAddress addr, const std::byte *buffer,
+                            size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        writeByte(addr + i, std::to_integer<uint8_t>(buffer[i]));
+    }
+
+    virtual void fillBlock(MemAddress addr, uint8_t value, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        writeByte(addr + i, value);
+    }
+
     virtual void clockPulse() { }
 
+    /* Number of upcoming bus clock cycles in which clockPulse() does not
+     * change any state that is visible to the processor or the user.
+     * Clients that override clockPulse() must also override this method
+     * and skipCycles().
+     */
+    virtual uint64_t getIdleCycles() const
+    {
+      return std::numeric_limits<uint64_t>::max();
+    }
+
+    /* Accounts "cycles" idle bus clock cycles at once, used to fast
+     * forward through idle loops. At most getIdleCycles() cycles are
+     * skipped.
+     */
+    virtual void skipCycles(uint64_t cycles) { }
+
+    /* Register the statistics of this client, if any. */
+    virtual void registerStatistics(StatisticsRegistry &registry) { }
+
     virtual ~MemoryInterface() = default;
 };
 
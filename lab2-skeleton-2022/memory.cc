@@ -8,6 +8,7 @@
 #include "memory.h"
 
 #include <cstdlib>
+#include <cstring>
 
 #ifdef _MSC_VER
 #define __builtin_bswap64 _byteswap_uint64
@@ -120,6 +121,33 @@ Memory::contains(MemAddress addr) const
   return base <= addr && addr < base + size;
 }
 
+void
+Memory::readBlock(MemAddress addr, std::byte *buffer, size_t size)
+{
+  if (! canAccess(addr, size, false))
+    throw IllegalAccess(addr, size);
+
+  std::memcpy(buffer, data + (addr - base), size);
+}
+
+void
+Memory::writeBlock(MemAddress addr, const std::byte *buffer, size_t size)
+{
+  if (! canAccess(addr, size, true))
+    throw IllegalAccess(addr, size);
+
+  std::memcpy(data + (addr - base), buffer, size);
+}
+
+void
+Memory::fillBlock(MemAddress addr, uint8_t value, size_t size)
+{
+  if (! canAccess(addr, size, true))
+    throw IllegalAccess(addr, size);
+
+  std::memset(data + (addr - base), value, size);
+}
+
 
 /*
  * Private methods
@@ -39,6 +39,11 @@ class Memory : public MemoryInterface
 
     bool contains(MemAddress addr) const override;
 
+    void readBlock(MemAddress addr, std::byte *buffer, size_t size) override;
+    void writeBlock(MemAddress addr, const std::byte *buffer,
+                    size_t size) override;
+    void fillBlock(MemAddress addr, uint8_t value, size_t size) override;
+
 
     Memory(const Memory &) = delete;
     Memory &operator=(const Memory &) = delete;
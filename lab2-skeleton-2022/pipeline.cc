@@ -6,6 +6,17 @@
  */
 
 #include "pipeline.h"
+#include "host-profile.h"
+
+
+/* Branches and jumps, except l.rfe, are followed by a delay slot. */
+static bool
+hasDelaySlot(uint32_t instructionWord)
+{
+  const OpcodeID major = instructionWord >> 26;
+  return major != 0x09 &&
+      getOpcodeInfo(major).type == InstructionClass::Branch;
+}
 
 
 Pipeline::Pipeline(bool pipelining,
@@ -15,8 +26,10 @@ Pipeline::Pipeline(bool pipelining,
                    InstructionDecoder &decoder,
                    RegisterFile &regfile,
                    bool &flag,
-                   DataMemory &dataMemory)
-  : pipelining{ pipelining }
+                   DataMemory &dataMemory,
+                   ExceptionUnit &exceptions,
+                   FPU &fpu)
+  : pipelining{ pipelining }, PC{ PC }
 {
   /* TODO: this might need modification in case the stages need access
    * to more shared components.
@@ -33,14 +46,45 @@ Pipeline::Pipeline(bool pipelining,
                                                                nStalls,
                                                                debugMode));
   stages.emplace_back(std::make_unique<ExecuteStage>(pipelining,
-                                                     id_ex, ex_m));
+                                                     id_ex, ex_m, fpu));
   stages.emplace_back(std::make_unique<MemoryStage>(pipelining,
                                                     ex_m, m_wb,
                                                     dataMemory));
   stages.emplace_back(std::make_unique<WriteBackStage>(pipelining,
                                                        m_wb,
                                                        regfile, flag,
-                                                       nInstrCompleted));
+                                                       exceptions,
+                                                       redirect,
+                                                       nInstrCompleted,
+                                                       profile,
+                                                       retired));
+}
+
+Pipeline::Counters
+Pipeline::getCounters() const
+{
+  return Counters{ nInstrIssued, nInstrCompleted, nStalls, profile };
+}
+
+void
+Pipeline::repeat(const Counters &from, const Counters &to, uint64_t times)
+{
+  nInstrIssued += (to.instrIssued - from.instrIssued) * times;
+  nInstrCompleted += (to.instrCompleted - from.instrCompleted) * times;
+  nStalls += (to.stalls - from.stalls) * times;
+  profile.repeat(from.profile, to.profile, times);
+}
+
+void
+Pipeline::registerStatistics(StatisticsRegistry &registry) const
+{
+  registry.addCounter("pipeline.instructions_issued",
+                      "Instructions issued", &nInstrIssued);
+  registry.addCounter("pipeline.instructions_completed",
+                      "Instructions completed", &nInstrCompleted);
+  registry.addCounter("pipeline.stall_cycles",
+                      "Stall cycles inserted", &nStalls);
+  profile.registerStatistics(registry, "pipeline");
 }
 
 void
@@ -49,13 +93,17 @@ Pipeline::propagate()
   if (! pipelining)
     {
       /* Execute a single instruction execution step. */
+      HOST_PROFILE_SCOPE(static_cast<HostComponent>(2 * currentStage));
       stages[currentStage]->propagate();
     }
   else
     {
       /* Run propagate for all stages within a single clock cycle. */
-      for (auto &s : stages)
-        s->propagate();
+      for (size_t i = 0; i < stages.size(); ++i)
+        {
+          HOST_PROFILE_SCOPE(static_cast<HostComponent>(2 * i));
+          stages[i]->propagate();
+        }
     }
 }
 
@@ -64,12 +112,68 @@ Pipeline::clockPulse()
 {
   if (! pipelining)
     {
-      stages[currentStage]->clockPulse();
+      {
+        HOST_PROFILE_SCOPE(static_cast<HostComponent>(2 * currentStage + 1));
+        stages[currentStage]->clockPulse();
+      }
       currentStage = (currentStage + 1) % stages.size();
     }
   else
     {
-      for (auto &s : stages)
-        s->clockPulse();
+      for (size_t i = 0; i < stages.size(); ++i)
+        {
+          HOST_PROFILE_SCOPE(static_cast<HostComponent>(2 * i + 1));
+          stages[i]->clockPulse();
+        }
+    }
+
+  if (redirect.valid)
+    {
+      discardYounger();
+      PC = redirect.target;
+      redirect.valid = false;
     }
 }
+
+bool
+Pipeline::canInterrupt() const
+{
+  if (! pipelining && currentStage != 0)
+    return false;
+
+  /* In pipelined mode, the instruction in the write back stage is the
+   * youngest to complete, unless it is a bubble.
+   */
+  if (pipelining && m_wb.PC != 0)
+    return ! hasDelaySlot(m_wb.instructionWord);
+  return retired.PC == 0 || ! hasDelaySlot(retired.instructionWord);
+}
+
+MemAddress
+Pipeline::squash(MemAddress PC)
+{
+  if (! pipelining)
+    return PC;
+
+  /* Resume at the oldest discarded instruction, bubbles have PC 0 */
+  for (MemAddress discarded : { ex_m.PC, id_ex.PC, if_id.PC })
+    if (discarded != 0)
+      {
+        PC = discarded;
+        break;
+      }
+
+  discardYounger();
+  return PC;
+}
+
+void
+Pipeline::discardYounger()
+{
+  if (! pipelining)
+    return;
+
+  if_id = IF_IDRegisters{};
+  id_ex = ID_EXRegisters{};
+  ex_m = EX_MRegisters{};
+}
@@ -15,6 +15,15 @@
 class Pipeline
 {
   public:
+    /* Snapshot of the statistics, see repeat() */
+    struct Counters
+    {
+      uint64_t instrIssued{};
+      uint64_t instrCompleted{};
+      uint64_t stalls{};
+      InstructionProfile profile{};
+    };
+
     Pipeline(bool pipelining,
              bool debugMode,
              MemAddress &PC,
@@ -22,7 +31,9 @@ class Pipeline
              InstructionDecoder &decoder,
              RegisterFile &regfile,
              bool &flag,
-             DataMemory &dataMemory);
+             DataMemory &dataMemory,
+             ExceptionUnit &exceptions,
+             FPU &fpu);
 
     Pipeline(const Pipeline &) = delete;
     Pipeline &operator=(const Pipeline &) = delete;
@@ -30,6 +41,18 @@ class Pipeline
     void propagate();
     void clockPulse();
 
+    /* Whether an interrupt can be taken before the next clock cycle: in
+     * non-pipelined mode only between instructions, and never between a
+     * branch and its delay slot.
+     */
+    bool canInterrupt() const;
+
+    /* Discards the instructions that have not reached the memory stage,
+     * these are executed again after the interrupt. Returns the address
+     * to resume at, which is "PC" if no instructions were discarded.
+     */
+    MemAddress squash(MemAddress PC);
+
     bool getPipelining() const
     {
       return pipelining;
@@ -50,14 +73,45 @@ class Pipeline
       return nStalls;
     }
 
+    /* PC of the most recently retired instruction */
+    MemAddress getCommittedPC() const
+    {
+      return retired.PC;
+    }
+
+    const RetiredInstruction &getRetired() const
+    {
+      return retired;
+    }
+
+    const InstructionProfile &getProfile() const
+    {
+      return profile;
+    }
+
+    Counters getCounters() const;
+
+    /* Advances the statistics as if the instructions executed between
+     * the snapshots "from" and "to" were executed another "times" times.
+     */
+    void repeat(const Counters &from, const Counters &to, uint64_t times);
+
+    void registerStatistics(StatisticsRegistry &registry) const;
+
   private:
     bool pipelining;
     size_t currentStage{};
 
+    /* Fetch address, redirected when l.rfe commits */
+    MemAddress &PC;
+    CommitRedirect redirect{};
+
     /* Statistics */
     uint64_t nInstrIssued{};
     uint64_t nInstrCompleted{};
     uint64_t nStalls{};
+    InstructionProfile profile{};
+    RetiredInstruction retired{};
 
     /* Stages */
     std::vector<std::unique_ptr<Stage>> stages{};
@@ -67,6 +121,9 @@ class Pipeline
     ID_EXRegisters id_ex{};
     EX_MRegisters  ex_m{};
     M_WBRegisters  m_wb{};
+
+    /* Clears the pipeline registers up to the memory stage */
+    void discardYounger();
 };
 
 
@@ -0,0 +1,253 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pixel-convert.cc - Framebuffer pixel format conversion kernels.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "pixel-convert.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+/* The vector kernels are compiled with function-level target attributes
+ * and selected at run time, so the emulator binary still runs on hosts
+ * without AVX2. MSVC only gets the SSE2 kernels, which are part of the
+ * x86-64 baseline.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SSE2_KERNELS
+#define HAVE_AVX2_KERNELS
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define HAVE_SSE2_KERNELS
+#define TARGET_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * Scalar kernels
+ */
+
+static inline uint32_t
+expandY8(uint8_t value)
+{
+  return value * uint32_t{ 0x01010100 } | 0xff;
+}
+
+static void
+convertY8Scalar(const uint8_t *src, uint32_t *dst, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = expandY8(src[i]);
+}
+
+static void
+convertIndexedScalar(const uint8_t *src, uint32_t *dst, size_t count,
+                     const uint32_t *palette)
+{
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = palette[src[i]];
+}
+
+
+/*
+ * SSE2 kernels
+ */
+
+#ifdef HAVE_SSE2_KERNELS
+TARGET_SSE2 static void
+convertY8SSE2(const uint8_t *src, uint32_t *dst, size_t count)
+{
+  const __m128i alpha = _mm_set1_epi32(0xff);
+  size_t i = 0;
+
+  /* Unpacking a byte with itself twice replicates it into all four
+   * bytes of a pixel, the low byte is replaced by the alpha value.
+   */
+  for (; i + 16 <= count; i += 16)
+    {
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      const __m128i lo = _mm_unpacklo_epi8(y, y);
+      const __m128i hi = _mm_unpackhi_epi8(y, y);
+
+      auto *out = reinterpret_cast<__m128i *>(dst + i);
+      _mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+      _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+      _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+      _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+    }
+
+  convertY8Scalar(src + i, dst + i, count - i);
+}
+
+/* SSE2 lacks gathers, the lookups are done four at a time and stored
+ * as a vector.
+ */
+TARGET_SSE2 static void
+convertIndexedSSE2(const uint8_t *src, uint32_t *dst, size_t count,
+                   const uint32_t *palette)
+{
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4)
+    {
+      const __m128i pixels = _mm_setr_epi32(palette[src[i + 0]],
+                                            palette[src[i + 1]],
+                                            palette[src[i + 2]],
+                                            palette[src[i + 3]]);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), pixels);
+    }
+
+  convertIndexedScalar(src + i, dst + i, count - i, palette);
+}
+#endif /* HAVE_SSE2_KERNELS */
+
+
+/*
+ * AVX2 kernels
+ */
+
+#ifdef HAVE_AVX2_KERNELS
+TARGET_AVX2 static void
+convertY8AVX2(const uint8_t *src, uint32_t *dst, size_t count)
+{
+  /* Byte shuffles work per 128-bit lane, so sixteen source bytes are
+   * broadcast to both lanes and every shuffle expands four of them per
+   * lane. Indices with the top bit set produce zero, in which the alpha
+   * value is filled in.
+   */
+  const __m256i expandLo = _mm256_setr_epi8(
+      -1, 0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3,
+      -1, 4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7);
+  const __m256i expandHi = _mm256_add_epi8(expandLo,
+      _mm256_set1_epi32(0x08080800));
+  const __m256i alpha = _mm256_set1_epi32(0xff);
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16)
+    {
+      const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      const __m256i both = _mm256_broadcastsi128_si256(y);
+
+      auto *out = reinterpret_cast<__m256i *>(dst + i);
+      _mm256_storeu_si256(out + 0, _mm256_or_si256(_mm256_shuffle_epi8(both, expandLo), alpha));
+      _mm256_storeu_si256(out + 1, _mm256_or_si256(_mm256_shuffle_epi8(both, expandHi), alpha));
+    }
+
+  convertY8Scalar(src + i, dst + i, count - i);
+}
+
+TARGET_AVX2 static void
+convertIndexedAVX2(const uint8_t *src, uint32_t *dst, size_t count,
+                   const uint32_t *palette)
+{
+  const int *table = reinterpret_cast<const int *>(palette);
+  size_t i = 0;
+
+  for (; i + 16 <= count; i += 16)
+    {
+      const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      const __m256i lo = _mm256_cvtepu8_epi32(indices);
+      const __m256i hi = _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8));
+
+      auto *out = reinterpret_cast<__m256i *>(dst + i);
+      _mm256_storeu_si256(out + 0, _mm256_i32gather_epi32(table, lo, 4));
+      _mm256_storeu_si256(out + 1, _mm256_i32gather_epi32(table, hi, 4));
+    }
+
+  convertIndexedScalar(src + i, dst + i, count - i, palette);
+}
+#endif /* HAVE_AVX2_KERNELS */
+
+
+static const PixelConversion conversions[] =
+{
+  { PixelKernel::Scalar, convertY8Scalar, convertIndexedScalar },
+#ifdef HAVE_SSE2_KERNELS
+  { PixelKernel::SSE2, convertY8SSE2, convertIndexedSSE2 },
+#else
+  { PixelKernel::SSE2, nullptr, nullptr },
+#endif
+#ifdef HAVE_AVX2_KERNELS
+  { PixelKernel::AVX2, convertY8AVX2, convertIndexedAVX2 },
+#else
+  { PixelKernel::AVX2, nullptr, nullptr },
+#endif
+};
+
+static_assert(std::size(conversions) == static_cast<size_t>(PixelKernel::LAST),
+              "missing pixel conversion kernels");
+
+
+const char *
+getPixelKernelName(PixelKernel kernel)
+{
+  switch (kernel)
+    {
+      case PixelKernel::Scalar:
+        return "scalar";
+      case PixelKernel::SSE2:
+        return "sse2";
+      case PixelKernel::AVX2:
+        return "avx2";
+      default:
+        throw std::out_of_range("Unknown pixel kernel");
+    }
+}
+
+bool
+isPixelKernelSupported(PixelKernel kernel)
+{
+  switch (kernel)
+    {
+      case PixelKernel::Scalar:
+        return true;
+
+#ifdef HAVE_SSE2_KERNELS
+      case PixelKernel::SSE2:
+#ifdef __GNUC__
+        return __builtin_cpu_supports("sse2");
+#else
+        return true;
+#endif
+#endif
+
+#ifdef HAVE_AVX2_KERNELS
+      case PixelKernel::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+
+      default:
+        return false;
+    }
+}
+
+const PixelConversion &
+getPixelConversion(PixelKernel kernel)
+{
+  if (! isPixelKernelSupported(kernel))
+    throw std::invalid_argument(std::string("pixel kernel ") +
+                                getPixelKernelName(kernel) +
+                                " is not supported on this host");
+
+  return conversions[static_cast<size_t>(kernel)];
+}
+
+const PixelConversion &
+getPixelConversion()
+{
+  static const PixelConversion &best = []() -> const PixelConversion &
+    {
+      for (size_t k = static_cast<size_t>(PixelKernel::LAST); k-- > 0; )
+        if (isPixelKernelSupported(static_cast<PixelKernel>(k)))
+          return conversions[k];
+      return conversions[0];
+    }();
+
+  return best;
+}
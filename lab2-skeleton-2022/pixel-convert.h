@@ -0,0 +1,46 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pixel-convert.h - Framebuffer pixel format conversion kernels.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __PIXEL_CONVERT_H__
+#define __PIXEL_CONVERT_H__
+
+#include <cstddef>
+#include <cstdint>
+
+/* Kernels that convert a row of 8-bit pixels to 32-bit RGBA8888 pixels
+ * (0xRRGGBBAA in host byte order), for the Y8 and indexed framebuffer
+ * modes. Vector kernels are used when the host supports them.
+ */
+
+enum class PixelKernel
+{
+  Scalar,
+  SSE2,
+  AVX2,
+  LAST
+};
+
+struct PixelConversion
+{
+  PixelKernel kernel;
+
+  void (*y8)(const uint8_t *src, uint32_t *dst, size_t count);
+  void (*indexed)(const uint8_t *src, uint32_t *dst, size_t count,
+                  const uint32_t *palette);
+};
+
+const char *getPixelKernelName(PixelKernel kernel);
+
+bool isPixelKernelSupported(PixelKernel kernel);
+
+/* Returns the kernels of the given type, which must be supported. */
+const PixelConversion &getPixelConversion(PixelKernel kernel);
+
+/* Returns the fastest kernels supported by the host, selected once. */
+const PixelConversion &getPixelConversion();
+
+#endif /* __PIXEL_CONVERT_H__ */
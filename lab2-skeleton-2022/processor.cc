@@ -8,31 +8,70 @@
 #include "processor.h"
 #include "inst-decoder.h"
 #include "serial.h"
+#include "dma.h"
+#include "block-device.h"
 #include "framebuffer.h"
+#include "host-profile.h"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <numeric>
 
 
 Processor::Processor(ELFFile &program, bool pipelining, bool debugMode)
-  : bus{ program.createMemories() },
+  : symbols{ program.getSymbols() },
+    fastForward{ ! debugMode },
+    bus{ program.createMemories() },
     instructionMemory{ bus },
     dataMemory{ bus },
     pipeline{ pipelining, debugMode, PC, instructionMemory, decoder,
-        regfile, flag, dataMemory }
+        regfile, flag, dataMemory, exceptions, fpu }
 {
-  bus.addClient(std::make_unique<Serial>(0x200));
+  auto serialPort = std::make_unique<Serial>(0x200);
+  serial = serialPort.get();
+  bus.addClient(std::move(serialPort));
 
-  auto status = std::make_unique<SysStatus>(0x270);
+  auto status = std::make_unique<SysStatus>(0x270, nCycles, pipeline, bus,
+                                            *serial);
   sysStatus = status.get();
   bus.addClient(std::move(status));
 
+  auto interruptController = std::make_unique<InterruptController>(0x340);
+  pic = interruptController.get();
+  bus.addClient(std::move(interruptController));
+
+  auto timer = std::make_unique<TickTimer>(0x350, nCycles, scheduler);
+  tickTimer = timer.get();
+  bus.addClient(std::move(timer));
+
+  auto dma = std::make_unique<DMAController>(0x300, bus);
+  dma->connectInterrupt(InterruptLine{ *pic, 4 });
+  bus.addClient(std::move(dma));
+
 #ifdef ENABLE_FRAMEBUFFER
   bus.addClient(std::make_unique<Framebuffer>(0x800, 0x1000000));
 #endif
 
   /* Initialize PC */
   PC = program.getEntrypoint();
+
+  statistics.addCounter("cpu.cycles", "Clock cycles", &nCycles);
+  statistics.addCounter("cpu.interrupts", "Interrupts taken", &nInterrupts);
+  statistics.addCounter("cpu.idle_skips", "Idle loops fast-forwarded",
+                        &nIdleSkips);
+  statistics.addCounter("cpu.idle_cycles_skipped",
+                        "Clock cycles fast-forwarded in idle loops",
+                        &nIdleCyclesSkipped);
+  pipeline.registerStatistics(statistics);
+  bus.registerStatistics(statistics);
+  statistics.addRatio("cpu.ipc", "Instructions completed per cycle",
+                      { "pipeline.instructions_completed" },
+                      { "cpu.cycles" });
+  statistics.addRatio("bus.bytes_per_instruction",
+                      "Bytes transferred per instruction completed",
+                      { "bus.bytes_read", "bus.bytes_written" },
+                      { "pipeline.instructions_completed" });
 }
 
 /* This method is used to initialize registers using values
@@ -67,6 +106,14 @@ Processor::getRegister(RegNumber regnum) const
 bool
 Processor::run(bool testMode)
 {
+#ifdef ENABLE_HOST_PROFILE
+  hostProfile.start();
+  struct StopProfile
+  {
+    ~StopProfile() { hostProfile.stop(); }
+  } stopProfile;
+#endif
+
   while (! sysStatus->shouldHalt())
     {
       try
@@ -78,12 +125,45 @@ Processor::run(bool testMode)
           pipeline.propagate();
           pipeline.clockPulse();
           ++nCycles;
+
+          if (nCycles >= scheduler.getNextEventCycle())
+            scheduler.runDue(nCycles);
+          checkInterrupts();
+
+          if (profiler && nCycles == nextProfileSample)
+            {
+              profiler->sample(pipeline.getCommittedPC(),
+                               pipeline.getInstrCompleted(),
+                               callGraph ? callGraph->getCallers()
+                                         : std::string{});
+              nextProfileSample += profiler->getInterval();
+            }
+
+          if (pipeline.getInstrCompleted() != nInstrObserved)
+            {
+              const auto &retired = pipeline.getRetired();
+              if (callGraph)
+                callGraph->retire(retired.PC, retired.instructionWord,
+                                  nCycles);
+              if (trace)
+                trace->record(makeTraceRecord(retired));
+              if (timingSweep)
+                timingSweep->retire(makeTraceRecord(retired));
+              nInstrObserved = pipeline.getInstrCompleted();
+              observeRegionMarker(retired);
+              if (fastForward)
+                observeIdleLoop(retired);
+            }
+
+          if (statisticsSeries)
+            statisticsSeries->clockPulse(nCycles);
         }
       catch (TestEndMarkerEncountered &e)
         {
           if (testMode)
             return true;
           /* else */
+          serial->flush();
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
@@ -94,6 +174,7 @@ Processor::run(bool testMode)
           if (testMode)
             return true;
           /* else */
+          serial->flush();
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
@@ -102,6 +183,7 @@ Processor::run(bool testMode)
       catch (std::exception &e)
         {
           /* Catch exceptions such as IllegalInstruction and InvalidAccess */
+          serial->flush();
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
@@ -109,9 +191,41 @@ Processor::run(bool testMode)
         }
     }
 
+  serial->flush();
   return true;
 }
 
+void
+Processor::configureSerial(const std::string &output, const std::string &input)
+{
+  if (!output.empty())
+    serial->setOutput(output);
+  if (!input.empty())
+    serial->setInput(input);
+}
+
+void
+Processor::attachBlockDevice(const BlockDeviceConfig &config)
+{
+  auto device = std::make_unique<BlockDevice>(config, bus);
+  device->registerStatistics(statistics);
+  bus.addClient(std::move(device));
+}
+
+void
+Processor::attachHeadlessFramebuffer(const HeadlessFramebufferConfig &config)
+{
+#ifdef ENABLE_FRAMEBUFFER
+  throw std::runtime_error("the headless framebuffer requires a build "
+                           "without ENABLE_FRAMEBUFFER");
+#else
+  auto framebuffer = std::make_unique<HeadlessFramebuffer>(0x800, 0x1000000,
+                                                           config);
+  framebuffer->registerStatistics(statistics);
+  bus.addClient(std::move(framebuffer));
+#endif
+}
+
 void
 Processor::dumpRegisters() const
 {
@@ -144,4 +258,280 @@ Processor::dumpStatistics() const
     std::cerr << pipeline.getStalls() << " stall cycles inserted." << std::endl;
   std::cerr << bus.getBytesRead() << " bytes read, "
             << bus.getBytesWritten() << " bytes written." << std::endl;
+
+  for (const auto & [id, stats] : sysStatus->getRegions())
+    {
+      auto counter = [&stats = stats](PerfCounter c)
+        {
+          return stats.counters[static_cast<size_t>(c)];
+        };
+
+      std::cerr << "Region " << id << " (" << stats.instances
+                << (stats.instances == 1 ? " instance" : " instances")
+                << "): "
+                << counter(PerfCounter::Cycles) << " clock cycles, "
+                << counter(PerfCounter::InstrIssued) << " instructions issued, "
+                << counter(PerfCounter::InstrCompleted)
+                << " instructions completed." << std::endl;
+      if (pipeline.getPipelining())
+        std::cerr << "Region " << id << ": "
+                  << counter(PerfCounter::Stalls)
+                  << " stall cycles inserted." << std::endl;
+      std::cerr << "Region " << id << ": "
+                << counter(PerfCounter::BytesRead) << " bytes read, "
+                << counter(PerfCounter::BytesWritten) << " bytes written."
+                << std::endl;
+    }
 }
+
+void
+Processor::dumpInstructionMix() const
+{
+  pipeline.getProfile().dump(std::cerr, pipeline.getPipelining());
+}
+
+void
+Processor::enableProfiler(uint64_t interval)
+{
+  profiler = std::make_unique<SamplingProfiler>(symbols, interval);
+  nextProfileSample = nCycles + interval;
+}
+
+void
+Processor::dumpProfile(const std::string &collapsedFilename) const
+{
+  if (!profiler)
+    return;
+
+  profiler->dump(std::cerr);
+  if (!collapsedFilename.empty())
+    profiler->writeCollapsed(collapsedFilename);
+}
+
+void
+Processor::enableCallGraph()
+{
+  fastForward = false;
+  callGraph = std::make_unique<CallGraphProfiler>(symbols);
+}
+
+void
+Processor::writeCallGraph(const std::string &filename,
+                          const std::string &command) const
+{
+  if (callGraph && !filename.empty())
+    callGraph->writeCallgrind(filename, command);
+}
+
+void
+Processor::writeStatistics(const std::string &filename) const
+{
+  statistics.write(filename);
+}
+
+void
+Processor::enableStatisticsSeries(uint64_t interval,
+                                  const std::string &filename)
+{
+  statisticsSeries =
+      std::make_unique<StatisticsSeries>(statistics, filename, interval);
+}
+
+void
+Processor::finishStatisticsSeries()
+{
+  if (statisticsSeries)
+    statisticsSeries->finish(nCycles);
+}
+
+void
+Processor::enableTrace(const std::string &filename)
+{
+  fastForward = false;
+  trace = std::make_unique<TraceWriter>(filename);
+}
+
+void
+Processor::closeTrace()
+{
+  if (trace)
+    trace->close();
+}
+
+void
+Processor::enableTimingSweep(const std::string &filename)
+{
+  fastForward = false;
+  timingSweep = std::make_unique<TimingSweep>(loadTimingConfigs(filename));
+}
+
+void
+Processor::dumpTimingSweep()
+{
+  if (timingSweep)
+    writeTimingTable(std::cerr, timingSweep->getConfigs(),
+                     timingSweep->finish());
+}
+
+/* Interrupts are taken between clock cycles: the instructions that have
+ * not passed the execute stage are discarded and the PC is set to the
+ * exception vector. The tick timer takes priority over external
+ * interrupts.
+ */
+void
+Processor::checkInterrupts()
+{
+  MemAddress vector;
+
+  if (exceptions.tickTimerEnabled() && tickTimer->interruptPending())
+    vector = ExceptionUnit::TickTimerVector;
+  else if (exceptions.externalInterruptsEnabled() && pic->interruptPending())
+    vector = ExceptionUnit::ExternalInterruptVector;
+  else
+    return;
+
+  if (! pipeline.canInterrupt())
+    return;
+
+  PC = exceptions.enter(vector, pipeline.squash(PC));
+  ++nInterrupts;
+  idleLoop.reset();
+  idleSnapshotValid = false;
+}
+
+/* The l.nop region of interest markers, see sys-status.h. The l.nop
+ * has retired, so r3 holds the value written by the instructions
+ * before it.
+ */
+void
+Processor::observeRegionMarker(const RetiredInstruction &retired)
+{
+  static constexpr uint32_t NopOpcode = 0x05;
+  static constexpr RegNumber RegionIDRegister = 3;
+
+  if ((retired.instructionWord >> 26) != NopOpcode)
+    return;
+
+  const uint16_t immediate = retired.instructionWord & 0xffff;
+  if (immediate == SysStatus::RegionBeginHint)
+    sysStatus->beginRegion(regfile.readRegister(RegionIDRegister));
+  else if (immediate == SysStatus::RegionEndHint)
+    sysStatus->endRegion(regfile.readRegister(RegionIDRegister));
+}
+
+/* Once a loop is idle, its state at the end of every iteration is the
+ * same. Another iteration is executed to measure its cost, after which
+ * simulated time is advanced by whole iterations.
+ */
+void
+Processor::observeIdleLoop(const RetiredInstruction &retired)
+{
+  switch (idleLoop.retire(retired, nCycles))
+    {
+      case IdleLoopDetector::Event::None:
+        break;
+
+      case IdleLoopDetector::Event::Iteration:
+        idleSnapshotValid = false;
+        break;
+
+      case IdleLoopDetector::Event::SteadyIteration:
+        if (! idleSnapshotValid)
+          {
+            idleSnapshot = takeIdleLoopSnapshot();
+            idleSnapshotValid = true;
+          }
+        else
+          {
+            skipIdleIterations(idleSnapshot, takeIdleLoopSnapshot());
+            idleLoop.reset();
+            idleSnapshotValid = false;
+          }
+        break;
+    }
+}
+
+Processor::IdleLoopSnapshot
+Processor::takeIdleLoopSnapshot() const
+{
+  return IdleLoopSnapshot{ nCycles, pipeline.getCounters(),
+                           bus.getBytesRead(), bus.getBytesWritten() };
+}
+
+/* Skips as many iterations as possible without passing a device event
+ * or a cycle at which the cycle counter is observed. The number of
+ * skipped cycles is a multiple of the bus clock period, so that the bus
+ * clock cycles line up.
+ */
+void
+Processor::skipIdleIterations(const IdleLoopSnapshot &from,
+                              const IdleLoopSnapshot &to)
+{
+  constexpr uint64_t BusClockPeriod = 5;
+  constexpr uint64_t MaxSkipCycles = uint64_t(1) << 32;
+
+  const uint64_t iterationCycles = to.cycles - from.cycles;
+  if (iterationCycles == 0)
+    return;
+
+  /* Cycles that can be skipped: the next event and observation must
+   * take place after the skip.
+   */
+  uint64_t limit = MaxSkipCycles;
+  auto before = [&](uint64_t cycle)
+    {
+      limit = std::min(limit, cycle > nCycles ? cycle - nCycles - 1 : 0);
+    };
+
+  before(scheduler.getNextEventCycle());
+  if (profiler)
+    before(nextProfileSample);
+  if (statisticsSeries)
+    before(statisticsSeries->getNextSample());
+
+  const uint64_t busIdle = bus.getIdleCycles();
+  if (busIdle < limit / BusClockPeriod)
+    limit = busIdle * BusClockPeriod;
+
+  const uint64_t step = iterationCycles * BusClockPeriod /
+      std::gcd(iterationCycles, BusClockPeriod);
+  const uint64_t iterations = limit / step * (step / iterationCycles);
+  if (iterations == 0)
+    return;
+
+  const uint64_t cycles = iterations * iterationCycles;
+  nCycles += cycles;
+  pipeline.repeat(from.pipeline, to.pipeline, iterations);
+  bus.addTraffic((to.bytesRead - from.bytesRead) * iterations,
+                 (to.bytesWritten - from.bytesWritten) * iterations);
+  bus.skipCycles(cycles / BusClockPeriod);
+
+  ++nIdleSkips;
+  nIdleCyclesSkipped += cycles;
+}
+
+TraceRecord
+Processor::makeTraceRecord(const RetiredInstruction &retired)
+{
+  TraceRecord record;
+
+  record.PC = retired.PC;
+  record.instructionWord = retired.instructionWord;
+  record.writesRegister = retired.writesRegister;
+  record.rd = retired.rd;
+  record.value = retired.value;
+  record.accessesMemory = retired.accessesMemory;
+  record.memoryWrite = retired.memoryWrite;
+  record.memAddress = retired.memAddress;
+  record.memData = retired.memData;
+
+  return record;
+}
+
+#ifdef ENABLE_HOST_PROFILE
+void
+Processor::dumpHostProfile() const
+{
+  hostProfile.dump(std::cerr, nCycles, pipeline.getInstrCompleted());
+}
+#endif
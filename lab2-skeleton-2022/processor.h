@@ -10,9 +10,25 @@
 
 #include "arch.h"
 
+#include "block-device.h"
+#include "call-graph.h"
 #include "elf-file.h"
+#include "event-scheduler.h"
+#include "exception-unit.h"
+#include "headless-framebuffer.h"
+#include "idle-loop.h"
+#include "interrupt-controller.h"
 #include "pipeline.h"
+#include "profiler.h"
+#include "serial.h"
+#include "statistics.h"
+#include "symbol-table.h"
 #include "sys-status.h"
+#include "tick-timer.h"
+#include "timing-sweep.h"
+#include "trace.h"
+
+#include <memory>
 
 
 class Processor
@@ -27,22 +43,105 @@ class Processor
     void initRegister(RegNumber regnum, RegValue value);
     RegValue getRegister(RegNumber regnum) const;
 
+    /* Redirect the serial interface, empty filenames are ignored */
+    void configureSerial(const std::string &output, const std::string &input);
+
+    /* Add a block storage device backed by the disk image in "config" */
+    void attachBlockDevice(const BlockDeviceConfig &config);
+
+    /* Add a framebuffer that writes its frames to a file instead of
+     * a window.
+     */
+    void attachHeadlessFramebuffer(const HeadlessFramebufferConfig &config);
+
     /* Instruction execution steps */
     bool run(bool testMode=false);
 
+    /* Simulate idle loops cycle by cycle, to compare against the
+     * fast-forwarded run.
+     */
+    void disableFastForward() { fastForward = false; }
+
     /* Debugging and statistics */
     void dumpRegisters() const;
     void dumpStatistics() const;
+    void dumpInstructionMix() const;
+
+    /* Sample the committed PC every "interval" cycles */
+    void enableProfiler(uint64_t interval);
+    void dumpProfile(const std::string &collapsedFilename) const;
+
+    /* Track calls and returns to build a call graph profile */
+    void enableCallGraph();
+    void writeCallGraph(const std::string &filename,
+                        const std::string &command) const;
+
+    /* Machine-readable statistics, written as JSON or CSV */
+    void writeStatistics(const std::string &filename) const;
+    void enableStatisticsSeries(uint64_t interval,
+                                const std::string &filename);
+    void finishStatisticsSeries();
+
+    /* Binary trace of the retired instructions */
+    void enableTrace(const std::string &filename);
+    void closeTrace();
+
+    /* Evaluate the timing configurations in "filename" on the stream
+     * of retired instructions.
+     */
+    void enableTimingSweep(const std::string &filename);
+    void dumpTimingSweep();
+
+#ifdef ENABLE_HOST_PROFILE
+    /* Host time per simulator component, simulated MIPS */
+    void dumpHostProfile() const;
+#endif
 
   private:
     /* Statistics */
     uint64_t nCycles{};
+    uint64_t nInterrupts{};
+    uint64_t nIdleSkips{};
+    uint64_t nIdleCyclesSkipped{};
+
+    SymbolTable symbols;
+    std::unique_ptr<SamplingProfiler> profiler{};
+    uint64_t nextProfileSample{};
+    std::unique_ptr<CallGraphProfiler> callGraph{};
+    uint64_t nInstrObserved{};
+
+    StatisticsRegistry statistics{};
+    std::unique_ptr<StatisticsSeries> statisticsSeries{};
+
+    std::unique_ptr<TraceWriter> trace{};
+    std::unique_ptr<TimingSweep> timingSweep{};
+
+    /* Idle loops are fast-forwarded unless every instruction must be
+     * observed, such as in debug mode or when tracing.
+     */
+    struct IdleLoopSnapshot
+    {
+      uint64_t cycles{};
+      Pipeline::Counters pipeline{};
+      uint64_t bytesRead{};
+      uint64_t bytesWritten{};
+    };
+
+    bool fastForward;
+    IdleLoopDetector idleLoop{ bus };
+    IdleLoopSnapshot idleSnapshot{};
+    bool idleSnapshotValid{};
 
     /* Components shared by multiple stages or components. */
     RegisterFile regfile{};
     bool flag{};
+    FPU fpu{};
+    ExceptionUnit exceptions{ flag, fpu };
     InstructionDecoder decoder{};
 
+    /* Device events, such as timer deadlines, in cycles */
+    EventScheduler scheduler{};
+
     MemoryBus bus;
     InstructionMemory instructionMemory;
     DataMemory dataMemory;
@@ -53,6 +152,18 @@ class Processor
 
     /* Memory bus clients */
     SysStatus *sysStatus{};  /* no ownership */
+    Serial *serial{};  /* no ownership */
+    InterruptController *pic{};  /* no ownership */
+    TickTimer *tickTimer{};  /* no ownership */
+
+    void checkInterrupts();
+    void observeRegionMarker(const RetiredInstruction &retired);
+    void observeIdleLoop(const RetiredInstruction &retired);
+    IdleLoopSnapshot takeIdleLoopSnapshot() const;
+    void skipIdleIterations(const IdleLoopSnapshot &from,
+                            const IdleLoopSnapshot &to);
+
+    static TraceRecord makeTraceRecord(const RetiredInstruction &retired);
 };
 
 #endif /* __PROCESSOR_H__ */
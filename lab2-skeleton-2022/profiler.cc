@@ -0,0 +1,86 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    profiler.cc - Sampling profiler for guest programs.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+SamplingProfiler::SamplingProfiler(const SymbolTable &symbols,
+                                   uint64_t interval)
+  : symbols{ symbols }, interval{ interval }
+{
+  if (interval == 0)
+    throw std::out_of_range("profiler sampling interval must be non-zero");
+}
+
+void
+SamplingProfiler::sample(MemAddress PC, uint64_t nInstrCompleted,
+                         const std::string &callers)
+{
+  const std::string &name = symbols.getName(PC);
+  auto &stats = functions[name];
+
+  ++stats.samples;
+  ++stacks[callers + name];
+  stats.instructions += nInstrCompleted - lastInstrCompleted;
+
+  lastInstrCompleted = nInstrCompleted;
+  ++totalSamples;
+}
+
+void
+SamplingProfiler::dump(std::ostream &os) const
+{
+  using Entry = std::pair<std::string, FunctionStats>;
+  std::vector<Entry> sorted(functions.begin(), functions.end());
+
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Entry &a, const Entry &b)
+            {
+              return a.second.samples > b.second.samples;
+            });
+
+  auto storeFlags(os.flags());
+
+  os << "Flat profile (" << totalSamples << " samples, one sample every "
+     << interval << " cycles):" << std::endl;
+  os << std::setw(8) << "%time" << std::setw(14) << "cycles"
+     << std::setw(14) << "instructions" << std::setw(8) << "CPI"
+     << "  function" << std::endl;
+
+  for (const auto & [name, stats] : sorted)
+    {
+      const uint64_t cycles = stats.samples * interval;
+
+      os << std::fixed << std::setprecision(2)
+         << std::setw(7) << 100.0 * stats.samples / totalSamples << "%"
+         << std::setw(14) << cycles
+         << std::setw(14) << stats.instructions
+         << std::setw(8);
+      if (stats.instructions)
+        os << static_cast<double>(cycles) / stats.instructions;
+      else
+        os << "-";
+      os << "  " << name << std::endl;
+    }
+
+  os.flags(storeFlags);
+}
+
+void
+SamplingProfiler::writeCollapsed(const std::string &filename) const
+{
+  std::ofstream file{ filename };
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  for (const auto & [stack, samples] : stacks)
+    file << stack << ' ' << samples * interval << '\n';
+}
@@ -0,0 +1,67 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    profiler.h - Sampling profiler for guest programs.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "symbol-table.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+
+/* The sampling profiler is handed the committed PC every "interval"
+ * clock cycles. Each sample accounts "interval" cycles, and the
+ * instructions completed since the previous sample, to the function
+ * containing the sampled PC.
+ */
+class SamplingProfiler
+{
+  public:
+    SamplingProfiler(const SymbolTable &symbols, uint64_t interval);
+
+    SamplingProfiler(const SamplingProfiler &) = delete;
+    SamplingProfiler &operator=(const SamplingProfiler &) = delete;
+
+    uint64_t getInterval() const { return interval; }
+
+    /* "callers" is the call stack leading to the sampled function in
+     * collapsed stack format (see CallGraphProfiler::getCallers()), or
+     * empty when it is not tracked.
+     */
+    void sample(MemAddress PC, uint64_t nInstrCompleted,
+                const std::string &callers = {});
+
+    /* Flat profile: cycles, instructions and CPI per function. */
+    void dump(std::ostream &os) const;
+
+    /* Write samples in "collapsed stack" format, suitable as input
+     * for flame graph tools: one line per distinct call stack with
+     * the cycles sampled in it.
+     */
+    void writeCollapsed(const std::string &filename) const;
+
+  private:
+    struct FunctionStats
+    {
+      uint64_t samples{};
+      uint64_t instructions{};
+    };
+
+    const SymbolTable &symbols;
+    const uint64_t interval;
+
+    uint64_t lastInstrCompleted{};
+    uint64_t totalSamples{};
+
+    std::map<std::string, FunctionStats> functions{};
+
+    /* Samples per call stack, "caller;...;callee" */
+    std::map<std::string, uint64_t> stacks{};
+};
+
+#endif /* __PROFILER_H__ */
@@ -0,0 +1,70 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    ring-buffer.h - Lock-free single-producer single-consumer queue.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/* A bounded queue between exactly one producer thread and one consumer
+ * thread. The head is only written by the consumer and the tail only
+ * by the producer, so no locks are needed. Both are kept on separate
+ * cache lines to avoid false sharing. Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class RingBuffer
+{
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+  public:
+    RingBuffer() = default;
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /* Producer side, returns false when the buffer is full. */
+    bool tryPush(const T &item)
+    {
+      const size_t t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) == Capacity)
+        return false;
+
+      items[t & (Capacity - 1)] = item;
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    /* Consumer side, returns false when the buffer is empty. */
+    bool tryPop(T &item)
+    {
+      const size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire))
+        return false;
+
+      item = items[h & (Capacity - 1)];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool empty() const
+    {
+      return head.load(std::memory_order_acquire) ==
+          tail.load(std::memory_order_acquire);
+    }
+
+  private:
+    static constexpr size_t CacheLineSize = 64;
+
+    alignas(CacheLineSize) std::atomic<size_t> head{ 0 };
+    alignas(CacheLineSize) std::atomic<size_t> tail{ 0 };
+    alignas(CacheLineSize) std::array<T, Capacity> items{};
+};
+
+#endif /* __RING_BUFFER_H__ */
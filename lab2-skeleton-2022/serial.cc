@@ -1,17 +1,74 @@
 /* rv64-emu -- Simple 64-bit RISC-V simulator
  *
- *    serial.cc - Dumb write-only serial interface.
+ *    serial.cc - Buffered serial interface.
  *
  * Copyright (C) 2016  Leiden University, The Netherlands.
  */
 
 #include "serial.h"
+#include "statistics.h"
 
-#include <iostream>
+#include <iterator>
 
 Serial::Serial(const MemAddress base)
   : base{ base }
 {
+  outputBuffer.reserve(BufferSize);
+}
+
+Serial::~Serial()
+{
+  flush();
+}
+
+void
+Serial::setOutput(const std::string &filename)
+{
+  flush();
+
+  if (filename == "-")
+    {
+      output = &std::cout;
+      return;
+    }
+
+  outputFile.open(filename, std::ios::binary);
+  if (!outputFile.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  output = &outputFile;
+}
+
+void
+Serial::setInput(const std::string &filename)
+{
+  hasInput = true;
+  inputData.clear();
+  inputPosition = 0;
+
+  if (filename == "-")
+    {
+      inputFromStdin = true;
+      return;
+    }
+
+  std::ifstream file{ filename, std::ios::binary };
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  inputData.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+}
+
+void
+Serial::flush()
+{
+  if (outputBuffer.empty())
+    return;
+
+  output->write(outputBuffer.data(), outputBuffer.size());
+  output->flush();
+  outputBuffer.clear();
 }
 
 /*
@@ -21,7 +78,16 @@ Serial::Serial(const MemAddress base)
 uint8_t
 Serial::readByte(MemAddress addr)
 {
-  throw IllegalAccess("Not supported on serial interface");
+  if (addr == base + StatusOffset)
+    return readStatus();
+  else if (addr != base + DataOffset)
+    throw IllegalAccess("Invalid address");
+
+  if (! inputAvailable())
+    return 0;
+
+  ++bytesRead;
+  return inputData[inputPosition++];
 }
 
 uint16_t
@@ -46,10 +112,13 @@ Serial::readDoubleWord(MemAddress addr)
 void
 Serial::writeByte(MemAddress addr, uint8_t value)
 {
-  if (addr != base)
+  if (addr != base + DataOffset)
     throw IllegalAccess("Invalid address");
 
-  std::cerr << static_cast<char>(value);
+  ++bytesWritten;
+  outputBuffer.push_back(static_cast<char>(value));
+  if (value == '\n' || outputBuffer.size() >= BufferSize)
+    flush();
 }
 
 void
@@ -73,5 +142,55 @@ Serial::writeDoubleWord(MemAddress addr, uint64_t value)
 bool
 Serial::contains(MemAddress addr) const
 {
-  return base <= addr && addr < base + 1;
+  return base <= addr && addr < base + EndOffset;
+}
+
+void
+Serial::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("serial.bytes_written",
+                      "Characters written to the serial interface",
+                      &bytesWritten);
+  registry.addCounter("serial.bytes_read",
+                      "Characters read from the serial interface",
+                      &bytesRead);
+}
+
+/*
+ * Private methods
+ */
+
+bool
+Serial::inputAvailable()
+{
+  if (inputPosition < inputData.size())
+    return true;
+
+  if (inputFromStdin && std::cin.good())
+    {
+      /* Flush pending output first, it may contain a prompt. */
+      flush();
+
+      const int c = std::cin.get();
+      if (c != std::char_traits<char>::eof())
+        {
+          inputData.push_back(c);
+          return true;
+        }
+    }
+
+  return false;
+}
+
+uint8_t
+Serial::readStatus()
+{
+  uint8_t status = StatusOutputReady;
+
+  if (inputAvailable())
+    status |= StatusInputAvailable;
+  else if (hasInput)
+    status |= StatusEndOfInput;
+
+  return status;
 }
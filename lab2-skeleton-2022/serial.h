@@ -1,6 +1,6 @@
 /* rv64-emu -- Simple 64-bit RISC-V simulator
  *
- *    serial.h - Dumb write-only serial interface.
+ *    serial.h - Buffered serial interface.
  *
  * Copyright (C) 2016  Leiden University, The Netherlands.
  */
@@ -10,11 +10,37 @@
 
 #include "memory-interface.h"
 
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Register map (offsets relative to base):
+ *   0x00 - data register (byte). Writing outputs a character, reading
+ *          returns the next input character or 0 if there is none.
+ *   0x01 - status register (byte, read-only)
+ *            bit 0: input character available
+ *            bit 1: end of input reached
+ *            bit 2: ready to accept output (always set)
+ *
+ * Output is buffered and written to the output sink on a newline, when
+ * the buffer is full and when flush() is called, e.g. at system halt.
+ * By default output goes to standard error, it can be redirected to
+ * standard output ("-") or a file, which may also be a named pipe.
+ * Input is read from standard input ("-") or a file. Input files are
+ * read entirely up front, such that host I/O does not interfere with
+ * the run of the guest program.
+ */
 class Serial : public MemoryInterface
 {
   public:
     Serial(const MemAddress base);
-    ~Serial() override = default;
+    ~Serial() override;
+
+    void setOutput(const std::string &filename);
+    void setInput(const std::string &filename);
+
+    void flush();
 
     /* MemoryInterface */
     uint8_t readByte(MemAddress addr) override;
@@ -29,8 +55,47 @@ class Serial : public MemoryInterface
 
     bool contains(MemAddress addr) const override;
 
+    /* Reading the data register consumes an input character */
+    bool hasReadSideEffects(MemAddress addr) const override
+    {
+      return addr == base + DataOffset;
+    }
+
+    void registerStatistics(StatisticsRegistry &registry) override;
+
+    Serial(const Serial &) = delete;
+    Serial &operator=(const Serial &) = delete;
+
   private:
+    static constexpr MemAddress DataOffset = 0x0;
+    static constexpr MemAddress StatusOffset = 0x1;
+    static constexpr MemAddress EndOffset = 0x2;
+
+    static constexpr uint8_t StatusInputAvailable = 1 << 0;
+    static constexpr uint8_t StatusEndOfInput = 1 << 1;
+    static constexpr uint8_t StatusOutputReady = 1 << 2;
+
+    static constexpr size_t BufferSize = 4096;
+
     const MemAddress base;
+
+    std::ostream *output{ &std::cerr };
+    std::ofstream outputFile{};
+    std::string outputBuffer{};
+
+    /* Input from a file is stored in inputData, input from standard
+     * input is appended one character at a time when needed.
+     */
+    bool hasInput = false;
+    bool inputFromStdin = false;
+    std::vector<uint8_t> inputData{};
+    size_t inputPosition{};
+
+    uint64_t bytesWritten{};
+    uint64_t bytesRead{};
+
+    bool inputAvailable();
+    uint8_t readStatus();
 };
 
 #endif /* __SERIAL_H__ */
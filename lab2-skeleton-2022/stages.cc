@@ -9,6 +9,11 @@
 
 #include <iostream>
 
+/* Instructions that access the exception unit */
+static constexpr uint32_t ReturnFromExceptionOpcode = 0x09;
+static constexpr uint32_t MoveFromSPROpcode = 0x2d;
+static constexpr uint32_t MoveToSPROpcode = 0x30;
+
 /*
  * Instruction fetch
  */
@@ -41,6 +46,7 @@ InstructionFetchStage::clockPulse()
 {
   /* TODO: write necessary fields in pipeline register */
   if_id.PC = PC;
+  if_id.instructionWord = instructionWord;
 }
 
 /*
@@ -54,13 +60,19 @@ dump_instruction(std::ostream &os, const uint32_t instructionWord,
 void
 InstructionDecodeStage::propagate()
 {
-  /* TODO: set instruction word on the instruction decoder */
-
   /* TODO: need a control signals class that generates control
    * signals from a given opcode and function code.
    */
 
   PC = if_id.PC;
+  instructionWord = if_id.instructionWord;
+  decoder.setInstructionWord(instructionWord);
+
+  /* Register fetch */
+  regfile.setRS1(decoder.getA());
+  regfile.setRS2(decoder.getB());
+  valueA = regfile.getReadData1();
+  valueB = regfile.getReadData2();
 
 
   /* debug mode: dump decoded instructions to cerr.
@@ -81,18 +93,34 @@ InstructionDecodeStage::propagate()
       std::cerr << decoder << std::endl;
     }
 
-  /* TODO: register fetch and other matters */
   /* TODO: perhaps also determine and write the new PC here? */
 }
 
 void InstructionDecodeStage::clockPulse()
 {
+  /* The stalled instruction stays in decode, the bubble sent to
+   * execute records it as the cause of the stall.
+   */
+  if (stalled)
+    {
+      ++nStalls;
+      id_ex = ID_EXRegisters{};
+      id_ex.stallPC = PC;
+      id_ex.stallInstructionWord = instructionWord;
+      return;
+    }
+
   /* ignore the "instruction" in the first cycle. */
   if (! pipelining || (pipelining && PC != 0x0))
     ++nInstrIssued;
 
   /* TODO: write necessary fields in pipeline register */
   id_ex.PC = PC;
+  id_ex.instructionWord = instructionWord;
+  id_ex.stallPC = 0;
+  id_ex.stallInstructionWord = 0;
+  id_ex.valueA = valueA;
+  id_ex.valueB = valueB;
 }
 
 /*
@@ -105,9 +133,33 @@ ExecuteStage::propagate()
   /* TODO configure ALU based on control signals and using inputs
    * from pipeline register.
    * Consider using the Mux class.
+   *
+   * TODO: vector instructions (lv.*) use the ALU operation
+   * getVectorALUOp(decoder.getFunction()). Floating-point instructions
+   * (lf.*) are executed by fpu.execute(getFPUOp(decoder.getFunction()),
+   * ...), a pending FP exception enters ExceptionUnit::FloatingPointVector.
    */
 
   PC = id_ex.PC;
+  instructionWord = id_ex.instructionWord;
+  stallPC = id_ex.stallPC;
+  stallInstructionWord = id_ex.stallInstructionWord;
+
+  /* The special-purpose register is accessed at write back, here only
+   * its number (rA | K) is computed.
+   */
+  const uint32_t major = instructionWord >> 26;
+  if (major == MoveFromSPROpcode || major == MoveToSPROpcode)
+    {
+      decoder.setInstructionWord(instructionWord);
+      spr = id_ex.valueA | decoder.getSPRImmediate();
+      sprValue = id_ex.valueB;
+    }
+  else
+    {
+      spr = 0;
+      sprValue = 0;
+    }
 }
 
 void
@@ -119,6 +171,11 @@ ExecuteStage::clockPulse()
    */
 
   ex_m.PC = PC;
+  ex_m.instructionWord = instructionWord;
+  ex_m.stallPC = stallPC;
+  ex_m.stallInstructionWord = stallInstructionWord;
+  ex_m.spr = spr;
+  ex_m.sprValue = sprValue;
 }
 
 /*
@@ -133,6 +190,11 @@ MemoryStage::propagate()
    */
 
   PC = ex_m.PC;
+  instructionWord = ex_m.instructionWord;
+  stallPC = ex_m.stallPC;
+  stallInstructionWord = ex_m.stallInstructionWord;
+  spr = ex_m.spr;
+  sprValue = ex_m.sprValue;
 }
 
 void
@@ -143,6 +205,11 @@ MemoryStage::clockPulse()
   /* TODO: write necessary fields in pipeline register */
 
   m_wb.PC = PC;
+  m_wb.instructionWord = instructionWord;
+  m_wb.stallPC = stallPC;
+  m_wb.stallInstructionWord = stallInstructionWord;
+  m_wb.spr = spr;
+  m_wb.sprValue = sprValue;
 }
 
 /*
@@ -152,8 +219,53 @@ MemoryStage::clockPulse()
 void
 WriteBackStage::propagate()
 {
+  regfile.setWriteEnable(false);
+
   if (! pipelining || (pipelining && m_wb.PC != 0x0))
-    ++nInstrCompleted;
+    {
+      retired = RetiredInstruction{ m_wb.PC, m_wb.instructionWord };
+
+      switch (m_wb.instructionWord >> 26)
+        {
+          case ReturnFromExceptionOpcode:
+            /* Like a jump without delay slot */
+            redirect.valid = true;
+            redirect.target = exceptions.returnFromException();
+            break;
+
+          case MoveFromSPROpcode:
+            decoder.setInstructionWord(m_wb.instructionWord);
+            retired.writesRegister = true;
+            retired.rd = decoder.getD();
+            retired.value = exceptions.readSPR(m_wb.spr);
+
+            regfile.setRD(retired.rd);
+            regfile.setWriteData(retired.value);
+            regfile.setWriteEnable(true);
+            break;
+
+          case MoveToSPROpcode:
+            exceptions.writeSPR(m_wb.spr, m_wb.sprValue);
+            break;
+
+          default:
+            break;
+        }
+
+      ++nInstrCompleted;
+      profile.retire(m_wb.instructionWord, flag);
+      /* TODO: record the register write and the data memory access of
+       * the instruction in "retired", these are included in the
+       * execution trace.
+       */
+    }
+  else if (m_wb.stallPC != 0x0)
+    {
+      /* A bubble inserted by a stall, charged to the instruction that
+       * stalled rather than to the next one to retire.
+       */
+      profile.stall(m_wb.stallInstructionWord);
+    }
 
   /* TODO: configure write lines of register file based on control
    * signals
@@ -163,5 +275,5 @@ WriteBackStage::propagate()
 void
 WriteBackStage::clockPulse()
 {
-  /* TODO: pulse the register file */
+  regfile.clockPulse();
 }
@@ -10,7 +10,9 @@
 
 #include "alu.h"
 #include "mux.h"
+#include "exception-unit.h"
 #include "inst-decoder.h"
+#include "inst-profile.h"
 #include "memory-control.h"
 
 
@@ -25,6 +27,7 @@
 struct IF_IDRegisters
 {
   MemAddress PC = 0;
+  uint32_t instructionWord{};
 
   /* TODO: add necessary fields */
 };
@@ -32,6 +35,17 @@ struct IF_IDRegisters
 struct ID_EXRegisters
 {
   MemAddress PC{};
+  uint32_t instructionWord{};
+
+  /* Set in a bubble inserted because the instruction at stallPC
+   * stalled, such that the stall cycle is charged to that instruction.
+   */
+  MemAddress stallPC{};
+  uint32_t stallInstructionWord{};
+
+  /* Register operands rA and rB */
+  RegValue valueA{};
+  RegValue valueB{};
 
   /* TODO: add necessary fields */
 };
@@ -39,6 +53,17 @@ struct ID_EXRegisters
 struct EX_MRegisters
 {
   MemAddress PC{};
+  uint32_t instructionWord{};
+
+  /* Stall cause of a bubble, see ID_EXRegisters */
+  MemAddress stallPC{};
+  uint32_t stallInstructionWord{};
+
+  /* Special-purpose register accessed by l.mfspr and l.mtspr, and the
+   * value written by l.mtspr (rB).
+   */
+  uint16_t spr{};
+  RegValue sprValue{};
 
   /* TODO: add necessary fields */
 };
@@ -46,11 +71,53 @@ struct EX_MRegisters
 struct M_WBRegisters
 {
   MemAddress PC{};
+  uint32_t instructionWord{};
+
+  /* Stall cause of a bubble, see ID_EXRegisters */
+  MemAddress stallPC{};
+  uint32_t stallInstructionWord{};
+
+  /* See EX_MRegisters */
+  uint16_t spr{};
+  RegValue sprValue{};
 
   /* TODO: add necessary fields */
 };
 
 
+/* Set by the write back stage when an instruction that commits changes
+ * the flow of control (l.rfe). The younger instructions in the pipeline
+ * are then discarded and fetch continues at "target".
+ */
+struct CommitRedirect
+{
+  bool valid{};
+  MemAddress target{};
+};
+
+
+/* The most recently retired instruction, as recorded by the write back
+ * stage. This is not a pipeline register, but is used to observe the
+ * stream of retired instructions, e.g. for profiling.
+ */
+struct RetiredInstruction
+{
+  MemAddress PC{};
+  uint32_t instructionWord{};
+
+  /* Register write performed by the instruction, if any */
+  bool writesRegister{};
+  RegNumber rd{};
+  RegValue value{};
+
+  /* Data memory access performed by the instruction, if any */
+  bool accessesMemory{};
+  bool memoryWrite{};
+  MemAddress memAddress{};
+  RegValue memData{};
+};
+
+
 /*
  * Abstract base class for pipeline stage
  */
@@ -137,6 +204,8 @@ class InstructionFetchStage : public Stage
 
     InstructionMemory instructionMemory;
     MemAddress &PC;
+
+    uint32_t instructionWord{};
 };
 
 /*
@@ -164,6 +233,15 @@ class InstructionDecodeStage : public Stage
     void propagate() override;
     void clockPulse() override;
 
+    /* Hook for the hazard detection, which is not part of this
+     * skeleton: it must call setStalled(true) after propagate when the
+     * instruction in decode has to wait (and keep IF from advancing).
+     * clockPulse then sends a bubble to execute that records the
+     * stalled instruction, so that the cycle is charged to it in the
+     * instruction profile when the bubble reaches write back.
+     */
+    void setStalled(bool stalled) { this->stalled = stalled; }
+
   private:
     const IF_IDRegisters &if_id;
     ID_EXRegisters &id_ex;
@@ -177,6 +255,13 @@ class InstructionDecodeStage : public Stage
     bool debugMode;
 
     MemAddress PC{};
+    uint32_t instructionWord{};
+
+    RegValue valueA{};
+    RegValue valueB{};
+
+    /* See setStalled() */
+    bool stalled{};
     /* TODO: add other necessary fields/buffers. */
 };
 
@@ -189,9 +274,10 @@ class ExecuteStage : public Stage
   public:
     ExecuteStage(bool pipelining,
                  const ID_EXRegisters &id_ex,
-                 EX_MRegisters &ex_m)
+                 EX_MRegisters &ex_m,
+                 FPU &fpu)
       : Stage(pipelining),
-      id_ex(id_ex), ex_m(ex_m)
+      id_ex(id_ex), ex_m(ex_m), fpu(fpu)
     { }
 
     void propagate() override;
@@ -201,7 +287,16 @@ class ExecuteStage : public Stage
     const ID_EXRegisters &id_ex;
     EX_MRegisters &ex_m;
 
+    FPU &fpu;
+
+    InstructionDecoder decoder{};
+
     MemAddress PC{};
+    uint32_t instructionWord{};
+    MemAddress stallPC{};
+    uint32_t stallInstructionWord{};
+    uint16_t spr{};
+    RegValue sprValue{};
     /* TODO: add other necessary fields/buffers and components (ALU anyone?) */
 };
 
@@ -230,6 +325,11 @@ class MemoryStage : public Stage
     DataMemory dataMemory;
 
     MemAddress PC{};
+    uint32_t instructionWord{};
+    MemAddress stallPC{};
+    uint32_t stallInstructionWord{};
+    uint16_t spr{};
+    RegValue sprValue{};
     /* TODO: add other necessary fields/buffers */
 };
 
@@ -244,10 +344,16 @@ class WriteBackStage : public Stage
                    const M_WBRegisters &m_wb,
                    RegisterFile &regfile,
                    bool &flag,
-                   uint64_t &nInstrCompleted)
+                   ExceptionUnit &exceptions,
+                   CommitRedirect &redirect,
+                   uint64_t &nInstrCompleted,
+                   InstructionProfile &profile,
+                   RetiredInstruction &retired)
       : Stage(pipelining),
       m_wb(m_wb), regfile(regfile), flag(flag),
-      nInstrCompleted(nInstrCompleted)
+      exceptions(exceptions), redirect(redirect),
+      nInstrCompleted(nInstrCompleted), profile(profile),
+      retired(retired)
     { }
 
     void propagate() override;
@@ -259,9 +365,20 @@ class WriteBackStage : public Stage
     RegisterFile &regfile;
     bool &flag;
 
+    /* l.rfe, l.mfspr and l.mtspr take effect when they commit, such
+     * that instructions squashed on an interrupt have not modified the
+     * exception state.
+     */
+    ExceptionUnit &exceptions;
+    CommitRedirect &redirect;
+
+    InstructionDecoder decoder{};
+
     /* TODO add other necessary fields/buffers and components */
 
     uint64_t &nInstrCompleted;
+    InstructionProfile &profile;
+    RetiredInstruction &retired;
 };
 
 #endif /* __STAGES_H__ */
@@ -0,0 +1,271 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    statistics.cc - Registry of named statistics.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "statistics.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+/* Quotes a JSON string */
+static std::string
+quote(const std::string &s)
+{
+  std::string result{ "\"" };
+
+  for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        result += '\\';
+      result += c;
+    }
+
+  return result + "\"";
+}
+
+/* Quotes a CSV field, quotes within the field are doubled */
+static std::string
+quoteCSV(const std::string &s)
+{
+  std::string result{ "\"" };
+
+  for (char c : s)
+    {
+      if (c == '"')
+        result += '"';
+      result += c;
+    }
+
+  return result + "\"";
+}
+
+static void
+writeDouble(std::ostream &os, double value)
+{
+  auto storeFlags(os.flags());
+  os << std::fixed << std::setprecision(6) << value;
+  os.flags(storeFlags);
+}
+
+
+void
+StatisticsRegistry::addCounter(const std::string &name,
+                               const std::string &description,
+                               const uint64_t *value)
+{
+  counters.push_back(Counter{ name, description, value });
+}
+
+void
+StatisticsRegistry::addHistogram(const std::string &name,
+                                 const std::string &description,
+                                 const uint64_t *values,
+                                 const std::vector<std::string> &labels)
+{
+  histograms.push_back(Histogram{ name, description, values, labels });
+}
+
+void
+StatisticsRegistry::addRatio(const std::string &name,
+                             const std::string &description,
+                             const std::vector<std::string> &numerators,
+                             const std::vector<std::string> &denominators)
+{
+  Ratio ratio{ name, description, {}, {} };
+
+  for (const auto &counter : numerators)
+    ratio.numerators.push_back(findCounter(counter));
+  for (const auto &counter : denominators)
+    ratio.denominators.push_back(findCounter(counter));
+
+  ratios.push_back(std::move(ratio));
+}
+
+void
+StatisticsRegistry::writeJSON(std::ostream &os) const
+{
+  const auto values(getValues());
+  bool first = true;
+
+  auto separator = [&os, &first]()
+    {
+      os << (first ? "\n" : ",\n");
+      first = false;
+    };
+
+  os << "{";
+  for (size_t i = 0; i < counters.size(); ++i)
+    {
+      separator();
+      os << "  " << quote(counters[i].name) << ": " << values[i];
+    }
+
+  for (const auto &ratio : ratios)
+    {
+      separator();
+      os << "  " << quote(ratio.name) << ": ";
+      writeDouble(os, evaluate(ratio, values));
+    }
+
+  for (const auto &histogram : histograms)
+    {
+      separator();
+      os << "  " << quote(histogram.name) << ": {";
+      for (size_t i = 0; i < histogram.labels.size(); ++i)
+        os << (i ? ", " : " ") << quote(histogram.labels[i]) << ": "
+           << histogram.values[i];
+      os << " }";
+    }
+  os << "\n}" << std::endl;
+}
+
+void
+StatisticsRegistry::writeCSV(std::ostream &os) const
+{
+  const auto values(getValues());
+
+  os << "name,value,description" << std::endl;
+  for (size_t i = 0; i < counters.size(); ++i)
+    os << counters[i].name << "," << values[i] << ","
+       << quoteCSV(counters[i].description) << std::endl;
+
+  for (const auto &ratio : ratios)
+    {
+      os << ratio.name << ",";
+      writeDouble(os, evaluate(ratio, values));
+      os << "," << quoteCSV(ratio.description) << std::endl;
+    }
+
+  for (const auto &histogram : histograms)
+    for (size_t i = 0; i < histogram.labels.size(); ++i)
+      os << histogram.name << "." << histogram.labels[i] << ","
+         << histogram.values[i] << "," << quoteCSV(histogram.description)
+         << std::endl;
+}
+
+void
+StatisticsRegistry::write(const std::string &filename) const
+{
+  std::ofstream file{ filename };
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  const std::string csvExtension{ ".csv" };
+  if (filename.size() >= csvExtension.size() &&
+      filename.compare(filename.size() - csvExtension.size(),
+                       csvExtension.size(), csvExtension) == 0)
+    writeCSV(file);
+  else
+    writeJSON(file);
+}
+
+void
+StatisticsRegistry::writeSeriesHeader(std::ostream &os) const
+{
+  os << "cycle";
+  for (const auto &counter : counters)
+    os << "," << counter.name;
+  for (const auto &ratio : ratios)
+    os << "," << ratio.name;
+  os << std::endl;
+}
+
+void
+StatisticsRegistry::writeSeriesSample(std::ostream &os, uint64_t cycle)
+{
+  const auto values(getValues());
+  std::vector<uint64_t> deltas(values.size());
+
+  previous.resize(values.size());
+  for (size_t i = 0; i < values.size(); ++i)
+    deltas[i] = values[i] - previous[i];
+  previous = values;
+
+  os << cycle;
+  for (auto delta : deltas)
+    os << "," << delta;
+  for (const auto &ratio : ratios)
+    {
+      os << ",";
+      writeDouble(os, evaluate(ratio, deltas));
+    }
+  os << "\n";
+}
+
+/*
+ * Private methods
+ */
+
+size_t
+StatisticsRegistry::findCounter(const std::string &name) const
+{
+  auto it = std::find_if(counters.begin(), counters.end(),
+                         [&name](const Counter &counter)
+                         {
+                           return counter.name == name;
+                         });
+  if (it == counters.end())
+    throw std::out_of_range("unknown statistics counter " + name);
+
+  return it - counters.begin();
+}
+
+std::vector<uint64_t>
+StatisticsRegistry::getValues() const
+{
+  std::vector<uint64_t> values;
+  values.reserve(counters.size());
+
+  for (const auto &counter : counters)
+    values.push_back(*counter.value);
+
+  return values;
+}
+
+double
+StatisticsRegistry::evaluate(const Ratio &ratio,
+                             const std::vector<uint64_t> &values)
+{
+  uint64_t numerator{};
+  uint64_t denominator{};
+
+  for (auto i : ratio.numerators)
+    numerator += values[i];
+  for (auto i : ratio.denominators)
+    denominator += values[i];
+
+  if (denominator == 0)
+    return 0.0;
+
+  return static_cast<double>(numerator) / denominator;
+}
+
+
+StatisticsSeries::StatisticsSeries(StatisticsRegistry &registry,
+                                   const std::string &filename,
+                                   uint64_t interval)
+  : registry{ registry }, file{ filename }, interval{ interval },
+    nextSample{ interval }
+{
+  if (!file.good())
+    throw std::runtime_error("cannot open file " + filename);
+  if (interval == 0)
+    throw std::out_of_range("statistics interval must be non-zero");
+
+  registry.writeSeriesHeader(file);
+}
+
+void
+StatisticsSeries::finish(uint64_t cycle)
+{
+  if (cycle > lastSample)
+    {
+      registry.writeSeriesSample(file, cycle);
+      lastSample = cycle;
+    }
+  file.flush();
+}
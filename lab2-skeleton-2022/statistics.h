@@ -0,0 +1,140 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    statistics.h - Registry of named statistics.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __STATISTICS_H__
+#define __STATISTICS_H__
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Components register their statistics by name with the registry. The
+ * registry only stores pointers to the counters, so registered
+ * components must outlive the registry's use. Three kinds of
+ * statistics are supported:
+ *
+ * - counters: a single 64-bit counter.
+ * - histograms: an array of 64-bit counters, one per labeled bucket.
+ * - ratios: the sum of a number of counters divided by the sum of
+ *   other counters, e.g. IPC or bytes per instruction.
+ *
+ * The statistics can be written as JSON or CSV. Additionally, a time
+ * series of the counters and ratios can be recorded at an interval.
+ */
+class StatisticsRegistry
+{
+  public:
+    void addCounter(const std::string &name,
+                    const std::string &description,
+                    const uint64_t *value);
+
+    void addHistogram(const std::string &name,
+                      const std::string &description,
+                      const uint64_t *values,
+                      const std::vector<std::string> &labels);
+
+    void addRatio(const std::string &name,
+                  const std::string &description,
+                  const std::vector<std::string> &numerators,
+                  const std::vector<std::string> &denominators);
+
+    void writeJSON(std::ostream &os) const;
+    void writeCSV(std::ostream &os) const;
+
+    /* Writes JSON, or CSV when the filename ends with ".csv". */
+    void write(const std::string &filename) const;
+
+    /* Time series: the header names the columns, every sample writes
+     * a row with the counters and ratios computed over the interval
+     * since the previous sample.
+     */
+    void writeSeriesHeader(std::ostream &os) const;
+    void writeSeriesSample(std::ostream &os, uint64_t cycle);
+
+  private:
+    struct Counter
+    {
+      std::string name;
+      std::string description;
+      const uint64_t *value;
+    };
+
+    struct Histogram
+    {
+      std::string name;
+      std::string description;
+      const uint64_t *values;
+      std::vector<std::string> labels;
+    };
+
+    struct Ratio
+    {
+      std::string name;
+      std::string description;
+      std::vector<size_t> numerators;
+      std::vector<size_t> denominators;
+    };
+
+    std::vector<Counter> counters{};
+    std::vector<Histogram> histograms{};
+    std::vector<Ratio> ratios{};
+
+    /* Counter values at the previous time series sample */
+    std::vector<uint64_t> previous{};
+
+    size_t findCounter(const std::string &name) const;
+    std::vector<uint64_t> getValues() const;
+    static double evaluate(const Ratio &ratio,
+                           const std::vector<uint64_t> &values);
+};
+
+
+/* Writes a time series of the registered statistics to a CSV file,
+ * every "interval" cycles.
+ */
+class StatisticsSeries
+{
+  public:
+    StatisticsSeries(StatisticsRegistry &registry,
+                     const std::string &filename,
+                     uint64_t interval);
+
+    StatisticsSeries(const StatisticsSeries &) = delete;
+    StatisticsSeries &operator=(const StatisticsSeries &) = delete;
+
+    uint64_t getNextSample() const
+    {
+      return nextSample;
+    }
+
+    /* Called every cycle, writes a sample when the interval elapsed. */
+    void clockPulse(uint64_t cycle)
+    {
+      if (cycle == nextSample)
+        {
+          registry.writeSeriesSample(file, cycle);
+          lastSample = cycle;
+          nextSample += interval;
+        }
+    }
+
+    /* Writes the partial interval since the last sample, such that the
+     * series adds up to the totals at the end of the run.
+     */
+    void finish(uint64_t cycle);
+
+  private:
+    StatisticsRegistry &registry;
+    std::ofstream file;
+    const uint64_t interval;
+    uint64_t nextSample;
+    uint64_t lastSample{};
+};
+
+#endif /* __STATISTICS_H__ */
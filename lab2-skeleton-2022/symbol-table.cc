@@ -0,0 +1,67 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    symbol-table.cc - Address to symbol lookup.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "symbol-table.h"
+
+#include <algorithm>
+#include <limits>
+
+static const std::string unknownSymbol{ "[unknown]" };
+
+SymbolTable::SymbolTable(std::vector<ELFSymbol> &&symbols)
+  : symbols{ std::move(symbols) }
+{
+  std::stable_sort(this->symbols.begin(), this->symbols.end(),
+                   [](const ELFSymbol &a, const ELFSymbol &b)
+                   {
+                     return a.address < b.address;
+                   });
+}
+
+const ELFSymbol *
+SymbolTable::lookup(MemAddress addr) const
+{
+  /* Find the first symbol beyond addr, the candidate precedes it. */
+  auto it = std::upper_bound(symbols.begin(), symbols.end(), addr,
+                             [](MemAddress addr, const ELFSymbol &symbol)
+                             {
+                               return addr < symbol.address;
+                             });
+  if (it == symbols.begin())
+    return nullptr;
+
+  --it;
+  if (it->size != 0 && addr >= it->address + it->size)
+    return nullptr;
+
+  return &*it;
+}
+
+const std::string &
+SymbolTable::getName(MemAddress addr) const
+{
+  const ELFSymbol *symbol = lookup(addr);
+  return symbol ? symbol->name : unknownSymbol;
+}
+
+MemAddress
+SymbolTable::getEnd(const ELFSymbol &symbol) const
+{
+  if (symbol.size != 0)
+    return symbol.address + symbol.size;
+
+  /* Extend up to the next symbol at a higher address. */
+  auto it = std::upper_bound(symbols.begin(), symbols.end(), symbol.address,
+                             [](MemAddress addr, const ELFSymbol &symbol)
+                             {
+                               return addr < symbol.address;
+                             });
+  if (it == symbols.end())
+    return std::numeric_limits<MemAddress>::max();
+
+  return it->address;
+}
@@ -0,0 +1,43 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    symbol-table.h - Address to symbol lookup.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __SYMBOL_TABLE_H__
+#define __SYMBOL_TABLE_H__
+
+#include "elf-file.h"
+
+#include <vector>
+
+/* Index of the function symbols of a program, sorted by address. An
+ * address is resolved to the closest symbol at or below it. Symbols
+ * without size extend up to the next symbol.
+ */
+class SymbolTable
+{
+  public:
+    SymbolTable() = default;
+    SymbolTable(std::vector<ELFSymbol> &&symbols);
+
+    /* Returns nullptr when the address does not belong to a symbol. */
+    const ELFSymbol *lookup(MemAddress addr) const;
+
+    /* Returns the name of the symbol containing addr, or a placeholder
+     * if there is no such symbol.
+     */
+    const std::string &getName(MemAddress addr) const;
+
+    /* Returns the address one past the end of the given symbol. */
+    MemAddress getEnd(const ELFSymbol &symbol) const;
+
+    const std::vector<ELFSymbol> &getSymbols() const { return symbols; }
+    bool empty() const { return symbols.empty(); }
+
+  private:
+    std::vector<ELFSymbol> symbols{};
+};
+
+#endif /* __SYMBOL_TABLE_H__ */
@@ -6,14 +6,50 @@
  */
 
 #include "sys-status.h"
+#include "pipeline.h"
+#include "memory-bus.h"
+#include "serial.h"
 
 #include <iostream>
 
-SysStatus::SysStatus(const MemAddress base)
-  : base{ base }
+SysStatus::SysStatus(const MemAddress base,
+                     const uint64_t &nCycles,
+                     const Pipeline &pipeline,
+                     const MemoryBus &bus,
+                     Serial &serial)
+  : base{ base }, nCycles{ nCycles }, pipeline{ pipeline }, bus{ bus },
+    serial{ serial }, startTime{ std::chrono::steady_clock::now() }
 {
 }
 
+uint64_t
+SysStatus::getCounter(PerfCounter counter) const
+{
+  const size_t index = static_cast<size_t>(counter);
+
+  if (frozen)
+    return frozenValues[index];
+
+  return getLiveCounter(counter) - offsets[index];
+}
+
+std::map<uint32_t, RegionStats>
+SysStatus::getRegions() const
+{
+  auto result(regions);
+  const auto now(getLiveCounters());
+
+  for (const auto & [id, entry] : openRegions)
+    {
+      auto &stats = result[id];
+      ++stats.instances;
+      for (size_t i = 0; i < now.size(); ++i)
+        stats.counters[i] += now[i] - entry[i];
+    }
+
+  return result;
+}
+
 /*
  * MemoryInterface
  */
@@ -33,24 +69,45 @@ SysStatus::readHalfWord(MemAddress addr)
 uint32_t
 SysStatus::readWord(MemAddress addr)
 {
-  throw IllegalAccess("Not supported on sysstatus interface");
+  if (addr == base + ControlOffset)
+    return readControl();
+
+  PerfCounter counter;
+  if (! getCounterForAddress(addr & ~MemAddress{ 0x7 }, counter))
+    throw IllegalAccess("Invalid system status address");
+
+  /* Reading the high word latches the full value, such that the low
+   * word can be read subsequently without tearing.
+   */
+  if ((addr & 0x7) == 0x0)
+    {
+      latchedValue = getCounter(counter);
+      return latchedValue >> 32;
+    }
+  else if ((addr & 0x7) == 0x4)
+    return latchedValue & 0xffffffff;
+
+  throw IllegalAccess("Unaligned access on sysstatus interface");
 }
 
 uint64_t
 SysStatus::readDoubleWord(MemAddress addr)
 {
-  throw IllegalAccess("Not supported on sysstatus interface");
+  PerfCounter counter;
+  if (! getCounterForAddress(addr, counter))
+    throw IllegalAccess("Invalid system status address");
+
+  return getCounter(counter);
 }
 
 
 void
 SysStatus::writeByte(MemAddress addr, uint8_t value)
 {
-  if (addr != base + 0x8)
+  if (addr != base + HaltOffset)
     throw IllegalAccess("Invalid system status address");
 
-  std::cerr << "System halt requested." << std::endl;
-  shouldHaltFlag = true;
+  requestHalt();
 }
 
 void
@@ -62,11 +119,16 @@ SysStatus::writeHalfWord(MemAddress addr, uint16_t value)
 void
 SysStatus::writeWord(MemAddress addr, uint32_t value)
 {
-  if (addr != base + 0x8)
+  if (addr == base + HaltOffset)
+    requestHalt();
+  else if (addr == base + ControlOffset)
+    writeControl(value);
+  else if (addr == base + RegionBeginOffset)
+    beginRegion(value);
+  else if (addr == base + RegionEndOffset)
+    endRegion(value);
+  else
     throw IllegalAccess("Invalid system status address");
-
-  std::cerr << "System halt requested." << std::endl;
-  shouldHaltFlag = true;
 }
 
 void
@@ -78,5 +140,138 @@ SysStatus::writeDoubleWord(MemAddress addr, uint64_t value)
 bool
 SysStatus::contains(MemAddress addr) const
 {
-  return base <= addr && addr < base + 0x10;
+  return base <= addr && addr < base + EndOffset;
+}
+
+/*
+ * Private methods
+ */
+
+uint64_t
+SysStatus::getLiveCounter(PerfCounter counter) const
+{
+  switch (counter)
+    {
+      case PerfCounter::Cycles:
+        return nCycles;
+
+      case PerfCounter::InstrIssued:
+        return pipeline.getInstrIssued();
+
+      case PerfCounter::InstrCompleted:
+        return pipeline.getInstrCompleted();
+
+      case PerfCounter::Stalls:
+        return pipeline.getStalls();
+
+      case PerfCounter::BytesRead:
+        return bus.getBytesRead();
+
+      case PerfCounter::BytesWritten:
+        return bus.getBytesWritten();
+
+      case PerfCounter::HostNanoseconds:
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+
+      default:
+        throw std::out_of_range("Unknown performance counter");
+    }
+}
+
+PerfCounterArray
+SysStatus::getLiveCounters() const
+{
+  PerfCounterArray result;
+
+  for (size_t i = 0; i < result.size(); ++i)
+    result[i] = getLiveCounter(static_cast<PerfCounter>(i));
+
+  return result;
+}
+
+bool
+SysStatus::getCounterForAddress(MemAddress addr,
+                                PerfCounter &counter) const
+{
+  /* The region of interest registers follow the counters and are not
+   * counters themselves.
+   */
+  if (addr < base + CountersOffset || addr >= base + RegionBeginOffset ||
+      (addr - base - CountersOffset) % 8 != 0)
+    return false;
+
+  counter = static_cast<PerfCounter>((addr - base - CountersOffset) / 8);
+  return true;
+}
+
+uint32_t
+SysStatus::readControl() const
+{
+  return frozen ? ControlFreeze : 0;
+}
+
+void
+SysStatus::writeControl(uint32_t value)
+{
+  const bool freeze = (value & ControlFreeze) == ControlFreeze;
+
+  if (freeze && ! frozen)
+    {
+      for (size_t i = 0; i < frozenValues.size(); ++i)
+        frozenValues[i] = getCounter(static_cast<PerfCounter>(i));
+    }
+
+  if ((value & ControlReset) == ControlReset)
+    frozenValues.fill(0);
+
+  /* Recompute the offsets such that counting continues from the
+   * (possibly reset) frozen values.
+   */
+  if (! freeze && (frozen || (value & ControlReset) == ControlReset))
+    {
+      for (size_t i = 0; i < offsets.size(); ++i)
+        offsets[i] = getLiveCounter(static_cast<PerfCounter>(i)) -
+            frozenValues[i];
+    }
+
+  frozen = freeze;
+}
+
+void
+SysStatus::requestHalt()
+{
+  /* Guest output written before the halt must precede the message. */
+  serial.flush();
+  std::cerr << "System halt requested." << std::endl;
+  shouldHaltFlag = true;
+}
+
+void
+SysStatus::beginRegion(uint32_t id)
+{
+  openRegions.emplace_back(id, getLiveCounters());
+}
+
+void
+SysStatus::endRegion(uint32_t id)
+{
+  if (openRegions.empty() || openRegions.back().first != id)
+    {
+      serial.flush();
+      std::cerr << "Warning: end of region " << id
+                << " does not match the innermost open region, ignored."
+                << std::endl;
+      return;
+    }
+
+  const auto now(getLiveCounters());
+  const auto &entry = openRegions.back().second;
+
+  auto &stats = regions[id];
+  ++stats.instances;
+  for (size_t i = 0; i < now.size(); ++i)
+    stats.counters[i] += now[i] - entry[i];
+
+  openRegions.pop_back();
 }
@@ -5,10 +5,39 @@
  * Copyright (C) 2016  Leiden University, The Netherlands.
  */
 
-/* The system status module currently only supports halting the
- * system. Other functionalities could be implemented here at different
- * memory addresses. (For instance, reading the instruction counter,
- * number of clock cycles since start up, etc.).
+/* The system status module supports halting the system and exposes a
+ * block of read-only performance counters, so that guest programs can
+ * time their own kernels.
+ *
+ * Register map (offsets relative to base):
+ *   0x08 - halt register (write-only, byte or word)
+ *   0x10 - counter control register (word, read/write)
+ *            bit 0: freeze counters (while set, counters do not advance)
+ *            bit 1: reset counters to zero (write-only, self-clearing)
+ *   0x18 - clock cycles
+ *   0x20 - instructions issued
+ *   0x28 - instructions completed
+ *   0x30 - stall cycles
+ *   0x38 - bytes read from the memory bus
+ *   0x40 - bytes written to the memory bus
+ *   0x48 - host time in nanoseconds
+ *   0x50 - region of interest begin (write-only word, region ID)
+ *   0x54 - region of interest end (write-only word, region ID)
+ *
+ * All counters are 64-bit and big-endian. They can be read using a
+ * single doubleword access, or using two word accesses: reading the
+ * high word (at offset +0) latches the full counter value, a subsequent
+ * read of the low word (at offset +4) returns the latched low half.
+ *
+ * Regions of interest (ROIs) scope the statistics to a part of the
+ * program, e.g. to exclude start-up code. Regions may be nested and
+ * entered multiple times; the statistics of a region are accumulated
+ * over all its instances and include those of nested regions. Instead
+ * of writing the registers, a region can also be marked in the code
+ * with "l.nop 0x11" (begin) and "l.nop 0x12" (end), with the region ID
+ * in r3, which the processor passes on when the l.nop retires. An end
+ * marker that does not match the innermost open region is reported and
+ * ignored, so that the statistics of the run are not lost.
  */
 
 #ifndef __SYS_STATUS_H__
@@ -16,14 +45,62 @@
 
 #include "memory-interface.h"
 
+#include <array>
+#include <chrono>
+#include <map>
+#include <vector>
+
+class Pipeline;
+class MemoryBus;
+class Serial;
+
+enum class PerfCounter
+{
+  Cycles,
+  InstrIssued,
+  InstrCompleted,
+  Stalls,
+  BytesRead,
+  BytesWritten,
+  HostNanoseconds,
+  LAST
+};
+
+using PerfCounterArray =
+    std::array<uint64_t, static_cast<size_t>(PerfCounter::LAST)>;
+
+struct RegionStats
+{
+  uint64_t instances{};
+  PerfCounterArray counters{};
+};
+
 class SysStatus : public MemoryInterface
 {
   public:
-    SysStatus(const MemAddress base);
+    /* Immediates of the l.nop region markers, region ID in r3 */
+    static constexpr uint16_t RegionBeginHint = 0x11;
+    static constexpr uint16_t RegionEndHint = 0x12;
+
+    SysStatus(const MemAddress base,
+              const uint64_t &nCycles,
+              const Pipeline &pipeline,
+              const MemoryBus &bus,
+              Serial &serial);
     ~SysStatus() override = default;
 
     bool shouldHalt() const { return shouldHaltFlag; }
 
+    uint64_t getCounter(PerfCounter counter) const;
+
+    /* Statistics per region of interest, regions that are still open
+     * are accounted up to the present.
+     */
+    std::map<uint32_t, RegionStats> getRegions() const;
+
+    void beginRegion(uint32_t id);
+    void endRegion(uint32_t id);
+
     /* MemoryInterface */
     uint8_t readByte(MemAddress addr) override;
     uint16_t readHalfWord(MemAddress addr) override;
@@ -37,10 +114,57 @@ class SysStatus : public MemoryInterface
 
     bool contains(MemAddress addr) const override;
 
+    SysStatus(const SysStatus &) = delete;
+    SysStatus &operator=(const SysStatus &) = delete;
+
   private:
+    static constexpr MemAddress HaltOffset = 0x08;
+    static constexpr MemAddress ControlOffset = 0x10;
+    static constexpr MemAddress CountersOffset = 0x18;
+    static constexpr MemAddress RegionBeginOffset =
+        CountersOffset + static_cast<size_t>(PerfCounter::LAST) * 8;
+    static constexpr MemAddress RegionEndOffset = RegionBeginOffset + 4;
+    static constexpr MemAddress EndOffset = RegionEndOffset + 4;
+
+    static constexpr uint32_t ControlFreeze = 1 << 0;
+    static constexpr uint32_t ControlReset = 1 << 1;
+
     const MemAddress base;
 
     bool shouldHaltFlag = false;
+
+    /* Sources of the counter values, no ownership */
+    const uint64_t &nCycles;
+    const Pipeline &pipeline;
+    const MemoryBus &bus;
+
+    /* Buffered guest output is flushed on halt, no ownership */
+    Serial &serial;
+
+    const std::chrono::steady_clock::time_point startTime;
+
+    /* Counter values are presented relative to these offsets, which are
+     * updated when the counters are reset or unfrozen.
+     */
+    PerfCounterArray offsets{};
+    PerfCounterArray frozenValues{};
+    bool frozen = false;
+
+    uint64_t latchedValue{};
+
+    /* Open regions of interest, innermost region last. For each region
+     * the live counter values at region entry are stored.
+     */
+    std::vector<std::pair<uint32_t, PerfCounterArray>> openRegions{};
+    std::map<uint32_t, RegionStats> regions{};
+
+    uint64_t getLiveCounter(PerfCounter counter) const;
+    PerfCounterArray getLiveCounters() const;
+    bool getCounterForAddress(MemAddress addr, PerfCounter &counter) const;
+
+    uint32_t readControl() const;
+    void writeControl(uint32_t value);
+    void requestHalt();
 };
 
 #endif /* __SYS_STATUS_H__ */
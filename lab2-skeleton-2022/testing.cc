@@ -7,31 +7,78 @@
 
 #include "testing.h"
 
-#include <regex>
+#include <algorithm>
+
+#include <charconv>
+#include <stdexcept>
+
+static bool
+isDigits(std::string_view str)
+{
+  return ! str.empty() &&
+         std::all_of(str.begin(), str.end(),
+                     [](char c) { return c >= '0' && c <= '9'; });
+}
+
+/* Matches r or R followed by one or two digits. */
+static bool
+isRegisterName(std::string_view str, bool allowUpper)
+{
+  return str.size() >= 2 && str.size() <= 3 &&
+         (str[0] == 'r' || (allowUpper && str[0] == 'R')) &&
+         isDigits(str.substr(1));
+}
+
 
 RegisterInit::RegisterInit(RegNumber number, RegValue value)
   : number{ number }, value{ value }
 { }
 
+/* The initializer has the form rNN=VALUE, with VALUE either decimal
+ * (octal with a leading zero) or hexadecimal with a 0x prefix. A string
+ * not of this form leaves the register and value at zero.
+ */
 RegisterInit::RegisterInit(std::string_view initstr)
 {
-  std::regex init_regex("[rR]([0-9]{1,2})=(0x[0-9]+|[0-9]+)");
-  std::match_results<std::string_view::const_iterator> match;
-
-  if (std::regex_match(initstr.begin(), initstr.end(), match, init_regex))
+  const size_t eq = initstr.find('=');
+  if (eq == std::string_view::npos ||
+      ! isRegisterName(initstr.substr(0, eq), true))
+    return;
+
+  std::string_view valstr = initstr.substr(eq + 1);
+  int base = 10;
+  if (valstr.size() > 2 && valstr.substr(0, 2) == "0x")
     {
-      size_t regnum = std::stoul(match[1]);
+      valstr.remove_prefix(2);
+      base = 16;
+    }
+  else if (valstr.size() > 1 && valstr[0] == '0')
+    base = 8;
 
-      /* Perform a first verification, a real check whether the register
-       * number is valid is performed when initializing the register file.
-       */
-      if (regnum < 0 || regnum >= MaxRegs)
-        throw std::out_of_range("Error: register regnum out of range: " +
-                                std::to_string(regnum));
+  if (! isDigits(valstr))
+    return;
 
-      number = regnum;
-      value = std::stoull(match[2], nullptr, 0);
-    }
+  size_t regnum = 0;
+  std::from_chars(initstr.data() + 1, initstr.data() + eq, regnum);
+
+  /* Perform a first verification, a real check whether the register
+   * number is valid is performed when initializing the register file.
+   */
+  if (regnum >= MaxRegs)
+    throw std::out_of_range("Error: register regnum out of range: " +
+                            std::to_string(regnum));
+
+  /* Like strtoull, only the leading valid digits are converted. */
+  unsigned long long parsed = 0;
+  auto [ptr, ec] = std::from_chars(valstr.data(),
+                                   valstr.data() + valstr.size(),
+                                   parsed, base);
+  if (ec == std::errc::result_out_of_range)
+    throw std::out_of_range("Error: register value out of range: " +
+                            std::string{ valstr });
+
+  number = regnum;
+  value = parsed;
 }
 
 
@@ -75,12 +122,9 @@ TestFile::validateSection(std::string_view sectionName) const
     throw std::runtime_error{
         "Section '" + std::string{ sectionName } + "' missing." };
 
-  std::regex regnameRegex("r([0-9]{1,2})");
-  std::smatch match;
-
   for (const auto & [prop, value] : getProperties(sectionName))
     {
-      if (std::regex_match(prop, match, regnameRegex))
+      if (isRegisterName(prop, false))
         throw std::runtime_error("Invalid register name " + prop);
     }
 }
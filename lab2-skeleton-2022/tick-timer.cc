@@ -0,0 +1,173 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    tick-timer.cc - Tick timer raising interrupts at a programmed count.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "tick-timer.h"
+#include "statistics.h"
+
+TickTimer::TickTimer(const MemAddress base, const uint64_t &nCycles,
+                     EventScheduler &scheduler)
+  : base{ base }, nCycles{ nCycles }, scheduler{ scheduler }
+{
+}
+
+/*
+ * MemoryInterface
+ */
+
+uint8_t
+TickTimer::readByte(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+uint16_t
+TickTimer::readHalfWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+uint32_t
+TickTimer::readWord(MemAddress addr)
+{
+  switch (addr - base)
+    {
+      case ModeOffset:
+        return TTMR;
+      case CountOffset:
+        return getCount();
+      default:
+        throw IllegalAccess("Invalid tick timer address");
+    }
+}
+
+uint64_t
+TickTimer::readDoubleWord(MemAddress addr)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+
+void
+TickTimer::writeByte(MemAddress addr, uint8_t value)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+void
+TickTimer::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+void
+TickTimer::writeWord(MemAddress addr, uint32_t value)
+{
+  switch (addr - base)
+    {
+      case ModeOffset:
+        {
+          /* A stopped one-shot timer is only restarted by a mode change
+           * or by writing the count.
+           */
+          const uint32_t oldMode = getMode();
+          const uint32_t count = getCount();
+          TTMR = value;
+          countBase = count;
+          baseCycle = nCycles;
+          running = getMode() != ModeDisabled &&
+              (getMode() != oldMode || running);
+          break;
+        }
+      case CountOffset:
+        setCount(value);
+        break;
+      default:
+        throw IllegalAccess("Invalid tick timer address");
+    }
+
+  scheduleMatch();
+}
+
+void
+TickTimer::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  throw IllegalAccess("Not supported on tick timer interface");
+}
+
+bool
+TickTimer::contains(MemAddress addr) const
+{
+  return base <= addr && addr < base + EndOffset;
+}
+
+void
+TickTimer::registerStatistics(StatisticsRegistry &registry)
+{
+  registry.addCounter("timer.matches", "Tick timer period matches",
+                      &nMatches);
+}
+
+/*
+ * Private methods
+ */
+
+uint32_t
+TickTimer::getCount() const
+{
+  if (! running)
+    return countBase;
+
+  return countBase + static_cast<uint32_t>(nCycles - baseCycle);
+}
+
+/* Writing the count (re)starts the timer, unless it is disabled. */
+void
+TickTimer::setCount(uint32_t value)
+{
+  countBase = value;
+  baseCycle = nCycles;
+  running = getMode() != ModeDisabled;
+}
+
+/* Replaces the pending match event, if any, by an event at the cycle
+ * the lower 28 bits of the count next equal the period.
+ */
+void
+TickTimer::scheduleMatch()
+{
+  scheduler.cancel(matchEvent);
+  matchEvent = 0;
+
+  if (! running)
+    return;
+
+  uint64_t delta = ((TTMR & PeriodMask) - countBase) & PeriodMask;
+  if (delta == 0)
+    delta = PeriodMask + 1;
+
+  matchEvent = scheduler.schedule(baseCycle + delta,
+                                  [this](uint64_t cycle) { match(cycle); });
+}
+
+void
+TickTimer::match(uint64_t cycle)
+{
+  matchEvent = 0;
+  ++nMatches;
+  if (TTMR & InterruptEnable)
+    TTMR |= InterruptPending;
+
+  countBase += static_cast<uint32_t>(cycle - baseCycle);
+  baseCycle = cycle;
+
+  if (getMode() == ModeRestart)
+    countBase = 0;
+  else if (getMode() == ModeOneShot)
+    running = false;
+
+  scheduleMatch();
+}
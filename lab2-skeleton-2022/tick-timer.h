@@ -0,0 +1,106 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    tick-timer.h - Tick timer raising interrupts at a programmed count.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __TICK_TIMER_H__
+#define __TICK_TIMER_H__
+
+#include "memory-interface.h"
+#include "event-scheduler.h"
+
+/* Tick timer following the OpenRISC tick timer, with its special-purpose
+ * registers mapped into memory. The count register is incremented every
+ * processor clock cycle. When its lower 28 bits match the time period
+ * in the mode register, the interrupt pending bit is set (if interrupts
+ * are enabled) and, depending on the mode, the count is reset, stops or
+ * continues.
+ *
+ * The count is not incremented every cycle but derived from the cycle
+ * counter when read, and the next match is an event on the scheduler.
+ *
+ * Register map (offsets relative to base, all word registers):
+ *   0x00 - TTMR, mode register
+ *            bits 31-30: mode, 0 disabled, 1 restart, 2 one-shot,
+ *                        3 continuous
+ *            bit 29: interrupt enable
+ *            bit 28: interrupt pending, write 0 to acknowledge
+ *            bits 27-0: time period
+ *   0x04 - TTCR, count register
+ */
+class TickTimer : public MemoryInterface
+{
+  public:
+    TickTimer(const MemAddress base, const uint64_t &nCycles,
+              EventScheduler &scheduler);
+    ~TickTimer() override = default;
+
+    bool interruptPending() const
+    {
+      return (TTMR & InterruptEnable) && (TTMR & InterruptPending);
+    }
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override;
+
+    void registerStatistics(StatisticsRegistry &registry) override;
+
+    TickTimer(const TickTimer &) = delete;
+    TickTimer &operator=(const TickTimer &) = delete;
+
+  private:
+    static constexpr MemAddress ModeOffset = 0x00;
+    static constexpr MemAddress CountOffset = 0x04;
+    static constexpr MemAddress EndOffset = 0x08;
+
+    static constexpr uint32_t ModeShift = 30;
+    static constexpr uint32_t ModeDisabled = 0;
+    static constexpr uint32_t ModeRestart = 1;
+    static constexpr uint32_t ModeOneShot = 2;
+    static constexpr uint32_t ModeContinuous = 3;
+
+    static constexpr uint32_t InterruptEnable = 1 << 29;
+    static constexpr uint32_t InterruptPending = 1 << 28;
+    static constexpr uint32_t PeriodMask = (1 << 28) - 1;
+
+    const MemAddress base;
+    const uint64_t &nCycles;
+    EventScheduler &scheduler;
+
+    uint32_t TTMR{};
+
+    /* The count equals countBase plus the cycles since baseCycle, unless
+     * the timer is stopped.
+     */
+    uint32_t countBase{};
+    uint64_t baseCycle{};
+    bool running{};
+
+    EventScheduler::EventID matchEvent{};
+
+    uint64_t nMatches{};
+
+    uint32_t getMode() const
+    {
+      return TTMR >> ModeShift;
+    }
+
+    uint32_t getCount() const;
+    void setCount(uint32_t value);
+    void scheduleMatch();
+    void match(uint64_t cycle);
+};
+
+#endif /* __TICK_TIMER_H__ */
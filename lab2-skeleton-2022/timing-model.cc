@@ -0,0 +1,351 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    timing-model.cc - Trace-driven timing model of the pipeline.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "timing-model.h"
+
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+/* Major opcodes */
+static constexpr uint32_t BranchNoFlagOpcode = 0x03;
+static constexpr uint32_t BranchFlagOpcode = 0x04;
+static constexpr uint32_t MoveHighOpcode = 0x06;
+static constexpr uint32_t JumpRegisterOpcode = 0x11;
+static constexpr uint32_t VectorOpcode = 0x0a;
+static constexpr uint32_t JumpLinkRegisterOpcode = 0x12;
+static constexpr uint32_t MoveToSPROpcode = 0x30;
+static constexpr uint32_t FloatOpcode = 0x32;
+static constexpr uint32_t FirstStoreOpcode = 0x33;
+static constexpr uint32_t LastStoreOpcode = 0x37;
+static constexpr uint32_t ALUOpcode = 0x38;
+static constexpr uint32_t SetFlagOpcode = 0x39;
+
+/* Source registers read by an instruction, a register number of 0 is
+ * used for "none" since r0 never causes a hazard.
+ */
+static void
+getSourceRegisters(uint32_t instructionWord, RegNumber &rA, RegNumber &rB)
+{
+  const uint32_t major = instructionWord >> 26;
+
+  rA = (instructionWord >> 16) & 0x1f;
+  rB = (instructionWord >> 11) & 0x1f;
+
+  if (major <= MoveHighOpcode)
+    rA = rB = 0;
+  else if (major == VectorOpcode || major == FloatOpcode)
+    return;
+  else if (major == JumpRegisterOpcode || major == JumpLinkRegisterOpcode)
+    rA = 0;
+  else if (! (major == ALUOpcode || major == SetFlagOpcode ||
+              major == MoveToSPROpcode || major == VectorOpcode ||
+              major == FloatOpcode ||
+              (major >= FirstStoreOpcode && major <= LastStoreOpcode)))
+    rB = 0;
+}
+
+static bool
+parseBool(const std::string &value, bool &result)
+{
+  if (value == "1" || value == "yes" || value == "true")
+    result = true;
+  else if (value == "0" || value == "no" || value == "false")
+    result = false;
+  else
+    return false;
+
+  return true;
+}
+
+static const char *predictorNames[] =
+{
+  "nottaken",
+  "taken",
+  "btfn",
+  "bimodal"
+};
+
+static_assert(std::size(predictorNames) ==
+              static_cast<size_t>(BranchPredictorType::LAST),
+              "predictor name missing");
+
+void
+TimingConfig::apply(const std::vector<ConfigFile::KeyValue> &properties)
+{
+  for (const auto & [key, value] : properties)
+    {
+      auto invalid = [&, &key = key]()
+        {
+          return std::runtime_error("timing configuration '" + name +
+                                    "': invalid value for '" + key + "'");
+        };
+
+      auto number = [&, &value = value]()
+        {
+          try
+            {
+              return static_cast<unsigned int>(std::stoul(value, nullptr, 0));
+            }
+          catch (std::exception &)
+            {
+              throw invalid();
+            }
+        };
+
+      if (key == "pipelining")
+        {
+          if (! parseBool(value, pipelining))
+            throw invalid();
+        }
+      else if (key == "predictor")
+        {
+          size_t i = 0;
+          while (i < std::size(predictorNames) && value != predictorNames[i])
+            ++i;
+          if (i == std::size(predictorNames))
+            throw invalid();
+          predictor = static_cast<BranchPredictorType>(i);
+        }
+      else if (key == "predictor_entries")
+        {
+          predictorEntries = number();
+          if (predictorEntries == 0 ||
+              (predictorEntries & (predictorEntries - 1)) != 0)
+            throw invalid();
+        }
+      else if (key == "branch_penalty")
+        branchPenalty = number();
+      else if (key == "load_use_penalty")
+        loadUsePenalty = number();
+      else if (key == "memory_latency")
+        memoryLatency = number();
+      else if (key == "mul_latency")
+        mulLatency = std::max(1u, number());
+      else if (key == "div_latency")
+        divLatency = std::max(1u, number());
+      else if (key == "fp_add_latency")
+        fpAddLatency = std::max(1u, number());
+      else if (key == "fp_mul_latency")
+        fpMulLatency = std::max(1u, number());
+      else if (key == "fp_div_latency")
+        fpDivLatency = std::max(1u, number());
+      else
+        throw std::runtime_error("timing configuration '" + name +
+                                 "': unknown property '" + key + "'");
+    }
+}
+
+std::vector<TimingConfig>
+loadTimingConfigs(const std::string &filename)
+{
+  ConfigFile file(filename);
+  std::vector<TimingConfig> configs;
+
+  /* The first section is the global section, with the defaults. */
+  TimingConfig defaults;
+  defaults.apply(file.getProperties(file.getSections().front()));
+
+  for (auto it = std::next(file.getSections().begin());
+       it != file.getSections().end(); ++it)
+    {
+      TimingConfig config(defaults);
+      config.name = *it;
+      config.apply(file.getProperties(*it));
+      configs.push_back(config);
+    }
+
+  if (configs.empty())
+    throw std::runtime_error(filename + ": no timing configurations");
+
+  return configs;
+}
+
+
+TimingModel::TimingModel(const TimingConfig &config)
+  : config{ config }
+{
+  for (size_t id = 0; id < NumOpcodeIDs; ++id)
+    {
+      const OpcodeInfo &info = getOpcodeInfo(id);
+      if (info.type == InstructionClass::MulDiv)
+        {
+          if (std::strncmp(info.mnemonic, "l.div", 5) == 0)
+            executeLatency[id] = config.divLatency - 1;
+          else
+            executeLatency[id] = config.mulLatency - 1;
+        }
+      else if (info.type == InstructionClass::Float)
+        {
+          if (std::strncmp(info.mnemonic, "lf.div", 6) == 0 ||
+              std::strncmp(info.mnemonic, "lf.rem", 6) == 0)
+            executeLatency[id] = config.fpDivLatency - 1;
+          else if (std::strncmp(info.mnemonic, "lf.mul", 6) == 0 ||
+                   std::strncmp(info.mnemonic, "lf.madd", 7) == 0)
+            executeLatency[id] = config.fpMulLatency - 1;
+          else
+            executeLatency[id] = config.fpAddLatency - 1;
+        }
+    }
+
+  if (config.predictor == BranchPredictorType::Bimodal)
+    counters.assign(config.predictorEntries, 1);  /* weakly not taken */
+}
+
+void
+TimingModel::retire(const TraceRecord &record)
+{
+  if (branchPending && ++branchDistance == 2)
+    resolveBranch(record.PC != branchPC + 2 * INSTRUCTION_SIZE);
+
+  decoder.setInstructionWord(record.instructionWord);
+  const OpcodeID id = decoder.getOpcodeID();
+  const InstructionClass type = getOpcodeInfo(id).type;
+  const bool accessesMemory =
+      type == InstructionClass::Load || type == InstructionClass::Store;
+
+  ++result.instructions;
+
+  if (! config.pipelining)
+    {
+      result.cycles += NumStages + executeLatency[id];
+      if (accessesMemory)
+        result.cycles += config.memoryLatency;
+      return;
+    }
+
+  uint64_t stalls{};
+
+  RegNumber rA, rB;
+  getSourceRegisters(record.instructionWord, rA, rB);
+  if (previousLoad && previousLoadRD != 0 &&
+      (rA == previousLoadRD || rB == previousLoadRD))
+    {
+      result.loadUseStalls += config.loadUsePenalty;
+      stalls += config.loadUsePenalty;
+    }
+
+  result.executeStalls += executeLatency[id];
+  stalls += executeLatency[id];
+
+  if (accessesMemory)
+    {
+      result.memoryStalls += config.memoryLatency;
+      stalls += config.memoryLatency;
+    }
+
+  result.cycles += 1 + stalls;
+
+  previousLoad = type == InstructionClass::Load;
+  previousLoadRD = (record.instructionWord >> 21) & 0x1f;
+
+  const uint32_t major = record.instructionWord >> 26;
+  if (major == BranchFlagOpcode || major == BranchNoFlagOpcode)
+    {
+      branchPending = true;
+      branchDistance = 0;
+      branchPC = record.PC;
+      branchPrediction = predict(record.PC, record.instructionWord);
+    }
+}
+
+TimingResult
+TimingModel::getResult() const
+{
+  TimingResult r(result);
+
+  if (config.pipelining && r.instructions > 0)
+    r.cycles += FillCycles;
+
+  return r;
+}
+
+/*
+ * Private methods
+ */
+
+bool
+TimingModel::predict(MemAddress PC, uint32_t instructionWord) const
+{
+  switch (config.predictor)
+    {
+      case BranchPredictorType::Taken:
+        return true;
+
+      case BranchPredictorType::BackwardTaken:
+        /* The sign bit of the 26-bit displacement */
+        return (instructionWord >> 25) & 1;
+
+      case BranchPredictorType::Bimodal:
+        return counters[(PC >> 2) & (counters.size() - 1)] >= 2;
+
+      case BranchPredictorType::NotTaken:
+      default:
+        return false;
+    }
+}
+
+void
+TimingModel::resolveBranch(bool taken)
+{
+  branchPending = false;
+
+  ++result.branches;
+  if (taken != branchPrediction)
+    {
+      ++result.mispredictions;
+      result.branchStalls += config.branchPenalty;
+      result.cycles += config.branchPenalty;
+    }
+
+  if (config.predictor == BranchPredictorType::Bimodal)
+    {
+      uint8_t &counter = counters[(branchPC >> 2) & (counters.size() - 1)];
+      if (taken && counter < 3)
+        ++counter;
+      else if (! taken && counter > 0)
+        --counter;
+    }
+}
+
+
+void
+writeTimingTable(std::ostream &os,
+                 const std::vector<TimingConfig> &configs,
+                 const std::vector<TimingResult> &results)
+{
+  auto storeFlags(os.flags());
+
+  os << std::left << std::setw(16) << "configuration" << std::right
+     << std::setw(14) << "cycles"
+     << std::setw(14) << "instructions"
+     << std::setw(8) << "IPC"
+     << std::setw(12) << "load-use"
+     << std::setw(12) << "branch"
+     << std::setw(12) << "memory"
+     << std::setw(12) << "execute"
+     << std::setw(12) << "mispredict" << std::endl;
+
+  for (size_t i = 0; i < configs.size(); ++i)
+    {
+      const auto &r = results[i];
+
+      os << std::left << std::setw(16) << configs[i].name << std::right
+         << std::setw(14) << r.cycles
+         << std::setw(14) << r.instructions
+         << std::setw(8) << std::fixed << std::setprecision(3) << r.getIPC()
+         << std::setw(12) << r.loadUseStalls
+         << std::setw(12) << r.branchStalls
+         << std::setw(12) << r.memoryStalls
+         << std::setw(12) << r.executeStalls
+         << std::setw(11) << std::setprecision(2)
+         << (r.branches ? 100.0 * r.mispredictions / r.branches : 0.0)
+         << "%" << std::endl;
+    }
+
+  os.flags(storeFlags);
+}
@@ -0,0 +1,140 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    timing-model.h - Trace-driven timing model of the pipeline.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __TIMING_MODEL_H__
+#define __TIMING_MODEL_H__
+
+#include "config-file.h"
+#include "inst-decoder.h"
+#include "trace.h"
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* The timing model computes the number of clock cycles needed to
+ * execute a stream of retired instructions, without executing them.
+ * This decouples timing from functional correctness: the stream can
+ * be taken from a recorded trace and replayed through any number of
+ * timing configurations.
+ *
+ * In pipelined mode, the model is a classic in-order 5-stage pipeline
+ * with full forwarding: every instruction takes a single cycle, plus
+ * stall cycles for load-use hazards, mispredicted conditional
+ * branches, data memory latency and multi-cycle multiply, divide and
+ * floating-point operations.
+ * In non-pipelined mode, every instruction takes one cycle per stage.
+ */
+
+enum class BranchPredictorType
+{
+  NotTaken,
+  Taken,
+  BackwardTaken,  /* backward taken, forward not taken */
+  Bimodal,
+  LAST
+};
+
+struct TimingConfig
+{
+  std::string name{ "default" };
+
+  bool pipelining = true;
+
+  BranchPredictorType predictor = BranchPredictorType::NotTaken;
+  size_t predictorEntries = 1024;  /* bimodal counters, power of two */
+
+  unsigned int branchPenalty = 2;   /* cycles lost on a misprediction */
+  unsigned int loadUsePenalty = 1;
+  unsigned int memoryLatency = 0;   /* additional cycles per data access */
+  unsigned int mulLatency = 1;
+  unsigned int divLatency = 1;
+  unsigned int fpAddLatency = 1;    /* also compares and conversions */
+  unsigned int fpMulLatency = 1;    /* also lf.madd.s */
+  unsigned int fpDivLatency = 1;    /* also lf.rem.s */
+
+  /* Apply the properties of a configuration file section, throws
+   * std::runtime_error for unknown keys and invalid values.
+   */
+  void apply(const std::vector<ConfigFile::KeyValue> &properties);
+};
+
+/* Reads timing configurations from a configuration file. Every
+ * section describes a configuration, properties outside of a section
+ * are defaults for all configurations.
+ */
+std::vector<TimingConfig> loadTimingConfigs(const std::string &filename);
+
+
+struct TimingResult
+{
+  uint64_t cycles{};
+  uint64_t instructions{};
+
+  uint64_t loadUseStalls{};
+  uint64_t branchStalls{};
+  uint64_t memoryStalls{};
+  uint64_t executeStalls{};
+
+  uint64_t branches{};
+  uint64_t mispredictions{};
+
+  double getIPC() const
+  {
+    return cycles ? static_cast<double>(instructions) / cycles : 0.0;
+  }
+};
+
+class TimingModel
+{
+  public:
+    TimingModel(const TimingConfig &config);
+
+    void retire(const TraceRecord &record);
+
+    TimingResult getResult() const;
+
+  private:
+    /* Number of cycles to fill the pipeline, before the first
+     * instruction completes.
+     */
+    static constexpr unsigned int FillCycles = 4;
+    static constexpr unsigned int NumStages = 5;
+
+    const TimingConfig config;
+
+    InstructionDecoder decoder{};
+
+    /* Additional execute cycles per opcode ID */
+    std::array<unsigned int, NumOpcodeIDs> executeLatency{};
+
+    std::vector<uint8_t> counters{};
+
+    TimingResult result{};
+
+    /* Destination of the previous instruction, if it was a load */
+    bool previousLoad = false;
+    RegNumber previousLoadRD{};
+
+    /* A conditional branch is resolved once the instruction after its
+     * delay slot retires.
+     */
+    bool branchPending = false;
+    unsigned int branchDistance{};
+    MemAddress branchPC{};
+    bool branchPrediction{};
+
+    bool predict(MemAddress PC, uint32_t instructionWord) const;
+    void resolveBranch(bool taken);
+};
+
+void writeTimingTable(std::ostream &os,
+                      const std::vector<TimingConfig> &configs,
+                      const std::vector<TimingResult> &results);
+
+#endif /* __TIMING_MODEL_H__ */
@@ -0,0 +1,103 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    timing-sweep.cc - Feeds retired instructions to many timing models.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "timing-sweep.h"
+
+#include <chrono>
+
+TimingSweep::TimingSweep(const std::vector<TimingConfig> &configs)
+  : configs{ configs }, pool{ std::make_unique<Batch[]>(PoolSize) }
+{
+  for (const auto &config : configs)
+    workers.push_back(std::make_unique<Worker>(config));
+
+  for (auto &worker : workers)
+    worker->thread = std::thread(&TimingSweep::workerLoop, this,
+                                 std::ref(*worker));
+}
+
+TimingSweep::~TimingSweep()
+{
+  finish();
+}
+
+std::vector<TimingResult>
+TimingSweep::finish()
+{
+  if (! finished)
+    {
+      finished = true;
+      if (pool[currentBatch].size > 0)
+        publish();
+
+      done.store(true, std::memory_order_release);
+      for (auto &worker : workers)
+        worker->thread.join();
+    }
+
+  std::vector<TimingResult> results;
+  for (auto &worker : workers)
+    results.push_back(worker->model.getResult());
+
+  return results;
+}
+
+/*
+ * Private methods
+ */
+
+void
+TimingSweep::publish()
+{
+  Batch &batch = pool[currentBatch];
+  batch.pending.store(workers.size(), std::memory_order_release);
+
+  /* A worker queue holds at most PoolSize indices, since no more
+   * batches can be in flight, so pushing cannot fail.
+   */
+  for (auto &worker : workers)
+    worker->queue.tryPush(currentBatch);
+
+  /* Wait until the next batch in the pool has been processed by all
+   * workers.
+   */
+  currentBatch = (currentBatch + 1) % PoolSize;
+  Batch &next = pool[currentBatch];
+  while (next.pending.load(std::memory_order_acquire) != 0)
+    std::this_thread::yield();
+  next.size = 0;
+}
+
+void
+TimingSweep::workerLoop(Worker &worker)
+{
+  uint32_t index;
+
+  while (true)
+    {
+      if (worker.queue.tryPop(index))
+        {
+          Batch &batch = pool[index];
+          for (size_t i = 0; i < batch.size; ++i)
+            worker.model.retire(batch.records[i]);
+          batch.pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+      else if (done.load(std::memory_order_acquire))
+        {
+          /* All batches were published before "done" was set. */
+          if (worker.queue.empty())
+            break;
+        }
+      else
+        {
+          /* Sleep rather than spin, like the trace writer: a batch takes
+           * long to fill compared to the time to process one.
+           */
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
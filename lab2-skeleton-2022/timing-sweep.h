@@ -0,0 +1,90 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    timing-sweep.h - Feeds retired instructions to many timing models.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __TIMING_SWEEP_H__
+#define __TIMING_SWEEP_H__
+
+#include "ring-buffer.h"
+#include "timing-model.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/* A timing sweep evaluates a number of timing configurations during a
+ * single functional run. Every configuration is simulated by a timing
+ * model on its own worker thread.
+ *
+ * Retired instructions are collected in batches. The batches are taken
+ * from a fixed pool and are shared by all workers: a filled batch is
+ * handed to every worker through a single-producer single-consumer
+ * queue of batch indices and is reused once all workers are done with
+ * it.
+ */
+class TimingSweep
+{
+  public:
+    TimingSweep(const std::vector<TimingConfig> &configs);
+    ~TimingSweep();
+
+    TimingSweep(const TimingSweep &) = delete;
+    TimingSweep &operator=(const TimingSweep &) = delete;
+
+    void retire(const TraceRecord &record)
+    {
+      Batch &batch = pool[currentBatch];
+      batch.records[batch.size++] = record;
+      if (batch.size == BatchSize)
+        publish();
+    }
+
+    /* Waits for all workers to process the remaining instructions and
+     * returns the result per configuration.
+     */
+    std::vector<TimingResult> finish();
+
+    const std::vector<TimingConfig> &getConfigs() const { return configs; }
+
+  private:
+    static constexpr size_t BatchSize = 256;
+    static constexpr size_t PoolSize = 64;
+    static constexpr size_t CacheLineSize = 64;
+
+    struct alignas(CacheLineSize) Batch
+    {
+      std::array<TraceRecord, BatchSize> records{};
+      size_t size{};
+
+      /* Number of workers that have yet to process the batch */
+      std::atomic<size_t> pending{ 0 };
+    };
+
+    struct Worker
+    {
+      Worker(const TimingConfig &config) : model{ config } { }
+
+      TimingModel model;
+      RingBuffer<uint32_t, PoolSize> queue{};
+      std::thread thread{};
+    };
+
+    const std::vector<TimingConfig> configs;
+
+    std::unique_ptr<Batch[]> pool;
+    uint32_t currentBatch{};
+
+    std::vector<std::unique_ptr<Worker>> workers{};
+    std::atomic<bool> done{ false };
+    bool finished = false;
+
+    void publish();
+    void workerLoop(Worker &worker);
+};
+
+#endif /* __TIMING_SWEEP_H__ */
@@ -0,0 +1,164 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    timing-tool.cc - Replays execution traces through timing models.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "testing.h"
+#include "timing-model.h"
+#include "trace.h"
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+#ifdef _MSC_VER
+#include "XGetopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#ifdef _MSC_VER
+/* Defined *somewhere* */
+#undef AbnormalTermination
+#endif
+
+
+static TimingResult
+replay(const MappedTrace &trace, const TimingConfig &config)
+{
+  TraceReader reader(trace);
+  TimingModel model(config);
+  TraceRecord record;
+
+  while (reader.next(record))
+    model.retire(record);
+
+  return model.getResult();
+}
+
+/* Replays the trace through all configurations, using up to nThreads
+ * worker threads that each take the next configuration to replay.
+ */
+static std::vector<TimingResult>
+replayAll(const MappedTrace &trace, const std::vector<TimingConfig> &configs,
+          unsigned int nThreads)
+{
+  std::vector<TimingResult> results(configs.size());
+  std::vector<std::exception_ptr> errors(configs.size());
+  std::atomic<size_t> nextConfig{ 0 };
+
+  auto worker = [&]()
+    {
+      size_t i;
+      while ((i = nextConfig.fetch_add(1)) < configs.size())
+        {
+          try
+            {
+              results[i] = replay(trace, configs[i]);
+            }
+          catch (...)
+            {
+              errors[i] = std::current_exception();
+            }
+        }
+    };
+
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0; t < nThreads && t < configs.size(); ++t)
+    threads.emplace_back(worker);
+  for (auto &thread : threads)
+    thread.join();
+
+  for (auto &error : errors)
+    if (error)
+      std::rethrow_exception(error);
+
+  return results;
+}
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage:" << std::endl;
+  std::cerr << progName << " [-c CONFIG] [-j THREADS] <traceFilename>" << std::endl;
+  std::cerr <<
+R"HERE(
+    -c, reads the timing configurations to evaluate from CONFIG. When
+        omitted, the default pipelined configuration is used.
+    -j, the number of configurations to evaluate in parallel. Defaults
+        to the number of processors.
+)HERE";
+}
+
+int
+main(int argc, char **argv)
+{
+  char c;
+  const char *configFilename = nullptr;
+  unsigned int nThreads = std::max(1u, std::thread::hardware_concurrency());
+  const char *progName = argv[0];
+
+  while ((c = getopt(argc, argv, "c:j:h")) != -1)
+    {
+      switch (c)
+        {
+          case 'c':
+            configFilename = optarg;
+            break;
+
+          case 'j':
+            try
+              {
+                nThreads = std::stoul(optarg);
+              }
+            catch (std::exception &)
+              {
+                nThreads = 0;
+              }
+
+            if (nThreads == 0)
+              {
+                std::cerr << "Error: Invalid number of threads "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'h':
+          default:
+            showHelp(progName);
+            return ExitCodes::HelpDisplayed;
+        }
+    }
+
+  argc -= optind;
+  argv += optind;
+
+  if (argc < 1)
+    {
+      std::cerr << "Error: No trace file specified." << std::endl << std::endl;
+      showHelp(progName);
+      return ExitCodes::InvalidArgument;
+    }
+
+  try
+    {
+      std::vector<TimingConfig> configs(1);
+      if (configFilename)
+        configs = loadTimingConfigs(configFilename);
+
+      MappedTrace trace(argv[0]);
+      auto results = replayAll(trace, configs, nThreads);
+      writeTimingTable(std::cout, configs, results);
+    }
+  catch (std::runtime_error &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return ExitCodes::InitializationError;
+    }
+
+  return ExitCodes::Success;
+}
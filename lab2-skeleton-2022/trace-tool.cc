@@ -0,0 +1,124 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    trace-tool.cc - Converts binary execution traces to text.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "inst-decoder.h"
+#include "testing.h"
+#include "trace.h"
+
+#include <iostream>
+
+#ifdef _MSC_VER
+#include "XGetopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#ifdef _MSC_VER
+/* Defined *somewhere* */
+#undef AbnormalTermination
+#endif
+
+
+/* Writes a record in the same format as the debug mode (-d) of the
+ * emulator, optionally followed by the register write and memory
+ * access of the instruction.
+ */
+static void
+formatRecord(std::ostream &os, InstructionDecoder &decoder,
+             const TraceRecord &record, bool verbose)
+{
+  auto storeFlags(os.flags());
+  os << std::hex << std::showbase << record.PC << "\t";
+  os.flags(storeFlags);
+
+  decoder.setInstructionWord(record.instructionWord);
+  try
+    {
+      os << decoder;
+    }
+  catch (IllegalInstruction &e)
+    {
+      os << "illegal instruction";
+    }
+
+  if (verbose)
+    {
+      os << std::hex << std::showbase;
+      if (record.writesRegister)
+        os << "\tr" << std::dec << static_cast<int>(record.rd)
+           << std::hex << " = " << record.value;
+      if (record.accessesMemory)
+        os << "\t[" << record.memAddress << "] "
+           << (record.memoryWrite ? "<- " : "-> ") << record.memData;
+      os.flags(storeFlags);
+    }
+
+  os << '\n';
+}
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage:" << std::endl;
+  std::cerr << progName << " [-v] <traceFilename>" << std::endl;
+  std::cerr <<
+R"HERE(
+    -v, also prints the register write and memory access of every
+        instruction.
+)HERE";
+}
+
+int
+main(int argc, char **argv)
+{
+  char c;
+  bool verbose = false;
+  const char *progName = argv[0];
+
+  while ((c = getopt(argc, argv, "vh")) != -1)
+    {
+      switch (c)
+        {
+          case 'v':
+            verbose = true;
+            break;
+
+          case 'h':
+          default:
+            showHelp(progName);
+            return ExitCodes::HelpDisplayed;
+        }
+    }
+
+  argc -= optind;
+  argv += optind;
+
+  if (argc < 1)
+    {
+      std::cerr << "Error: No trace file specified." << std::endl << std::endl;
+      showHelp(progName);
+      return ExitCodes::InvalidArgument;
+    }
+
+  try
+    {
+      MappedTrace trace(argv[0]);
+      TraceReader reader(trace);
+      InstructionDecoder decoder;
+      TraceRecord record;
+
+      while (reader.next(record))
+        formatRecord(std::cout, decoder, record, verbose);
+    }
+  catch (std::runtime_error &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return ExitCodes::InitializationError;
+    }
+
+  return ExitCodes::Success;
+}
@@ -0,0 +1,489 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    trace.cc - Binary execution trace recorder and reader.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#include "trace.h"
+#include "inst-decoder.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+static const char TraceMagic[8] = { 'R', 'V', 'E', 'M', 'U', 'T', 'R', 'C' };
+static constexpr uint32_t TraceVersion = 1;
+static constexpr size_t BlockHeaderSize = 16;
+
+enum TraceFlags : uint8_t
+{
+  RegisterWrite = 1 << 0,
+  MemoryAccess = 1 << 1,
+  MemoryWrite = 1 << 2,
+  NonSequential = 1 << 3
+};
+
+enum TraceCodec : uint8_t
+{
+  Stored = 0,
+  Zlib = 1
+};
+
+/*
+ * Encoding helpers
+ */
+
+static void
+putWord(std::vector<uint8_t> &out, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+    out.push_back(value >> (8 * i));
+}
+
+static uint32_t
+getWord(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t{ p[3] } << 24);
+}
+
+static void
+putVarint(std::vector<uint8_t> &out, uint32_t value)
+{
+  while (value >= 0x80)
+    {
+      out.push_back((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+  out.push_back(value);
+}
+
+static void
+putDelta(std::vector<uint8_t> &out, uint32_t value, uint32_t base)
+{
+  const int32_t delta = static_cast<int32_t>(value - base);
+  putVarint(out, (static_cast<uint32_t>(delta) << 1) ^ (delta >> 31));
+}
+
+static void
+encodeRecord(std::vector<uint8_t> &out, const TraceRecord &record,
+             TraceState &state)
+{
+  uint8_t flags{};
+  if (record.writesRegister)
+    flags |= RegisterWrite;
+  if (record.accessesMemory)
+    flags |= MemoryAccess;
+  if (record.memoryWrite)
+    flags |= MemoryWrite;
+  if (record.PC != state.PC + INSTRUCTION_SIZE)
+    flags |= NonSequential;
+
+  out.push_back(flags);
+  if (flags & NonSequential)
+    putDelta(out, record.PC, state.PC + INSTRUCTION_SIZE);
+  state.PC = record.PC;
+
+  for (int i = 3; i >= 0; --i)
+    out.push_back(record.instructionWord >> (8 * i));
+
+  if (flags & RegisterWrite)
+    {
+      out.push_back(record.rd);
+      putDelta(out, record.value, state.registers[record.rd]);
+      state.registers[record.rd] = record.value;
+    }
+
+  if (flags & MemoryAccess)
+    {
+      putDelta(out, record.memAddress, state.memAddress);
+      putVarint(out, record.memData);
+      state.memAddress = record.memAddress;
+    }
+}
+
+/* Decoding helpers, these throw on truncated input */
+
+static uint8_t
+getByte(const uint8_t *&p, const uint8_t *end)
+{
+  if (p == end)
+    throw std::runtime_error("truncated trace record");
+  return *p++;
+}
+
+static uint32_t
+getVarint(const uint8_t *&p, const uint8_t *end)
+{
+  uint32_t value{};
+
+  for (int shift = 0; shift < 35; shift += 7)
+    {
+      const uint8_t byte = getByte(p, end);
+      value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if (! (byte & 0x80))
+        return value;
+    }
+
+  throw std::runtime_error("malformed varint in trace record");
+}
+
+static uint32_t
+getDelta(const uint8_t *&p, const uint8_t *end, uint32_t base)
+{
+  const uint32_t zigzag = getVarint(p, end);
+  return base + ((zigzag >> 1) ^ -(zigzag & 1));
+}
+
+static void
+decodeRecord(const uint8_t *&p, const uint8_t *end, TraceRecord &record,
+             TraceState &state)
+{
+  const uint8_t flags = getByte(p, end);
+
+  record = TraceRecord{};
+  record.PC = state.PC + INSTRUCTION_SIZE;
+  if (flags & NonSequential)
+    record.PC = getDelta(p, end, record.PC);
+  state.PC = record.PC;
+
+  record.instructionWord = 0;
+  for (int i = 0; i < 4; ++i)
+    record.instructionWord = (record.instructionWord << 8) | getByte(p, end);
+
+  record.writesRegister = flags & RegisterWrite;
+  if (record.writesRegister)
+    {
+      record.rd = getByte(p, end);
+      if (record.rd >= NumRegs)
+        throw std::runtime_error("invalid register in trace record");
+      record.value = getDelta(p, end, state.registers[record.rd]);
+      state.registers[record.rd] = record.value;
+    }
+
+  record.accessesMemory = flags & MemoryAccess;
+  record.memoryWrite = flags & MemoryWrite;
+  if (record.accessesMemory)
+    {
+      record.memAddress = getDelta(p, end, state.memAddress);
+      record.memData = getVarint(p, end);
+      state.memAddress = record.memAddress;
+    }
+}
+
+/*
+ * TraceWriter
+ */
+
+TraceWriter::TraceWriter(const std::string &filename)
+  : filename{ filename }, file{ filename, std::ios::binary }
+{
+  if (! file.good())
+    throw std::runtime_error("cannot open file " + filename);
+
+  std::vector<uint8_t> header(std::begin(TraceMagic), std::end(TraceMagic));
+  putWord(header, TraceVersion);
+  file.write(reinterpret_cast<const char *>(header.data()), header.size());
+
+  block.reserve(BlockSize + 64);
+  writer = std::thread(&TraceWriter::writerLoop, this);
+}
+
+TraceWriter::~TraceWriter()
+{
+  try
+    {
+      close();
+    }
+  catch (std::exception &)
+    {
+      /* Errors are only reported by an explicit close() */
+    }
+}
+
+void
+TraceWriter::close()
+{
+  if (closed)
+    return;
+  closed = true;
+
+  done.store(true, std::memory_order_release);
+  writer.join();
+  file.close();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void
+TraceWriter::waitForSpace()
+{
+  if (failed.load(std::memory_order_acquire))
+    throw std::runtime_error("error writing trace file " + filename);
+
+  std::this_thread::yield();
+}
+
+void
+TraceWriter::writerLoop()
+{
+  try
+    {
+      TraceRecord record;
+
+      while (true)
+        {
+          if (buffer.tryPop(record))
+            {
+              encodeRecord(block, record, state);
+              ++blockRecords;
+              if (block.size() >= BlockSize)
+                flushBlock();
+            }
+          else if (done.load(std::memory_order_acquire))
+            {
+              /* All records were pushed before "done" was set. */
+              if (buffer.empty())
+                break;
+            }
+          else
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+      flushBlock();
+    }
+  catch (...)
+    {
+      error = std::current_exception();
+      failed.store(true, std::memory_order_release);
+    }
+}
+
+void
+TraceWriter::flushBlock()
+{
+  if (blockRecords == 0)
+    return;
+
+  const uint8_t *data = block.data();
+  uint32_t storedSize = block.size();
+  TraceCodec codec = Stored;
+
+#ifdef ENABLE_ZLIB
+  uLongf compressedSize = compressBound(block.size());
+  compressed.resize(compressedSize);
+  if (compress2(compressed.data(), &compressedSize, block.data(),
+                block.size(), 1) == Z_OK && compressedSize < block.size())
+    {
+      data = compressed.data();
+      storedSize = compressedSize;
+      codec = Zlib;
+    }
+#endif
+
+  std::vector<uint8_t> header;
+  putWord(header, block.size());
+  putWord(header, storedSize);
+  putWord(header, blockRecords);
+  header.push_back(codec);
+  header.resize(BlockHeaderSize);
+
+  file.write(reinterpret_cast<const char *>(header.data()), header.size());
+  file.write(reinterpret_cast<const char *>(data), storedSize);
+  if (! file.good())
+    throw std::runtime_error("error writing trace file " + filename);
+
+  block.clear();
+  blockRecords = 0;
+  state = TraceState{};
+}
+
+/*
+ * MappedTrace
+ */
+
+MappedTrace::MappedTrace(const std::string &filename)
+  : filename{ filename }
+{
+#ifdef _MSC_VER
+  fd = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                   nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("cannot open file " + filename);
+
+  LARGE_INTEGER fileSize;
+  if (! GetFileSizeEx(fd, &fileSize) || fileSize.QuadPart == 0)
+    {
+      CloseHandle(fd);
+      throw std::runtime_error("not a trace file: " + filename);
+    }
+  mapSize = fileSize.QuadPart;
+
+  mapping = CreateFileMappingA(fd, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr)
+    {
+      CloseHandle(fd);
+      throw std::runtime_error("Failed to create memory map.");
+    }
+
+  mapAddr = static_cast<const uint8_t *>(
+      MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (mapAddr == nullptr)
+    {
+      CloseHandle(mapping);
+      CloseHandle(fd);
+      throw std::runtime_error("Failed to setup memory map.");
+    }
+#else
+  fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("cannot open file " + filename);
+
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) < 0 || ! S_ISREG(statbuf.st_mode) ||
+      statbuf.st_size == 0)
+    {
+      close(fd);
+      throw std::runtime_error("not a trace file: " + filename);
+    }
+  mapSize = statbuf.st_size;
+
+  void *addr = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("Failed to setup memory map.");
+    }
+  mapAddr = static_cast<const uint8_t *>(addr);
+#endif
+
+  try
+    {
+      indexBlocks();
+    }
+  catch (...)
+    {
+      unmap();
+      throw;
+    }
+}
+
+MappedTrace::~MappedTrace()
+{
+  unmap();
+}
+
+void
+MappedTrace::indexBlocks()
+{
+  const size_t headerSize = sizeof(TraceMagic) + 4;
+
+  if (mapSize < headerSize ||
+      std::memcmp(mapAddr, TraceMagic, sizeof(TraceMagic)) != 0)
+    throw std::runtime_error("not a trace file: " + filename);
+
+  if (getWord(mapAddr + sizeof(TraceMagic)) != TraceVersion)
+    throw std::runtime_error("unsupported trace version in " + filename);
+
+  size_t offset = headerSize;
+  while (offset < mapSize)
+    {
+      if (mapSize - offset < BlockHeaderSize)
+        throw std::runtime_error("truncated trace file " + filename);
+
+      const uint8_t *header = mapAddr + offset;
+      Block block{ header + BlockHeaderSize, getWord(header),
+          getWord(header + 4), getWord(header + 8), header[12] };
+
+      offset += BlockHeaderSize;
+      if (mapSize - offset < block.storedSize)
+        throw std::runtime_error("truncated trace file " + filename);
+      offset += block.storedSize;
+
+      blocks.push_back(block);
+      nRecords += block.nRecords;
+    }
+}
+
+void
+MappedTrace::unmap()
+{
+#ifdef _MSC_VER
+  UnmapViewOfFile(mapAddr);
+  CloseHandle(mapping);
+  CloseHandle(fd);
+#else
+  munmap(const_cast<uint8_t *>(mapAddr), mapSize);
+  close(fd);
+#endif
+  mapAddr = nullptr;
+}
+
+/*
+ * TraceReader
+ */
+
+TraceReader::TraceReader(const MappedTrace &trace)
+  : trace{ trace }
+{
+}
+
+bool
+TraceReader::next(TraceRecord &record)
+{
+  while (remainingRecords == 0)
+    if (! startBlock())
+      return false;
+
+  decodeRecord(current, end, record, state);
+  --remainingRecords;
+
+  return true;
+}
+
+bool
+TraceReader::startBlock()
+{
+  const auto &blocks = trace.getBlocks();
+  if (blockIndex == blocks.size())
+    return false;
+
+  const auto &block = blocks[blockIndex++];
+
+  if (block.codec == Stored && block.storedSize == block.size)
+    current = block.data;
+#ifdef ENABLE_ZLIB
+  else if (block.codec == Zlib)
+    {
+      uLongf decompressedSize = block.size;
+      buffer.resize(block.size);
+      if (uncompress(buffer.data(), &decompressedSize, block.data,
+                     block.storedSize) != Z_OK ||
+          decompressedSize != block.size)
+        throw std::runtime_error("corrupt block in trace file " +
+                                 trace.getFilename());
+      current = buffer.data();
+    }
+#endif
+  else
+    throw std::runtime_error("unsupported block in trace file " +
+                             trace.getFilename());
+
+  end = current + block.size;
+  remainingRecords = block.nRecords;
+  state = TraceState{};
+
+  return true;
+}
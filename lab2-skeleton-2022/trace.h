@@ -0,0 +1,197 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    trace.h - Binary execution trace recorder and reader.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "arch.h"
+#include "ring-buffer.h"
+
+#include <array>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+/* Trace file format
+ *
+ * The file starts with an 8-byte magic "RVEMUTRC" and a 32-bit version
+ * number, followed by a sequence of blocks. Every block starts with a
+ * 16-byte header: the encoded size, the stored size, the number of
+ * records (all 32-bit) and the codec (one byte, 0 = stored, 1 = zlib),
+ * followed by three padding bytes. Fixed-size header fields are
+ * little-endian.
+ *
+ * Within a block, every record is encoded as:
+ *   - flags byte (see TraceFlags)
+ *   - PC delta with respect to the previous PC + 4, if not sequential
+ *   - instruction word, 4 bytes big-endian
+ *   - destination register and delta with respect to the previous
+ *     value of that register, if a register is written
+ *   - address delta with respect to the previous memory address and
+ *     the data, if memory is accessed
+ * Deltas are zigzag and varint (LEB128) encoded. The delta state is
+ * reset at the start of every block, such that blocks can be decoded
+ * independently.
+ */
+
+struct TraceRecord
+{
+  MemAddress PC{};
+  uint32_t instructionWord{};
+
+  bool writesRegister{};
+  RegNumber rd{};
+  RegValue value{};
+
+  bool accessesMemory{};
+  bool memoryWrite{};
+  MemAddress memAddress{};
+  RegValue memData{};
+};
+
+/* Delta encoding state, shared by the writer and the reader. */
+struct TraceState
+{
+  MemAddress PC{};
+  MemAddress memAddress{};
+  std::array<RegValue, NumRegs> registers{};
+};
+
+
+/* Records are handed to a background thread through a lock-free ring
+ * buffer, such that encoding, compression and file I/O do not slow
+ * down the simulation.
+ */
+class TraceWriter
+{
+  public:
+    TraceWriter(const std::string &filename);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    void record(const TraceRecord &record)
+    {
+      while (! buffer.tryPush(record))
+        waitForSpace();
+    }
+
+    /* Writes all pending records and closes the file. Throws
+     * std::runtime_error in case writing the trace failed.
+     */
+    void close();
+
+  private:
+    static constexpr size_t BufferCapacity = 1 << 14;
+    static constexpr size_t BlockSize = 1 << 16;
+
+    const std::string filename;
+    std::ofstream file;
+
+    RingBuffer<TraceRecord, BufferCapacity> buffer{};
+
+    std::thread writer{};
+    std::atomic<bool> done{ false };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error{};
+    bool closed = false;
+
+    /* Owned by the writer thread */
+    std::vector<uint8_t> block{};
+    std::vector<uint8_t> compressed{};
+    uint32_t blockRecords{};
+    TraceState state{};
+
+    void waitForSpace();
+    void writerLoop();
+    void flushBlock();
+};
+
+
+/* A trace file mapped into memory. The blocks are indexed when the
+ * file is opened. The mapping is read-only, so multiple readers, e.g.
+ * in different threads, can share a single mapped trace.
+ */
+class MappedTrace
+{
+  public:
+    struct Block
+    {
+      const uint8_t *data;
+      uint32_t size;
+      uint32_t storedSize;
+      uint32_t nRecords;
+      uint8_t codec;
+    };
+
+    MappedTrace(const std::string &filename);
+    ~MappedTrace();
+
+    MappedTrace(const MappedTrace &) = delete;
+    MappedTrace &operator=(const MappedTrace &) = delete;
+
+    const std::string &getFilename() const { return filename; }
+    const std::vector<Block> &getBlocks() const { return blocks; }
+    uint64_t getNumRecords() const { return nRecords; }
+
+  private:
+    const std::string filename;
+
+#ifdef _MSC_VER
+    HANDLE fd{};
+    HANDLE mapping{};
+#else
+    int fd{};
+#endif
+    const uint8_t *mapAddr = nullptr;
+    size_t mapSize{};
+
+    std::vector<Block> blocks{};
+    uint64_t nRecords{};
+
+    void indexBlocks();
+    void unmap();
+};
+
+/* Decodes the records of a mapped trace. Stored blocks are decoded
+ * directly from the mapping, compressed blocks are first decompressed
+ * into a buffer owned by the reader.
+ */
+class TraceReader
+{
+  public:
+    TraceReader(const MappedTrace &trace);
+
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+
+    /* Returns false at the end of the trace. */
+    bool next(TraceRecord &record);
+
+  private:
+    const MappedTrace &trace;
+
+    size_t blockIndex{};
+    const uint8_t *current = nullptr;
+    const uint8_t *end = nullptr;
+    uint32_t remainingRecords{};
+    TraceState state{};
+
+    std::vector<uint8_t> buffer{};
+
+    bool startBlock();
+};
+
+#endif /* __TRACE_H__ */
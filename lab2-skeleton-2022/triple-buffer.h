@@ -0,0 +1,73 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    triple-buffer.h - Lock-free triple buffer.
+ *
+ * Copyright (C) 2022  Leiden University, The Netherlands.
+ */
+
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+
+#include <array>
+#include <atomic>
+
+/* Passes the latest value from one producer thread to one consumer
+ * thread. The producer fills the back buffer and publishes it by
+ * swapping it with the ready buffer, the consumer swaps the ready
+ * buffer with its front buffer. Neither side ever waits: when the
+ * producer publishes faster than the consumer consumes, intermediate
+ * values are dropped.
+ */
+template <typename T>
+class TripleBuffer
+{
+  public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /* Producer side */
+    T &back()
+    {
+      return buffers[backIndex];
+    }
+
+    void publish()
+    {
+      backIndex = ready.exchange(backIndex | Fresh,
+                                 std::memory_order_acq_rel) & IndexMask;
+    }
+
+    /* Consumer side, returns false when nothing new was published
+     * since the previous call.
+     */
+    bool consume()
+    {
+      if (! (ready.load(std::memory_order_relaxed) & Fresh))
+        return false;
+
+      frontIndex = ready.exchange(frontIndex,
+                                  std::memory_order_acq_rel) & IndexMask;
+      return true;
+    }
+
+    const T &front() const
+    {
+      return buffers[frontIndex];
+    }
+
+  private:
+    static constexpr unsigned int IndexMask = 0x3;
+    static constexpr unsigned int Fresh = 0x4;
+    static constexpr size_t CacheLineSize = 64;
+
+    std::array<T, 3> buffers{};
+
+    /* Each index is only used by one side */
+    alignas(CacheLineSize) unsigned int backIndex = 0;
+    alignas(CacheLineSize) std::atomic<unsigned int> ready{ 1 };
+    alignas(CacheLineSize) unsigned int frontIndex = 2;
+};
+
+#endif /* __TRIPLE_BUFFER_H__ */